@@ -1,12 +1,17 @@
 #include "chat.h"
 #include "ui_chat.h"
 #include <QDebug>
+#include <QTextDocument>
+#include <QStringList>
 #include "client.h"
 
+constexpr int MAX_CHAT_LINES = 500; // older lines are dropped, so a client left open for days stays the same size
+
 Chat::Chat(QTcpSocket *socket, QString username, QWidget *parent) :
     QDialog(parent),
     ui(new Ui::Chat),
     socket(socket),
+    inbound(new NetSim(NetSim::Stream, NetSimConfig::fromEnvironment(), this)),
     username(username),
     isReady(false)
 {
@@ -15,6 +20,8 @@ Chat::Chat(QTcpSocket *socket, QString username, QWidget *parent) :
     // Set the entire background color of the chat dialog
     this->setStyleSheet("background-color: #000000;");  // Black background for the chat window
 
+    ui->chatDisplay->document()->setMaximumBlockCount(MAX_CHAT_LINES);
+
     // Set the color scheme for chat display and input areas with neon orange
     ui->chatDisplay->setStyleSheet("background-color: #333333; color: #FFA500; border: 2px solid #FFA500;");  // Neon orange text and border
     ui->messageInput->setStyleSheet("background-color: #333333; color: #FFA500; border: 2px solid #FFA500; font-size: 18px; font-weight: bold;");  // Neon orange text and border, bold
@@ -61,6 +68,15 @@ Chat::~Chat()
     qDebug() << "Chat dialog closed and resources deallocated.";
 }
 
+void Chat::setSpectator(bool spectating)
+{
+    ui->readyButton->setEnabled(!spectating);
+    ui->readyButton->setVisible(!spectating);
+    if (spectating) {
+        ui->readyLabel->setText("You Are Spectating");
+    }
+}
+
 void Chat::sendMessage()
 {
     QString message = ui->messageInput->text();
@@ -72,24 +88,61 @@ void Chat::sendMessage()
 }
 
 void Chat::onReadyRead() {
-    QByteArray data = socket->readAll();
-    QString message = QString::fromUtf8(data).trimmed();
+    // The server frames every message as one line, and several may arrive in one read
+    while (socket->canReadLine()) {
+        QByteArray line = socket->readLine();
+        QString message = QString::fromUtf8(line).trimmed();
+        if (!message.isEmpty()) {
+            inbound->transmit(line.size(), [this, message]() { handleMessage(message); });
+        }
+    }
+}
 
-    if (message == "GAME_START") {
+void Chat::handleMessage(const QString &message)
+{
+    // Anything people wrote comes marked, so names and chat can never be taken for a command
+    if (message.startsWith("CHAT:")) {
+        QString text = message.mid(5);
+        if (!text.startsWith(username + ":")) { // our own lines are already shown as "You:"
+            ui->chatDisplay->append(text);
+        }
+    }
+    else if (message == "GAME_START") {
         qDebug() << "Game start message received!";
         emit gameStart();  // Emit signal to start game
-        qDebug() << "TEST";
     }
     else if (message == "GAME_END") {
         emit gameEnd();
         ui->readyButton->setChecked(false);
 
 
-    }else {
-        // Check if the message contains your username to prevent double display
-        if (!message.startsWith(username + ":")) {
-            ui->chatDisplay->append(message);
-        }
+    }
+    else if (message.startsWith("SESSION:")) {
+        emit sessionIssued(message.mid(8).toULongLong());
+    }
+    else if (message.startsWith("RESUMED:")) {
+        ui->chatDisplay->append("Reconnected, back in the match.");
+        emit resumed();
+    }
+    else if (message == "RESUME_FAILED") {
+        emit resumeFailed();
+    }
+    else if (message.startsWith("UDP_OFFER:")) {
+        // "UDP_OFFER:<token>" or "UDP_OFFER:<token>:<port>" when UDP is not on the game port
+        QStringList parts = message.mid(10).split(':');
+        emit udpOffered(parts.value(0).toULongLong(), quint16(parts.value(1).toUInt()));
+    }
+    else if (message.startsWith("SNAPSHOT:")) {
+        emit snapshotReceived(QByteArray::fromBase64(message.mid(9).toLatin1()));
+    }
+    else if (message.startsWith("KEYFRAME:")) {
+        emit keyframeReceived(QByteArray::fromBase64(message.mid(9).toLatin1()));
+    }
+    else if (message.startsWith("PLAYER_ID:")) {
+        emit playerIdAssigned(message.mid(10).toInt());
+    }
+    else {
+        qDebug() << "Unknown message from server:" << message;
     }
 }
 
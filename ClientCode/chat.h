@@ -5,6 +5,7 @@
 
 #include <QDialog>
 #include <QTcpSocket>
+#include "../Common/netSim.h"
 
 namespace Ui {
 class Chat;
@@ -18,9 +19,18 @@ public:
     explicit Chat(QTcpSocket *socket, QString username, QWidget *parent = nullptr);
     ~Chat();
 
+    void setSpectator(bool spectating); // spectators cannot ready up
+
 signals:
     void gameStart();  // Signal to notify the client when the game starts
     void gameEnd();
+    void udpOffered(quint64 token, quint16 port);   // server offered the real-time UDP channel, port 0 for the game port
+    void snapshotReceived(const QByteArray &payload); // game state sent over TCP for clients without UDP
+    void keyframeReceived(const QByteArray &payload); // full match state for a spectator joining late
+    void playerIdAssigned(int id);                  // which player in the snapshots is us
+    void sessionIssued(quint64 token);              // lets us resume the match if the connection drops
+    void resumed();                                 // the server took us back into our match
+    void resumeFailed();                            // the match is gone or we were away too long
 
 private slots:
     void sendMessage();
@@ -30,8 +40,11 @@ private slots:
 
 
 private:
+    void handleMessage(const QString &message); // act on a single line received from the server
+
     Ui::Chat *ui;
     QTcpSocket *socket;
+    NetSim *inbound; // simulated link for everything the server sends
     QString username;
     bool isReady;
 };
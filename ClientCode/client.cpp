@@ -2,15 +2,27 @@
 #include "ui_dialog.h"
 #include "chat.h"
 #include "usernameDialog.h"
+#include "connector.h"
 #include <QFontDatabase>
 #include <QMessageBox>
 #include <QNetworkProxy>
 #include <QDebug>
+#include <QStringList>
+#include "../Common/snapshot.h"
+#include "../Common/keyframe.h"
+
+constexpr int INPUT_REDUNDANCY = 4;          // turns repeated in every input packet
+constexpr int MAX_QUEUED_TURNS = 8;          // matches the server's burst allowance, older presses are dropped
+constexpr int UDP_HELLO_INTERVAL_MS = 200;
+constexpr int UDP_HELLO_MAX_ATTEMPTS = 10;   // about two seconds before staying on TCP
+constexpr int RECONNECT_INTERVAL_MS = 500;
+constexpr int RECONNECT_MAX_ATTEMPTS = 20;   // the server holds our place for about ten seconds
 
 Client::Client(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::Dialog),
     socket(new QTcpSocket(this)),
+    connector(nullptr),
     chat(nullptr),
     gameDialog(nullptr)
 {
@@ -40,9 +52,29 @@ Client::Client(QWidget *parent) :
 
     // Connect signals and slots
     connect(ui->joinServerButton, &QPushButton::clicked, this, &Client::onJoinServerClicked);
-    connect(socket, &QTcpSocket::connected, this, &Client::onConnected);
-    connect(socket, &QTcpSocket::disconnected, this, &Client::onDisconnected);
-    connect(socket, QOverload<QAbstractSocket::SocketError>::of(&QTcpSocket::error), this, &Client::onError);
+    watchSocket();
+
+    // Joining never blocks the window: the connector resolves, races the addresses and retries on its own
+    connector = new Connector(ConnectPolicy::fromEnvironment(), this);
+    connect(connector, &Connector::connected, this, &Client::onConnectorConnected);
+    connect(connector, &Connector::retrying, this, [this](int round, int delayMs) {
+        ui->statusLabel->setText(QString("No answer, retry %1 in %2 s...").arg(round).arg(delayMs / 1000.0, 0, 'f', 1));
+    });
+    connect(connector, &Connector::failed, this, [this](const QString &reason) {
+        ui->joinServerButton->setEnabled(true);
+        ui->statusLabel->setText("Connection Failed");
+        QMessageBox::critical(this, "Connection Error", "Failed to connect to the server: " + reason);
+    });
+
+    reconnectTimer = new QTimer(this);
+    reconnectTimer->setInterval(RECONNECT_INTERVAL_MS);
+    connect(reconnectTimer, &QTimer::timeout, this, &Client::tryReconnect);
+
+    // Turns go out once per server tick, however many keys were pressed in it
+    turnFlushTimer = new QTimer(this);
+    turnFlushTimer->setSingleShot(true);
+    turnFlushTimer->setTimerType(Qt::PreciseTimer);
+    connect(turnFlushTimer, &QTimer::timeout, this, &Client::flushTurns);
 
 
 }
@@ -55,27 +87,65 @@ Client::~Client()
 
 void Client::onJoinServerClicked()
 {
-    QString ip = ui->ipInput->text();
+    QString host = ui->ipInput->text().trimmed(); // an address or a host name
     quint16 port = ui->portInput->text().toUInt();
 
-    if (ip.isEmpty() || port == 0) {
+    if (host.isEmpty() || port == 0) {
         QMessageBox::warning(this, "Invalid Input", "Please enter a valid IP address and port.");
         return;
     }
 
     ui->statusLabel->setText("Connecting...");
-    socket->connectToHost(QHostAddress(ip), port);
+    ui->joinServerButton->setEnabled(false); // until this attempt succeeds or gives up
+    serverPort = port;
+    connector->start(host, port);
+}
 
-    if (!socket->waitForConnected(5000)) {
-        QMessageBox::critical(this, "Connection Error", "Failed to connect to the server: " + socket->errorString());
-        ui->statusLabel->setText("Connection Failed");
-    }
+void Client::onConnectorConnected(QTcpSocket *connectedSocket)
+{
+    // The idle socket from the constructor makes way for the one that got through
+    socket->disconnect(this);
+    delete socket;
+    socket = connectedSocket;
+    socket->setParent(this);
+    watchSocket();
+
+    serverAddress = socket->peerAddress(); // the address that answered, also used for UDP and resuming
+    ui->joinServerButton->setEnabled(true);
+    onConnected();
+}
+
+void Client::watchSocket()
+{
+    connect(socket, &QTcpSocket::connected, this, &Client::onConnected);
+    connect(socket, &QTcpSocket::disconnected, this, &Client::onDisconnected);
+    connect(socket, QOverload<QAbstractSocket::SocketError>::of(&QTcpSocket::error), this, &Client::onError);
 }
 
 void Client::onConnected()
 {
     qDebug() << "Successfully connected to the server!";
     ui->statusLabel->setText("Connected to server");
+
+    // Open our end of the UDP channel now; it is only used once the server offers it
+    if (!udpChannel) {
+        udpChannel = new UdpChannel(this);
+        connect(udpChannel, &UdpChannel::datagramReceived, this, &Client::onDatagramReceived);
+        udpHelloTimer = new QTimer(this);
+        udpHelloTimer->setInterval(UDP_HELLO_INTERVAL_MS);
+        connect(udpHelloTimer, &QTimer::timeout, this, &Client::sendUdpHello);
+    }
+    if (!udpChannel->isBound()) {
+        udpChannel->bind(QHostAddress::AnyIPv4, 0);
+    }
+
+    if (reconnecting) {
+        // Same socket and chat window as before, only the stream is new
+        socket->write(("RESUME:" + QString::number(sessionToken) + "\n").toUtf8());
+        socket->flush();
+        return;
+    }
+
     promptUsername();
 }
 
@@ -87,12 +157,25 @@ void Client::promptUsername()
         QString username = dialog.getUsername();
         if (!username.isEmpty()) {
             this->username = username;
-            socket->write((username + "\n").toUtf8());
+            spectator = dialog.isSpectator();
+            if (spectator) {
+                socket->write(("SPECTATE:" + username + "\n").toUtf8()); // read-only connection
+            } else {
+                socket->write((username + "\n").toUtf8());
+            }
 
             // Open & establish chat window
             chat = new Chat(socket, username);
             connect(chat, &Chat::gameStart, this, &Client::startGame);
             connect(chat, &Chat::gameEnd, this, &Client::endGame);
+            connect(chat, &Chat::udpOffered, this, &Client::onUdpOffered);
+            connect(chat, &Chat::snapshotReceived, this, &Client::onSnapshotReceived);
+            connect(chat, &Chat::keyframeReceived, this, &Client::onKeyframeReceived);
+            connect(chat, &Chat::playerIdAssigned, this, &Client::onPlayerIdAssigned);
+            connect(chat, &Chat::sessionIssued, this, &Client::onSessionIssued);
+            connect(chat, &Chat::resumed, this, &Client::onResumed);
+            connect(chat, &Chat::resumeFailed, this, &Client::onResumeFailed);
+            chat->setSpectator(spectator);
             chat->show();
             this->close();
         } else {
@@ -105,14 +188,88 @@ void Client::promptUsername()
 void Client::onDisconnected()
 {
     qDebug() << "Disconnected from the server.";
+    udpReady = false; // the server forgets our UDP endpoint with the connection
+    if (udpHelloTimer) {
+        udpHelloTimer->stop();
+    }
+
+    // Mid-match the server keeps our snake for a while, so try to get back to it
+    if (canResume()) {
+        if (!reconnecting) {
+            reconnecting = true;
+            reconnectAttempts = 0;
+            reconnectTimer->start();
+            qDebug() << "Lost the connection during a match, trying to resume.";
+            QTimer::singleShot(0, this, &Client::tryReconnect); // first attempt straight away, once the socket has settled
+        }
+        return;
+    }
+
+    leaveServer();
+}
+
+void Client::leaveServer()
+{
+    reconnecting = false;
+    reconnectTimer->stop();
     ui->statusLabel->setText("Disconnected");
-    chat->close();
+    if (chat) {
+        chat->close();
+    }
     //this->show();
-    gameDialog->accept();
+    if (gameDialog) {
+        gameDialog->accept();
+    }
+}
+
+void Client::onSessionIssued(quint64 token)
+{
+    sessionToken = token;
+}
+
+void Client::tryReconnect()
+{
+    // Counted per tick rather than per connect, so a hanging attempt also runs out the clock
+    if (++reconnectAttempts > RECONNECT_MAX_ATTEMPTS) {
+        qDebug() << "Could not resume the match.";
+        socket->abort();
+        leaveServer();
+        return;
+    }
+
+    if (socket->state() == QAbstractSocket::UnconnectedState) {
+        socket->connectToHost(serverAddress, serverPort);
+    }
+}
+
+void Client::onResumed()
+{
+    reconnecting = false;
+    reconnectTimer->stop();
+    qDebug() << "Resumed the match after" << reconnectAttempts << "attempts.";
+}
+
+void Client::onResumeFailed()
+{
+    // The server may not have noticed the old connection drop yet, or the resume reached a
+    // process that is not holding our place; keep trying while the reconnect clock runs
+    socket->abort();
+    if (reconnecting && reconnectAttempts < RECONNECT_MAX_ATTEMPTS) {
+        qDebug() << "Resume refused, trying again.";
+        return; // the next reconnect tick connects again
+    }
+
+    qDebug() << "Could not resume the match.";
+    leaveServer();
 }
 
 void Client::onError(QAbstractSocket::SocketError error)
 {
+    if (reconnecting || canResume()) {
+        qDebug() << "Connection problem during a match:" << socket->errorString();
+        return; // reconnecting, or about to once the disconnect comes through
+    }
+
     qDebug() << "Socket error:" << socket->errorString();
     QMessageBox::critical(this, "Socket Error", socket->errorString());
     ui->statusLabel->setText("Error: " + socket->errorString());
@@ -137,22 +294,9 @@ void Client::startGame()
     }
 
     // Connect the keyPressed signal to send movement data to the server
-    connect(gameDialog, &GameDialog::keyPressed, this, [this](const QString &key) {
-        if (username.isEmpty()) {
-            qDebug() << "Username is not set. Cannot send PLAYERMOVE message.";
-            return;
-        }
-
-        // Format the message to include the username
-        QString message = "PLAYERMOVE: " + key + "\n";
-        if (socket->state() == QAbstractSocket::ConnectedState) {
-            socket->write(message.toUtf8());  // Send the message to the server
-            socket->flush();  // Ensure the data is sent immediately
-            qDebug() << "Sent to server:" << message;
-        } else {
-            qDebug() << "Socket not connected. Failed to send:" << message;
-        }
-    });
+    if (!spectator) {
+        connect(gameDialog, &GameDialog::keyPressed, this, &Client::sendMove, Qt::UniqueConnection);
+    }
 
     // Show the game dialog as a non-modal dialog
     gameDialog->show();
@@ -170,3 +314,151 @@ void Client::startGame()
 }
 
 
+
+void Client::sendMove(const QString &key)
+{
+    if (username.isEmpty()) {
+        qDebug() << "Username is not set. Cannot send PLAYERMOVE message.";
+        return;
+    }
+
+    // The tick on screen lets the server apply the turn where the player made it
+    queuedTurns.append({key.at(0).toLatin1(), gameDialog ? gameDialog->viewTick() : -1});
+    if (queuedTurns.size() > MAX_QUEUED_TURNS) {
+        queuedTurns.removeFirst();
+    }
+    if (!turnFlushTimer->isActive()) {
+        turnFlushTimer->start(gameDialog ? gameDialog->msUntilNextTick() : 0);
+    }
+}
+
+void Client::flushTurns()
+{
+    if (queuedTurns.isEmpty()) {
+        return;
+    }
+
+    if (udpReady) {
+        for (const QueuedTurn &turn : queuedTurns) {
+            Datagram::InputEntry entry;
+            entry.sequence = ++inputSequence;
+            entry.key = turn.key;
+            entry.tick = qint32(turn.tick);
+            recentInputs.append(entry);
+        }
+        // Every new turn goes out, plus a few earlier ones in case their packet was lost
+        int keep = qMax(INPUT_REDUNDANCY, queuedTurns.size());
+        if (recentInputs.size() > keep) {
+            recentInputs.remove(0, recentInputs.size() - keep);
+        }
+        queuedTurns.clear();
+
+        Datagram datagram;
+        datagram.type = Datagram::Input;
+        datagram.token = udpToken;
+        datagram.inputs = recentInputs;
+        udpChannel->sendTo(datagram.encode(), serverAddress, serverUdpPort);
+        return;
+    }
+
+    // One line for the whole batch, "PLAYERMOVE: W@1234,A@1234"
+    QStringList turns;
+    for (const QueuedTurn &turn : queuedTurns) {
+        turns.append(QChar(turn.key) + (turn.tick >= 0 ? "@" + QString::number(turn.tick) : QString()));
+    }
+    queuedTurns.clear();
+
+    QString message = "PLAYERMOVE: " + turns.join(',') + "\n";
+    if (socket->state() == QAbstractSocket::ConnectedState) {
+        socket->write(message.toUtf8());  // Send the message to the server
+        socket->flush();  // Ensure the data is sent immediately
+        qDebug() << "Sent to server:" << message;
+    } else {
+        qDebug() << "Socket not connected. Failed to send:" << message;
+    }
+}
+
+void Client::onUdpOffered(quint64 token, quint16 port)
+{
+    if (!udpChannel || !udpChannel->isBound()) {
+        qDebug() << "UDP offered but no local UDP socket, staying on TCP.";
+        return;
+    }
+
+    udpToken = token;
+    serverUdpPort = port ? port : serverPort;
+    udpReady = false;
+    udpHelloAttempts = 0;
+    sendUdpHello();
+    udpHelloTimer->start();
+}
+
+void Client::sendUdpHello()
+{
+    if (udpReady || udpHelloAttempts >= UDP_HELLO_MAX_ATTEMPTS) {
+        udpHelloTimer->stop();
+        if (!udpReady) {
+            qDebug() << "No answer on the UDP channel, movement stays on TCP.";
+        }
+        return;
+    }
+
+    ++udpHelloAttempts;
+    Datagram hello;
+    hello.type = Datagram::Hello;
+    hello.token = udpToken;
+    udpChannel->sendTo(hello.encode(), serverAddress, serverUdpPort);
+}
+
+void Client::onDatagramReceived(const QByteArray &bytes, const QHostAddress &sender, quint16 senderPort)
+{
+    if (senderPort != serverUdpPort || !sender.isEqual(serverAddress, QHostAddress::ConvertV4MappedToIPv4)) {
+        return; // not from our server
+    }
+
+    Datagram datagram = Datagram::parse(bytes);
+    if (datagram.type == Datagram::HelloAck && datagram.token == udpToken) {
+        if (!udpReady) {
+            qDebug() << "UDP channel established, sending movement over UDP.";
+        }
+        udpReady = true;
+        udpHelloTimer->stop();
+    } else if (datagram.type == Datagram::State) {
+        onSnapshotReceived(datagram.payload);
+    }
+}
+
+void Client::onSnapshotReceived(const QByteArray &payload)
+{
+    Snapshot snapshot;
+    if (!Snapshot::decode(payload, &snapshot)) {
+        qWarning() << "Dropping malformed snapshot";
+        return;
+    }
+
+    if (gameDialog) {
+        gameDialog->applySnapshot(snapshot);
+    }
+}
+
+void Client::onKeyframeReceived(const QByteArray &payload)
+{
+    Keyframe keyframe;
+    if (!Keyframe::decode(payload, &keyframe)) {
+        qWarning() << "Dropping malformed keyframe";
+        return;
+    }
+
+    if (!gameDialog) {
+        startGame();
+    }
+    gameDialog->applyKeyframe(keyframe);
+}
+
+void Client::onPlayerIdAssigned(int id)
+{
+    if (!gameDialog) {
+        startGame();
+    }
+    gameDialog->setLocalPlayer(id);
+}
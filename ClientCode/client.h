@@ -3,7 +3,12 @@
 
 #include <QDialog>
 #include <QTcpSocket>
+#include <QHostAddress>
+#include <QTimer>
+#include <QVector>
 #include "game.h"
+#include "../Common/udpChannel.h"
+#include "../Common/datagram.h"
 
 
 namespace Ui {
@@ -11,6 +16,7 @@ class Dialog;
 }
 
 class Chat;
+class Connector;
 
 class Client : public QDialog
 {
@@ -22,22 +28,63 @@ public:
 
 private slots:
     void onJoinServerClicked();
+    void onConnectorConnected(QTcpSocket *connectedSocket); // first address to answer, becomes our socket
     void onConnected();
     void onDisconnected();
     void onError(QAbstractSocket::SocketError error);
     //void onReadyRead();
     void startGame();
     void endGame();
+    void onUdpOffered(quint64 token, quint16 port); // server offered the UDP channel after the TCP handshake
+    void sendUdpHello(); // retried until the server acknowledges or we give up
+    void onDatagramReceived(const QByteArray &datagram, const QHostAddress &sender, quint16 senderPort);
+    void onSnapshotReceived(const QByteArray &payload); // snapshot from either transport
+    void onKeyframeReceived(const QByteArray &payload); // catch up when spectating a match already running
+    void onPlayerIdAssigned(int id); // the view follows our own player
+    void onSessionIssued(quint64 token);
+    void tryReconnect(); // one attempt to get the TCP connection back during a match
+    void onResumed();
+    void onResumeFailed(); // retried until the reconnect attempts run out
+    void leaveServer(); // connection is gone for good, close everything
+    void flushTurns(); // everything pressed since the last send, in one packet
 
 private:
     void promptUsername();
+    void watchSocket(); // our slots on the current socket's signals
+    void sendMove(const QString &key); // queued with the tick on screen, sent at the next tick boundary
+    bool canResume() const { return sessionToken && gameDialog && !spectator; } // playing in a match the server will hold for us
 
     Ui::Dialog *ui;
     QTcpSocket *socket;
+    Connector *connector;
     Chat *chat;
     QString username;
+    bool spectator = false; // watching only, never sends movement
     GameDialog *gameDialog = new GameDialog(this);
 
+    QHostAddress serverAddress;
+    quint16 serverPort = 0;
+    quint16 serverUdpPort = 0; // the game port unless the offer named another
+    UdpChannel *udpChannel = nullptr;
+    QTimer *udpHelloTimer = nullptr;
+    int udpHelloAttempts = 0;
+    quint64 udpToken = 0;
+    bool udpReady = false; // set once the server acknowledged our hello
+    quint32 inputSequence = 0;
+    QVector<Datagram::InputEntry> recentInputs; // resent with every input packet to ride out loss
+
+    struct QueuedTurn {
+        char key;
+        qint64 tick; // on screen when it was pressed, -1 before the first snapshot
+    };
+    QVector<QueuedTurn> queuedTurns; // pressed since the last send, oldest first
+    QTimer *turnFlushTimer = nullptr;
+
+    quint64 sessionToken = 0;   // from the server, proves who we are when resuming
+    bool reconnecting = false;  // lost the connection mid-match and trying to resume
+    QTimer *reconnectTimer = nullptr;
+    int reconnectAttempts = 0;
+
 };
 
 #endif // CLIENT_H
@@ -0,0 +1,187 @@
+// connector.cpp
+#include "connector.h"
+#include <QNetworkProxy>
+#include <QRandomGenerator>
+#include <QDebug>
+
+constexpr int BACKOFF_JITTER_PERCENT = 20; // spreads out clients that all lost the server at once
+
+ConnectPolicy ConnectPolicy::fromEnvironment()
+{
+    ConnectPolicy policy;
+    if (qEnvironmentVariableIsSet("TRON_CONNECT_TIMEOUT")) {
+        policy.attemptTimeoutMs = qMax(100, qEnvironmentVariableIntValue("TRON_CONNECT_TIMEOUT"));
+    }
+    if (qEnvironmentVariableIsSet("TRON_CONNECT_STAGGER")) {
+        policy.staggerMs = qMax(0, qEnvironmentVariableIntValue("TRON_CONNECT_STAGGER"));
+    }
+    if (qEnvironmentVariableIsSet("TRON_CONNECT_RETRIES")) {
+        policy.retries = qMax(0, qEnvironmentVariableIntValue("TRON_CONNECT_RETRIES"));
+    }
+    if (qEnvironmentVariableIsSet("TRON_CONNECT_BACKOFF")) {
+        policy.initialBackoffMs = qMax(0, qEnvironmentVariableIntValue("TRON_CONNECT_BACKOFF"));
+        policy.maxBackoffMs = qMax(policy.maxBackoffMs, policy.initialBackoffMs);
+    }
+    return policy;
+}
+
+Connector::Connector(const ConnectPolicy &policy, QObject *parent)
+    : QObject(parent),
+      policy(policy),
+      staggerTimer(new QTimer(this)),
+      retryTimer(new QTimer(this))
+{
+    staggerTimer->setSingleShot(true);
+    retryTimer->setSingleShot(true);
+    connect(staggerTimer, &QTimer::timeout, this, &Connector::startNextAttempt);
+    connect(retryTimer, &QTimer::timeout, this, &Connector::startRound);
+}
+
+Connector::~Connector()
+{
+    cancel();
+}
+
+void Connector::start(const QString &host, quint16 serverPort)
+{
+    cancel();
+    hostName = host;
+    port = serverPort;
+    round = 0;
+    lastError.clear();
+
+    // A literal address needs no lookup, anything else is resolved without blocking
+    QHostAddress literal;
+    if (literal.setAddress(host)) {
+        addresses = {literal};
+        startRound();
+        return;
+    }
+    lookupId = QHostInfo::lookupHost(host, this, SLOT(onLookedUp(QHostInfo)));
+}
+
+void Connector::cancel()
+{
+    if (lookupId != -1) {
+        QHostInfo::abortHostLookup(lookupId);
+        lookupId = -1;
+    }
+    staggerTimer->stop();
+    retryTimer->stop();
+    clearAttempts();
+}
+
+void Connector::onLookedUp(const QHostInfo &info)
+{
+    lookupId = -1;
+    if (info.error() != QHostInfo::NoError || info.addresses().isEmpty()) {
+        emit failed("Cannot resolve " + hostName + ": " + info.errorString());
+        return;
+    }
+    addresses = info.addresses();
+    startRound();
+}
+
+void Connector::startRound()
+{
+    nextAddress = 0;
+    startNextAttempt();
+}
+
+void Connector::startNextAttempt()
+{
+    if (nextAddress >= addresses.size()) {
+        return;
+    }
+
+    QTcpSocket *socket = new QTcpSocket(this);
+    socket->setProxy(QNetworkProxy::NoProxy);
+    QTimer *timeout = new QTimer(socket);
+    timeout->setSingleShot(true);
+    attempts.append({socket, timeout});
+
+    connect(socket, &QTcpSocket::connected, this, [this, socket]() {
+        // The winner leaves, everything else still trying is dropped
+        for (int i = 0; i < attempts.size(); ++i) {
+            if (attempts[i].socket == socket) {
+                delete attempts[i].timeout;
+                attempts.removeAt(i);
+                break;
+            }
+        }
+        cancel();
+        socket->disconnect(this);
+        socket->setParent(nullptr);
+        emit connected(socket);
+    });
+    connect(socket, QOverload<QAbstractSocket::SocketError>::of(&QTcpSocket::error), this, [this, socket]() {
+        lastError = socket->errorString();
+        dropAttempt(socket);
+    });
+    connect(timeout, &QTimer::timeout, this, [this, socket]() {
+        lastError = "Timed out";
+        dropAttempt(socket);
+    });
+
+    const QHostAddress &address = addresses.at(nextAddress++);
+    qDebug() << "Connecting to" << address.toString() << "port" << port;
+    timeout->start(policy.attemptTimeoutMs);
+    socket->connectToHost(address, port);
+
+    // The next address gets going early if this one is slow, straight away if it fails
+    if (nextAddress < addresses.size()) {
+        staggerTimer->start(policy.staggerMs);
+    }
+}
+
+void Connector::dropAttempt(QTcpSocket *socket)
+{
+    int index = -1;
+    for (int i = 0; i < attempts.size() && index == -1; ++i) {
+        index = attempts[i].socket == socket ? i : -1;
+    }
+    if (index == -1) {
+        return; // already dropped, a late timeout or error
+    }
+    attempts[index].timeout->stop();
+    attempts.removeAt(index);
+    socket->disconnect(this);
+    socket->abort();
+    socket->deleteLater(); // we may be inside one of its signals
+
+    if (nextAddress < addresses.size()) {
+        staggerTimer->stop();
+        startNextAttempt();
+    } else if (attempts.isEmpty()) {
+        roundFailed();
+    }
+}
+
+void Connector::clearAttempts()
+{
+    for (const Attempt &attempt : attempts) {
+        attempt.timeout->stop();
+        attempt.socket->disconnect(this);
+        attempt.socket->abort();
+        attempt.socket->deleteLater();
+    }
+    attempts.clear();
+}
+
+void Connector::roundFailed()
+{
+    if (round >= policy.retries) {
+        emit failed(lastError.isEmpty() ? QString("Could not connect") : lastError);
+        return;
+    }
+
+    // Doubling pause, capped, with some jitter so a crowd of clients does not retry in lockstep
+    qint64 delay = qMin<qint64>(qint64(policy.initialBackoffMs) << qMin(round, 20), policy.maxBackoffMs);
+    int jitter = int(delay * BACKOFF_JITTER_PERCENT / 100);
+    if (jitter > 0) {
+        delay += QRandomGenerator::global()->bounded(-jitter, jitter + 1);
+    }
+    ++round;
+    emit retrying(round, int(delay));
+    retryTimer->start(int(delay));
+}
@@ -0,0 +1,76 @@
+// connector.h
+
+#ifndef CONNECTOR_H
+#define CONNECTOR_H
+
+#include <QObject>
+#include <QHostAddress>
+#include <QHostInfo>
+#include <QList>
+#include <QString>
+#include <QTcpSocket>
+#include <QTimer>
+
+// How hard to try reaching the server. Defaults suit a LAN or a nearby host.
+struct ConnectPolicy
+{
+    int attemptTimeoutMs = 3000; // one address, from connectToHost() to giving up on it
+    int staggerMs = 250;         // head start of each address over the next one
+    int retries = 4;             // rounds after the first, each over every address
+    int initialBackoffMs = 500;  // wait before the first retry, doubled every round
+    int maxBackoffMs = 8000;
+
+    static ConnectPolicy fromEnvironment(); // TRON_CONNECT_TIMEOUT, _STAGGER, _RETRIES, _BACKOFF
+};
+
+// Finds a working connection to host:port without blocking the event loop. The
+// host is resolved first; when it has several addresses they are tried side by
+// side, each one started a little after the previous, and the first to connect
+// wins while the rest are dropped. A round where every address fails is retried
+// after an exponentially growing, slightly randomized pause.
+class Connector : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Connector(const ConnectPolicy &policy, QObject *parent = nullptr);
+    ~Connector();
+
+    void start(const QString &host, quint16 port); // cancels anything in progress
+    void cancel();
+    bool isActive() const { return lookupId != -1 || !attempts.isEmpty() || retryTimer->isActive(); }
+
+signals:
+    void connected(QTcpSocket *socket); // connected, ownership passes to the receiver
+    void retrying(int round, int delayMs); // every address failed, the next round starts after delayMs
+    void failed(const QString &reason);   // out of retries or the host does not resolve
+
+private slots:
+    void onLookedUp(const QHostInfo &info);
+    void startNextAttempt();
+    void startRound();
+
+private:
+    struct Attempt {
+        QTcpSocket *socket;
+        QTimer *timeout;
+    };
+
+    void dropAttempt(QTcpSocket *socket); // failed or timed out
+    void clearAttempts();
+    void roundFailed();
+
+    ConnectPolicy policy;
+    QString hostName;
+    quint16 port = 0;
+    int lookupId = -1;
+    QList<QHostAddress> addresses; // in the order the resolver gave them
+    int nextAddress = 0;           // next one this round starts
+    int round = 0;
+    QString lastError;
+    QList<Attempt> attempts;       // in flight
+    QTimer *staggerTimer;
+    QTimer *retryTimer;
+};
+
+#endif // CONNECTOR_H
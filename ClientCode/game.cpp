@@ -1,12 +1,39 @@
 #include "game.h"
 #include <QDebug>
+#include <QScreen>
+#include <QWindow>
+
+// The server's default arena; keyframes carry the real size of each match
+constexpr int SCENE_WIDTH = 800;
+constexpr int SCENE_HEIGHT = 600;
+
+constexpr int DEFAULT_INTERPOLATION_DELAY_MS = 100; // three snapshot intervals
+
+// Trails are stamped locally from player movement into a grid that ages like the server's
+constexpr int TRAIL_SIZE = 10;
+constexpr qreal TRAIL_STAMP_SPACING = 3;   // distance moved before the next stamp
 
 GameDialog::GameDialog(QWidget *parent) :
-    QDialog(parent)
+    QDialog(parent),
+    arena(new ArenaView(SCENE_WIDTH, SCENE_HEIGHT, this)),
+    frameTimer(new QTimer(this)),
+    interpolationDelayMs(DEFAULT_INTERPOLATION_DELAY_MS),
+    trails(SCENE_WIDTH, SCENE_HEIGHT),
+    trailSize(TRAIL_SIZE)
 {
     this->setWindowTitle("Game Window");
-    this->resize(800, 600); // Set a reasonable size for the game window
+    this->setFixedSize(arena->size()); // The window is exactly the arena
     this->setStyleSheet("background-color: black; color: white;"); // Styling for the game
+    arena->setFocusPolicy(Qt::NoFocus); // keys go to the dialog
+
+    if (qEnvironmentVariableIsSet("TRON_INTERP_DELAY")) {
+        setInterpolationDelay(qEnvironmentVariableIntValue("TRON_INTERP_DELAY"));
+    }
+
+    // Frames are drawn on a timer matching the display, snapshots only fill the buffer
+    frameTimer->setTimerType(Qt::PreciseTimer);
+    connect(frameTimer, &QTimer::timeout, this, &GameDialog::renderFrame);
+    clock.start();
 }
 
 GameDialog::~GameDialog()
@@ -16,6 +43,17 @@ GameDialog::~GameDialog()
 
 void GameDialog::keyPressEvent(QKeyEvent *event)
 {
+    // Holding a key repeats it; the direction is already set, so only the first press goes out
+    if (event->isAutoRepeat()) {
+        switch (event->key()) {
+        case Qt::Key_W: case Qt::Key_A: case Qt::Key_S: case Qt::Key_D:
+        case Qt::Key_I: case Qt::Key_J: case Qt::Key_K: case Qt::Key_L:
+            return;
+        default:
+            break;
+        }
+    }
+
     // Monitor key presses
     switch (event->key()) {
     case Qt::Key_W:
@@ -55,3 +93,144 @@ void GameDialog::keyPressEvent(QKeyEvent *event)
         break;
     }
 }
+
+void GameDialog::applySnapshot(const Snapshot &snapshot)
+{
+    qint64 now = clock.elapsed();
+    snapshots.insert(snapshot, now);
+
+    // Snapshots replayed after a keyframe are already behind the render time and would never
+    // be drawn, so lay down the trail they describe straight away
+    if (SnapshotBuffer::serverTimeOf(snapshot.tick) < snapshots.serverTimeAt(now) - interpolationDelayMs) {
+        stampTrails(snapshot.players);
+    }
+}
+
+void GameDialog::applyKeyframe(const Keyframe &keyframe)
+{
+    // A match on another size of arena gets a view of that size; big ones are seen through a viewport
+    if (keyframe.trails.width() != trails.width() || keyframe.trails.height() != trails.height()) {
+        arena->setArenaSize(keyframe.trails.width(), keyframe.trails.height());
+        setFixedSize(arena->size());
+    }
+
+    // The server's grid as it is, aging from here in step with the server
+    trails = keyframe.trails;
+    nextDecayMs = clock.elapsed() + keyframe.msUntilDecay;
+    trailSize = keyframe.trailLog.segmentSide();
+    lastStampPosition.clear();
+    arena->syncTrail(trails, QRect(0, 0, trails.width(), trails.height()));
+
+    applySnapshot(keyframe.snapshot);
+}
+
+void GameDialog::setInterpolationDelay(int ms)
+{
+    interpolationDelayMs = qMax(0, ms);
+}
+
+qint64 GameDialog::viewTick() const
+{
+    // The player turns at what they see, which is the interpolated past, not the server's present
+    if (snapshots.isEmpty()) {
+        return -1;
+    }
+    return SnapshotBuffer::tickAt(snapshots.serverTimeAt(clock.elapsed()) - interpolationDelayMs);
+}
+
+int GameDialog::msUntilNextTick() const
+{
+    if (snapshots.isEmpty()) {
+        return 0;
+    }
+    qint64 serverNow = snapshots.serverTimeAt(clock.elapsed());
+    return int(SnapshotBuffer::serverTimeOf(quint32(SnapshotBuffer::tickAt(serverNow) + 1)) - serverNow);
+}
+
+void GameDialog::startFrameTimer()
+{
+    qreal refreshRate = 60;
+    if (windowHandle() && windowHandle()->screen()) {
+        refreshRate = qBound<qreal>(30, windowHandle()->screen()->refreshRate(), 240);
+    }
+    frameTimer->start(qMax(1, qRound(1000 / refreshRate)));
+}
+
+void GameDialog::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+    startFrameTimer();
+    if (windowHandle()) {
+        connect(windowHandle(), &QWindow::screenChanged, this, &GameDialog::startFrameTimer, Qt::UniqueConnection);
+    }
+}
+
+void GameDialog::hideEvent(QHideEvent *event)
+{
+    frameTimer->stop(); // nothing to draw while hidden
+    QDialog::hideEvent(event);
+}
+
+void GameDialog::renderFrame()
+{
+    // Draw the world as it was a little while ago, so there is a snapshot on both sides of it
+    qint64 now = clock.elapsed();
+    QVector<PlayerState> players;
+    if (snapshots.sample(snapshots.serverTimeAt(now) - interpolationDelayMs, &players)) {
+        stampTrails(players);
+        followPlayer(players);
+        arena->setPlayers(players);
+    }
+    ageTrails(now);
+}
+
+void GameDialog::followPlayer(const QVector<PlayerState> &players)
+{
+    // Our own player, or for spectators and once we are out, the first one still alive
+    const PlayerState *followed = nullptr;
+    for (const PlayerState &player : players) {
+        if (player.id == localPlayerId && player.alive) {
+            followed = &player;
+            break;
+        }
+        if (!followed && player.alive) {
+            followed = &player;
+        }
+    }
+    if (followed) {
+        arena->setViewCenter(QPointF(followed->x, followed->y), trails);
+    }
+}
+
+void GameDialog::stampTrails(const QVector<PlayerState> &players)
+{
+    for (const PlayerState &player : players) {
+        if (!player.alive || !player.moving) {
+            continue;
+        }
+
+        QPointF position(player.x, player.y);
+        auto last = lastStampPosition.constFind(player.id);
+        if (last != lastStampPosition.constEnd() && (position - *last).manhattanLength() < TRAIL_STAMP_SPACING) {
+            continue;
+        }
+        lastStampPosition[player.id] = position;
+
+        QRectF rect(position.x() - trailSize / 2.0, position.y() - trailSize / 2.0, trailSize, trailSize);
+        arena->syncTrail(trails, trails.stamp(rect, player.id));
+    }
+}
+
+void GameDialog::ageTrails(qint64 now)
+{
+    // One pass over the whole grid per interval, however long the trails are;
+    // frames that fall behind catch up step by step
+    QVector<QRect> expired;
+    while (now >= nextDecayMs) {
+        trails.decay(&expired);
+        nextDecayMs += TrailGrid::DECAY_INTERVAL_MS;
+    }
+    for (const QRect &span : expired) {
+        arena->syncTrail(trails, span);
+    }
+}
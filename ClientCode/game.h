@@ -3,6 +3,15 @@
 
 #include <QDialog>
 #include <QKeyEvent>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QHash>
+#include <QPointF>
+#include "../Common/snapshot.h"
+#include "../Common/keyframe.h"
+#include "../Common/arenaView.h"
+#include "../Common/trailGrid.h"
+#include "snapshotBuffer.h"
 
 class GameDialog : public QDialog
 {
@@ -12,11 +21,41 @@ public:
     explicit GameDialog(QWidget *parent = nullptr);
     ~GameDialog();
 
+    void applySnapshot(const Snapshot &snapshot); // buffered, drawn later by the frame timer
+    void applyKeyframe(const Keyframe &keyframe); // replace the trail grid, used when joining a running match
+    void setInterpolationDelay(int ms); // how far behind the newest snapshot remote players are drawn
+    void setLocalPlayer(int id) { localPlayerId = id; } // the view follows this player on arenas bigger than the window
+    qint64 viewTick() const; // server tick being drawn right now, -1 before the first snapshot
+    int msUntilNextTick() const; // on the server's clock as far as we can tell, 0 before the first snapshot
+
 protected:
     void keyPressEvent(QKeyEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
 
 signals:
     void keyPressed(const QString &key);
+
+private slots:
+    void renderFrame(); // sample the buffer and hand the result to the arena
+
+private:
+    void startFrameTimer(); // paced to the refresh rate of the screen we are on
+    void stampTrails(const QVector<PlayerState> &players);
+    void followPlayer(const QVector<PlayerState> &players); // keep the viewport on our player
+    void ageTrails(qint64 now); // decay the grid on the same schedule as the server
+
+    ArenaView *arena;
+    SnapshotBuffer snapshots;
+    QElapsedTimer clock;   // local time base for arrivals and frames
+    QTimer *frameTimer;    // drives repaints, network arrival never does
+    int interpolationDelayMs;
+    int localPlayerId = -1; // -1 when spectating
+
+    TrailGrid trails;
+    qint64 nextDecayMs = TrailGrid::DECAY_INTERVAL_MS; // local time of the next decay step
+    QHash<quint8, QPointF> lastStampPosition;
+    int trailSize; // side of the segments the server lays, from the last keyframe
 };
 
 #endif // GAME_H
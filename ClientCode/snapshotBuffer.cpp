@@ -0,0 +1,126 @@
+// snapshotBuffer.cpp
+#include "snapshotBuffer.h"
+#include <QHash>
+
+constexpr int SERVER_TICK_MS = 10;          // the server advances the game every 10 ms
+constexpr int BUFFER_CAPACITY = 32;         // about a second of snapshots
+constexpr int DEFAULT_MAX_EXTRAPOLATION_MS = 100;
+constexpr qint64 OFFSET_DRIFT_MS = 1;       // how fast the offset may creep up when every arrival is late
+
+SnapshotBuffer::SnapshotBuffer()
+    : maxExtrapolationMs(DEFAULT_MAX_EXTRAPOLATION_MS)
+{
+}
+
+qint64 SnapshotBuffer::serverTimeOf(quint32 tick)
+{
+    return qint64(tick) * SERVER_TICK_MS;
+}
+
+qint64 SnapshotBuffer::tickAt(qint64 serverMs)
+{
+    return qMax<qint64>(0, serverMs / SERVER_TICK_MS);
+}
+
+void SnapshotBuffer::insert(const Snapshot &snapshot, qint64 receivedAtMs)
+{
+    qint64 serverMs = serverTimeOf(snapshot.tick);
+
+    // Track the smallest observed delay as the clock offset; it only moves up slowly so that a
+    // burst of late packets does not drag the render time along with it
+    qint64 offset = receivedAtMs - serverMs;
+    if (!hasOffset || offset < clockOffsetMs) {
+        clockOffsetMs = offset;
+        hasOffset = true;
+    } else {
+        clockOffsetMs += qMin(offset - clockOffsetMs, OFFSET_DRIFT_MS);
+    }
+
+    // Insert in order, most snapshots arrive in order so search from the back
+    int position = entries.size();
+    while (position > 0 && entries[position - 1].serverMs >= serverMs) {
+        if (entries[position - 1].serverMs == serverMs) {
+            return; // duplicate
+        }
+        --position;
+    }
+    entries.insert(position, Entry{serverMs, snapshot});
+
+    while (entries.size() > BUFFER_CAPACITY) {
+        entries.removeFirst();
+    }
+}
+
+void SnapshotBuffer::clear()
+{
+    entries.clear();
+    hasOffset = false;
+}
+
+static PlayerState lerpState(const PlayerState &from, const PlayerState &to, float t)
+{
+    PlayerState state = t < 1.0f ? from : to; // heading and flags switch when the newer snapshot is reached
+    state.x = from.x + (to.x - from.x) * t;
+    state.y = from.y + (to.y - from.y) * t;
+    return state;
+}
+
+bool SnapshotBuffer::sample(qint64 serverMs, QVector<PlayerState> *players) const
+{
+    if (entries.isEmpty()) {
+        return false;
+    }
+
+    // Distant players are left out of most snapshots, so each player is blended between the
+    // snapshots that actually mention them, however far apart those are
+    struct Sighting {
+        qint64 serverMs;
+        const PlayerState *state;
+    };
+    QHash<quint8, QVector<Sighting>> sightings;
+    QVector<quint8> order; // first appearance, keeps the draw order stable
+    for (const Entry &entry : entries) {
+        for (const PlayerState &state : entry.snapshot.players) {
+            QVector<Sighting> &seen = sightings[state.id];
+            if (seen.isEmpty()) {
+                order.append(state.id);
+            }
+            seen.append(Sighting{entry.serverMs, &state});
+        }
+    }
+
+    players->clear();
+    for (quint8 id : order) {
+        const QVector<Sighting> &seen = sightings[id];
+        if (serverMs <= seen.first().serverMs || seen.size() == 1) {
+            players->append(*(serverMs <= seen.first().serverMs ? seen.first() : seen.last()).state);
+            continue;
+        }
+
+        const Sighting *from;
+        const Sighting *to;
+        float t;
+        if (serverMs >= seen.last().serverMs) {
+            // Late packet: keep moving along the last known velocity for a little while, then hold
+            from = &seen[seen.size() - 2];
+            to = &seen.last();
+            qint64 ahead = qMin<qint64>(serverMs - to->serverMs, maxExtrapolationMs);
+            t = 1.0f + float(ahead) / float(to->serverMs - from->serverMs);
+        } else {
+            int index = seen.size() - 1;
+            while (seen[index - 1].serverMs > serverMs) {
+                --index;
+            }
+            from = &seen[index - 1];
+            to = &seen[index];
+            t = float(serverMs - from->serverMs) / float(to->serverMs - from->serverMs);
+        }
+
+        if (!to->state->alive || !from->state->alive) {
+            players->append(*to->state); // nothing sensible to blend with
+        } else {
+            players->append(lerpState(*from->state, *to->state, t));
+        }
+    }
+    return true;
+}
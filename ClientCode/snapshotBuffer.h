@@ -0,0 +1,47 @@
+// snapshotBuffer.h
+
+#ifndef SNAPSHOTBUFFER_H
+#define SNAPSHOTBUFFER_H
+
+#include <QList>
+#include <QVector>
+#include "../Common/snapshot.h"
+
+// Small time indexed history of server snapshots. The renderer samples it a
+// fixed delay behind the newest data so that there is (almost) always a
+// snapshot on either side of the time being drawn, hiding network jitter.
+class SnapshotBuffer
+{
+public:
+    SnapshotBuffer();
+
+    void insert(const Snapshot &snapshot, qint64 receivedAtMs); // out of order and duplicate ticks are handled
+    void clear();
+    bool isEmpty() const { return entries.isEmpty(); }
+
+    static qint64 serverTimeOf(quint32 tick); // server clock in ms at the given tick
+    static qint64 tickAt(qint64 serverMs);    // the tick running at that server time
+
+    // Server time that corresponds to a local clock reading, based on the observed arrival times
+    qint64 serverTimeAt(qint64 localMs) const { return localMs - clockOffsetMs; }
+
+    // Player states at serverMs: each player interpolated between the two closest snapshots that
+    // include them, extrapolated for a short while past the newest one, and held after that.
+    // Returns false if empty.
+    bool sample(qint64 serverMs, QVector<PlayerState> *players) const;
+
+    void setMaxExtrapolation(int ms) { maxExtrapolationMs = ms; }
+
+private:
+    struct Entry {
+        qint64 serverMs;
+        Snapshot snapshot;
+    };
+
+    QList<Entry> entries; // ordered by server time, oldest first
+    qint64 clockOffsetMs = 0; // local time minus server time, from the fastest recent arrivals
+    bool hasOffset = false;
+    int maxExtrapolationMs;
+};
+
+#endif // SNAPSHOTBUFFER_H
@@ -21,13 +21,22 @@ UsernameDialog::UsernameDialog(QWidget *parent) : QDialog(parent)
     okButton = new QPushButton("OK", this);
     okButton->setStyleSheet("background-color: #00FFFF; color: black; font-weight: bold;");
 
+    // Create and style the spectate button
+    spectateButton = new QPushButton("Spectate", this);
+    spectateButton->setStyleSheet("border: 2px solid #00FFFF; color: #00FFFF; font-weight: bold;");
+
     // Connect the OK button to accept the dialog
     connect(okButton, &QPushButton::clicked, this, &QDialog::accept);
+    connect(spectateButton, &QPushButton::clicked, this, [this]() {
+        spectator = true;
+        accept();
+    });
 
     // Set up the layout and add the input field and button
     QVBoxLayout *layout = new QVBoxLayout(this);
     layout->addWidget(usernameInput);
     layout->addWidget(okButton);
+    layout->addWidget(spectateButton);
 
     setLayout(layout);
 }
@@ -37,3 +46,9 @@ QString UsernameDialog::getUsername() const
 {
     return usernameInput->text();
 }
+
+// Function to check whether the user wants to spectate
+bool UsernameDialog::isSpectator() const
+{
+    return spectator;
+}
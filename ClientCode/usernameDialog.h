@@ -17,10 +17,13 @@ class UsernameDialog : public QDialog
 public:
     explicit UsernameDialog(QWidget *parent = nullptr);
     QString getUsername() const;
+    bool isSpectator() const; // true if the user chose to watch instead of play
 
 private:
     QLineEdit *usernameInput;
     QPushButton *okButton;
+    QPushButton *spectateButton;
+    bool spectator = false;
 };
 
 #endif // USERNAMEDIALOG_H
@@ -0,0 +1,176 @@
+// arenaView.cpp
+#include "arenaView.h"
+#include <QPainter>
+#include <QPaintEvent>
+
+constexpr int BORDER_MARGIN = 5;  // room around the arena for the border
+constexpr int BORDER_THICKNESS = 5;
+constexpr int PLAYER_SIZE = 20;
+
+static const QVector<QColor> predefinedColors = {Qt::blue, QColor(255, 165, 0), Qt::green, Qt::red}; // Blue, Orange, Green, Red
+
+ArenaView::ArenaView(int sceneWidth, int sceneHeight, QWidget *parent)
+    : QWidget(parent),
+      sceneWidth(0),
+      sceneHeight(0)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent); // every pixel is painted, skip clearing to the style background
+
+    // Trail color of every possible owner id; opaque, so premultiplied is the plain value
+    trailPalette.resize(256);
+    for (int id = 0; id < trailPalette.size(); ++id) {
+        trailPalette[id] = predefinedColors[id % predefinedColors.size()].rgba();
+    }
+
+    setArenaSize(sceneWidth, sceneHeight);
+}
+
+void ArenaView::setArenaSize(int width, int height)
+{
+    sceneWidth = width;
+    sceneHeight = height;
+
+    int viewWidth = qMin(width, int(MAX_VIEW_WIDTH));
+    int viewHeight = qMin(height, int(MAX_VIEW_HEIGHT));
+    viewOrigin = QPoint((width - viewWidth) / 2, (height - viewHeight) / 2);
+    trailLayer = QImage(viewWidth, viewHeight, QImage::Format_ARGB32_Premultiplied);
+    trailLayer.fill(Qt::transparent);
+    rowLife.resize(viewWidth);
+    rowOwners.resize(viewWidth);
+
+    setFixedSize(viewWidth + 2 * BORDER_MARGIN, viewHeight + 2 * BORDER_MARGIN);
+    updateBorder();
+    update();
+}
+
+void ArenaView::updateBorder()
+{
+    // The arena's edges in widget pixels; on a small arena the whole border is in view
+    int left = BORDER_MARGIN - viewOrigin.x() - BORDER_THICKNESS / 2;
+    int top = BORDER_MARGIN - viewOrigin.y() - BORDER_THICKNESS / 2;
+    border = {
+        QRect(left, top, sceneWidth + BORDER_THICKNESS, BORDER_THICKNESS),               // top
+        QRect(left, top + sceneHeight, sceneWidth + BORDER_THICKNESS, BORDER_THICKNESS), // bottom
+        QRect(left, top, BORDER_THICKNESS, sceneHeight + BORDER_THICKNESS),              // left
+        QRect(left + sceneWidth, top, BORDER_THICKNESS, sceneHeight + BORDER_THICKNESS)  // right
+    };
+}
+
+void ArenaView::syncTrail(const TrailGrid &grid, const QRect &area)
+{
+    QRect part = area & trailLayer.rect().translated(viewOrigin) & QRect(0, 0, grid.width(), grid.height());
+    if (part.isEmpty()) {
+        return;
+    }
+
+    uchar *life = reinterpret_cast<uchar *>(rowLife.data());
+    uchar *owner = reinterpret_cast<uchar *>(rowOwners.data());
+    for (int y = part.top(); y <= part.bottom(); ++y) {
+        grid.readRow(part.left(), y, part.width(), life, owner);
+        QRgb *line = reinterpret_cast<QRgb *>(trailLayer.scanLine(y - viewOrigin.y())) + (part.left() - viewOrigin.x());
+        for (int x = 0; x < part.width(); ++x) {
+            line[x] = life[x] ? trailPalette[owner[x]] : 0;
+        }
+    }
+    markDirty(part.translated(-viewOrigin));
+}
+
+void ArenaView::clearTrails()
+{
+    trailLayer.fill(Qt::transparent);
+    update();
+}
+
+void ArenaView::setViewCenter(const QPointF &scenePos, const TrailGrid &grid)
+{
+    int viewWidth = trailLayer.width();
+    int viewHeight = trailLayer.height();
+    QPoint origin(qBound(0, qRound(scenePos.x() + sceneWidth / 2.0) - viewWidth / 2, sceneWidth - viewWidth),
+                  qBound(0, qRound(scenePos.y() + sceneHeight / 2.0) - viewHeight / 2, sceneHeight - viewHeight));
+    if (origin == viewOrigin) {
+        return;
+    }
+
+    // Scroll what is already drawn; copy() leaves the part that came from outside the old view transparent
+    QPoint shift = origin - viewOrigin;
+    trailLayer = trailLayer.copy(QRect(shift, trailLayer.size()));
+    viewOrigin = origin;
+
+    QRect view(viewOrigin, trailLayer.size());
+    QRect kept = view & view.translated(-shift);
+    if (kept.isEmpty()) {
+        syncTrail(grid, view);
+    } else {
+        // The exposed strips: full width rows above or below, then the columns beside what was kept
+        if (kept.top() > view.top()) {
+            syncTrail(grid, QRect(view.left(), view.top(), view.width(), kept.top() - view.top()));
+        }
+        if (kept.bottom() < view.bottom()) {
+            syncTrail(grid, QRect(view.left(), kept.bottom() + 1, view.width(), view.bottom() - kept.bottom()));
+        }
+        if (kept.left() > view.left()) {
+            syncTrail(grid, QRect(view.left(), kept.top(), kept.left() - view.left(), kept.height()));
+        }
+        if (kept.right() < view.right()) {
+            syncTrail(grid, QRect(kept.right() + 1, kept.top(), view.right() - kept.right(), kept.height()));
+        }
+    }
+
+    updateBorder();
+    update(); // everything moved
+}
+
+void ArenaView::setPlayers(const QVector<PlayerState> &newPlayers)
+{
+    for (const PlayerState &player : players) {
+        update(playerRect(player));
+    }
+    players = newPlayers;
+    for (const PlayerState &player : players) {
+        update(playerRect(player));
+    }
+}
+
+void ArenaView::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    QPoint origin(BORDER_MARGIN, BORDER_MARGIN);
+
+    // Only the dirty rectangles are composed, never the whole arena
+    for (const QRect &dirty : event->region()) {
+        painter.fillRect(dirty, Qt::black);
+        for (const QRect &side : border) {
+            QRect visible = side & dirty;
+            if (!visible.isEmpty()) {
+                painter.fillRect(visible, Qt::blue); // Use a blue brush for the border
+            }
+        }
+        QRect trailPart = dirty.translated(-origin) & trailLayer.rect();
+        if (!trailPart.isEmpty()) {
+            painter.drawImage(trailPart.translated(origin), trailLayer, trailPart);
+        }
+    }
+
+    painter.setClipRegion(event->region());
+    painter.setPen(Qt::white);
+    for (const PlayerState &player : players) {
+        QRect area = playerRect(player);
+        if (!event->region().intersects(area)) {
+            continue;
+        }
+        painter.setBrush(player.alive ? predefinedColors[player.id % predefinedColors.size()] : QColor(Qt::gray));
+        painter.drawRect(area.adjusted(0, 0, -1, -1));
+    }
+}
+
+QRect ArenaView::playerRect(const PlayerState &player) const
+{
+    QRectF sceneRect(player.x - PLAYER_SIZE / 2.0, player.y - PLAYER_SIZE / 2.0, PLAYER_SIZE, PLAYER_SIZE);
+    return sceneRect.translated(sceneWidth / 2.0 + BORDER_MARGIN - viewOrigin.x(), sceneHeight / 2.0 + BORDER_MARGIN - viewOrigin.y())
+        .toAlignedRect().adjusted(0, 0, 1, 1);
+}
+
+void ArenaView::markDirty(const QRect &imageRect)
+{
+    update(imageRect.translated(BORDER_MARGIN, BORDER_MARGIN));
+}
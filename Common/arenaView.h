@@ -0,0 +1,63 @@
+// arenaView.h
+
+#ifndef ARENAVIEW_H
+#define ARENAVIEW_H
+
+#include <QWidget>
+#include <QImage>
+#include <QPoint>
+#include <QPointF>
+#include <QByteArray>
+#include <QVector>
+#include <QColor>
+#include "snapshot.h"
+#include "trailGrid.h"
+
+// Software renderer for the arena, used by both the server's game window and
+// the client. Trails live in an offscreen image that is only touched where the
+// trail grid changed, and only those regions are repainted, so the cost of a
+// frame does not grow with the length of the trails. Arenas larger than the
+// widget are shown through a viewport that can follow a player.
+class ArenaView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_VIEW_WIDTH = 800; // the widget never shows more of the arena than this
+    static constexpr int MAX_VIEW_HEIGHT = 600;
+
+    ArenaView(int sceneWidth, int sceneHeight, QWidget *parent = nullptr);
+
+    void setArenaSize(int sceneWidth, int sceneHeight); // resizes the widget, clears the trails and centers the view
+
+    // Copy part of the trail grid (grid cells, same size as the arena) into the trail image;
+    // only the part inside the viewport is read
+    void syncTrail(const TrailGrid &grid, const QRect &area);
+    void clearTrails();
+
+    // Move the viewport so the scene point is as close to its center as the arena allows.
+    // What was already drawn is scrolled, only the newly exposed strips are read from the grid.
+    void setViewCenter(const QPointF &scenePos, const TrailGrid &grid);
+
+    void setPlayers(const QVector<PlayerState> &newPlayers); // repaints only where players were or now are
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QRect playerRect(const PlayerState &player) const; // widget pixels covered by a player, pen included
+    void markDirty(const QRect &imageRect);
+    void updateBorder(); // where the border falls in the widget for the current viewport
+
+    int sceneWidth;
+    int sceneHeight;
+    QPoint viewOrigin;       // grid cell shown at the top left of the trail layer
+    QVector<QRect> border;   // widget rectangles of the border sides, some may be out of view
+    QImage trailLayer;       // one pixel per scene unit of the viewport, transparent where there is no trail
+    QByteArray rowLife;      // scratch for one row read from the grid
+    QByteArray rowOwners;
+    QVector<QRgb> trailPalette; // indexed by trail owner
+    QVector<PlayerState> players;
+};
+
+#endif // ARENAVIEW_H
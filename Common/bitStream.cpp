@@ -0,0 +1,100 @@
+// bitStream.cpp
+#include "bitStream.h"
+
+constexpr int VARINT_GROUP_BITS = 7;
+
+void BitWriter::writeBits(quint32 value, int count)
+{
+    if (count <= 0) {
+        return;
+    }
+    quint64 mask = (quint64(1) << count) - 1;
+    pending |= (quint64(value) & mask) << pendingBits;
+    pendingBits += count;
+    while (pendingBits >= 8) {
+        bytes.append(char(pending & 0xFF));
+        pending >>= 8;
+        pendingBits -= 8;
+    }
+}
+
+void BitWriter::writeVarint(quint32 value)
+{
+    while (value >= (1u << VARINT_GROUP_BITS)) {
+        writeBits((value & ((1u << VARINT_GROUP_BITS) - 1)) | (1u << VARINT_GROUP_BITS), VARINT_GROUP_BITS + 1);
+        value >>= VARINT_GROUP_BITS;
+    }
+    writeBits(value, VARINT_GROUP_BITS + 1);
+}
+
+void BitWriter::writeBytes(const QByteArray &data)
+{
+    for (char byte : data) {
+        writeBits(quint8(byte), 8);
+    }
+}
+
+QByteArray BitWriter::finish()
+{
+    if (pendingBits > 0) {
+        bytes.append(char(pending & 0xFF));
+        pending = 0;
+        pendingBits = 0;
+    }
+    return bytes;
+}
+
+BitReader::BitReader(const QByteArray &bytes)
+    : data(bytes)
+{
+}
+
+quint32 BitReader::readBits(int count)
+{
+    if (count <= 0) {
+        return 0;
+    }
+    if (bitPosition + count > qint64(data.size()) * 8) {
+        overrun = true;
+        return 0;
+    }
+
+    quint32 value = 0;
+    for (int read = 0; read < count;) {
+        int byteIndex = int(bitPosition >> 3);
+        int offset = int(bitPosition & 7);
+        int take = qMin(8 - offset, count - read);
+        quint32 bits = (quint8(data.at(byteIndex)) >> offset) & ((1u << take) - 1);
+        value |= bits << read;
+        read += take;
+        bitPosition += take;
+    }
+    return value;
+}
+
+quint32 BitReader::readVarint()
+{
+    quint32 value = 0;
+    for (int shift = 0; shift < 32; shift += VARINT_GROUP_BITS) {
+        quint32 group = readBits(VARINT_GROUP_BITS + 1);
+        value |= (group & ((1u << VARINT_GROUP_BITS) - 1)) << shift;
+        if (!(group & (1u << VARINT_GROUP_BITS)) || overrun) {
+            return value;
+        }
+    }
+    overrun = true; // longer than any 32 bit value
+    return value;
+}
+
+QByteArray BitReader::readBytes(int count)
+{
+    if (count < 0 || bitPosition + qint64(count) * 8 > qint64(data.size()) * 8) {
+        overrun = true;
+        return QByteArray();
+    }
+    QByteArray bytes(count, Qt::Uninitialized);
+    for (int i = 0; i < count; ++i) {
+        bytes[i] = char(readBits(8));
+    }
+    return bytes;
+}
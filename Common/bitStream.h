@@ -0,0 +1,49 @@
+// bitStream.h
+
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+// Packs values into exactly as many bits as they need, least significant bit first.
+// Used by the snapshot and keyframe codecs, where most fields are a few bits wide.
+class BitWriter
+{
+public:
+    void writeBits(quint32 value, int count); // the low count bits of value, count is at most 32
+    void writeBool(bool value) { writeBits(value ? 1 : 0, 1); }
+    void writeVarint(quint32 value); // 7 bits at a time, small numbers take one group
+    void writeBytes(const QByteArray &bytes);
+    QByteArray finish(); // pads the last byte with zeros
+
+private:
+    QByteArray bytes;
+    quint64 pending = 0; // bits not yet written to bytes
+    int pendingBits = 0;
+};
+
+class BitReader
+{
+public:
+    explicit BitReader(const QByteArray &bytes);
+
+    quint32 readBits(int count); // 0 once past the end, check ok()
+    bool readBool() { return readBits(1) != 0; }
+    quint32 readVarint();
+    QByteArray readBytes(int count);
+    bool ok() const { return !overrun; } // false if anything was read past the end
+
+private:
+    const QByteArray data;
+    qint64 bitPosition = 0;
+    bool overrun = false;
+};
+
+// Bits needed to store any value from 0 to maxValue
+constexpr int bitsFor(quint32 maxValue)
+{
+    return maxValue ? 1 + bitsFor(maxValue >> 1) : 0;
+}
+
+#endif // BITSTREAM_H
@@ -0,0 +1,78 @@
+// datagram.cpp
+#include "datagram.h"
+#include <QDataStream>
+
+constexpr quint8 DATAGRAM_MAGIC = 0x54; // 'T', cheap filter for stray packets
+constexpr int MAX_INPUTS_PER_DATAGRAM = 16;
+
+QByteArray Datagram::encode() const
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out << DATAGRAM_MAGIC << quint8(type);
+
+    switch (type) {
+    case Hello:
+    case HelloAck:
+        out << token;
+        break;
+    case Input: {
+        int count = qMin(inputs.size(), MAX_INPUTS_PER_DATAGRAM);
+        out << token << quint8(count);
+        for (int i = inputs.size() - count; i < inputs.size(); ++i) { // keep the newest ones
+            out << inputs[i].sequence << quint8(inputs[i].key) << inputs[i].tick;
+        }
+        break;
+    }
+    case State:
+        out.writeRawData(payload.constData(), payload.size());
+        break;
+    case Invalid:
+        return QByteArray();
+    }
+    return bytes;
+}
+
+Datagram Datagram::parse(const QByteArray &bytes)
+{
+    Datagram datagram;
+    QDataStream in(bytes);
+
+    quint8 magic = 0;
+    quint8 type = Invalid;
+    in >> magic >> type;
+    if (in.status() != QDataStream::Ok || magic != DATAGRAM_MAGIC) {
+        return datagram;
+    }
+
+    switch (type) {
+    case Hello:
+    case HelloAck:
+        in >> datagram.token;
+        break;
+    case Input: {
+        quint8 count = 0;
+        in >> datagram.token >> count;
+        if (count > MAX_INPUTS_PER_DATAGRAM) {
+            return datagram;
+        }
+        datagram.inputs.resize(count);
+        for (InputEntry &entry : datagram.inputs) {
+            quint8 key = 0;
+            in >> entry.sequence >> key >> entry.tick;
+            entry.key = char(key);
+        }
+        break;
+    }
+    case State:
+        datagram.payload = bytes.mid(2);
+        break;
+    default:
+        return datagram;
+    }
+
+    if (in.status() == QDataStream::Ok) {
+        datagram.type = Type(type);
+    }
+    return datagram;
+}
@@ -0,0 +1,38 @@
+// datagram.h
+
+#ifndef DATAGRAM_H
+#define DATAGRAM_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+// One packet on the optional UDP channel. TCP still carries the lobby, chat,
+// ready state and GAME_START/GAME_END; UDP only carries movement and state.
+class Datagram
+{
+public:
+    enum Type : quint8 {
+        Invalid = 0,
+        Hello,      // client -> server, proves the client owns the token it got over TCP
+        HelloAck,   // server -> client, the channel is usable
+        Input,      // client -> server, the most recent turns (sent redundantly)
+        State       // server -> client, an encoded snapshot, never resent
+    };
+
+    struct InputEntry {
+        quint32 sequence = 0; // increases by one per turn, lets the server drop duplicates
+        char key = 0;         // W, A, S or D like the PLAYERMOVE message
+        qint32 tick = -1;     // server tick on the player's screen when they turned, -1 if not known
+    };
+
+    Type type = Invalid;
+    quint64 token = 0;               // session token, unused for State
+    QVector<InputEntry> inputs;      // Input only
+    QByteArray payload;              // State only
+
+    QByteArray encode() const;
+    static Datagram parse(const QByteArray &bytes); // type is Invalid if the bytes are not ours
+};
+
+#endif // DATAGRAM_H
@@ -0,0 +1,49 @@
+// keyframe.cpp
+#include "keyframe.h"
+#include "bitStream.h"
+
+constexpr quint32 MAX_ARENA_SIDE = 20000; // the largest arena a server runs, anything larger is a damaged payload
+
+QByteArray Keyframe::encode() const
+{
+    BitWriter out;
+    out.writeVarint(quint32(trails.width()));
+    out.writeVarint(quint32(trails.height()));
+    out.writeVarint(msUntilDecay);
+
+    QByteArray players = snapshot.encode();
+    out.writeVarint(quint32(players.size()));
+    out.writeBytes(players);
+
+    trailLog.encode(&out, trails.width(), trails.height());
+    return out.finish();
+}
+
+bool Keyframe::decode(const QByteArray &bytes, Keyframe *keyframe)
+{
+    BitReader in(bytes);
+    quint32 width = in.readVarint();
+    quint32 height = in.readVarint();
+    keyframe->msUntilDecay = quint16(in.readVarint());
+    if (!in.ok() || width > MAX_ARENA_SIDE || height > MAX_ARENA_SIDE) {
+        return false;
+    }
+
+    quint32 playersSize = in.readVarint();
+    if (!in.ok() || playersSize > quint32(bytes.size())) {
+        return false;
+    }
+    QByteArray players = in.readBytes(int(playersSize));
+    if (!in.ok() || !Snapshot::decode(players, &keyframe->snapshot)) {
+        return false;
+    }
+
+    if (!keyframe->trailLog.decode(&in, int(width), int(height))) {
+        return false;
+    }
+
+    // The grid as the sender had it at the keyframe's tick
+    keyframe->trails = TrailGrid(int(width), int(height));
+    keyframe->trailLog.replay(&keyframe->trails, keyframe->snapshot.tick);
+    return true;
+}
@@ -0,0 +1,27 @@
+// keyframe.h
+
+#ifndef KEYFRAME_H
+#define KEYFRAME_H
+
+#include <QByteArray>
+#include <QVector>
+#include "snapshot.h"
+#include "trailGrid.h"
+#include "trailLog.h"
+
+// Full match state: enough for a client that missed the start to draw the
+// arena, after which ordinary snapshots keep it up to date. Only the trail runs
+// go over the wire; the receiver replays them into its own grid.
+class Keyframe
+{
+public:
+    Snapshot snapshot;
+    TrailLog trailLog;  // what is sent
+    TrailGrid trails;   // filled in by decode; the sender only needs its size
+    quint16 msUntilDecay = 0; // time left until the grid next ages, keeps the receiver in step
+
+    QByteArray encode() const; // bit packed, a few hundred bytes for a four player match
+    static bool decode(const QByteArray &bytes, Keyframe *keyframe);
+};
+
+#endif // KEYFRAME_H
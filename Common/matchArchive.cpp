@@ -0,0 +1,191 @@
+// matchArchive.cpp
+#include "matchArchive.h"
+#include <QtEndian>
+#include <QDateTime>
+#include <QDebug>
+#include <cstring>
+
+constexpr quint16 ARCHIVE_VERSION = 1;
+constexpr int HEADER_SIZE = 24;       // magic, version, tick length, width, height, reserved, start time
+constexpr int CHUNK_HEADER_SIZE = 12; // type, 3 reserved, tick, payload length
+constexpr int INDEX_ENTRY_SIZE = 16;  // tick, reserved, offset
+constexpr int FOOTER_SIZE = 16;       // index offset, entry count, magic
+constexpr quint32 MAX_CHUNK_SIZE = 64 * 1024 * 1024; // anything larger is a damaged length field
+
+static const char HEADER_MAGIC[4] = {'T', 'R', 'N', 'A'};
+static const char FOOTER_MAGIC[4] = {'T', 'R', 'N', 'I'};
+
+MatchArchiveWriter::~MatchArchiveWriter()
+{
+    if (file.isOpen()) {
+        finish();
+    }
+}
+
+bool MatchArchiveWriter::open(const QString &path, int arenaWidth, int arenaHeight, int tickIntervalMs)
+{
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot record match to" << path << ":" << file.errorString();
+        return false;
+    }
+    index.clear();
+
+    uchar header[HEADER_SIZE] = {};
+    memcpy(header, HEADER_MAGIC, 4);
+    qToLittleEndian<quint16>(ARCHIVE_VERSION, header + 4);
+    qToLittleEndian<quint16>(quint16(tickIntervalMs), header + 6);
+    qToLittleEndian<quint16>(quint16(arenaWidth), header + 8);
+    qToLittleEndian<quint16>(quint16(arenaHeight), header + 10);
+    qToLittleEndian<qint64>(QDateTime::currentMSecsSinceEpoch(), header + 16);
+    file.write(reinterpret_cast<const char *>(header), HEADER_SIZE);
+    return true;
+}
+
+void MatchArchiveWriter::write(MatchArchive::ChunkType type, quint32 tick, const QByteArray &payload)
+{
+    if (!file.isOpen()) {
+        return;
+    }
+    if (type == MatchArchive::Keyframe) {
+        index.append({tick, file.pos()});
+    }
+
+    uchar header[CHUNK_HEADER_SIZE] = {};
+    header[0] = type;
+    qToLittleEndian<quint32>(tick, header + 4);
+    qToLittleEndian<quint32>(quint32(payload.size()), header + 8);
+    file.write(reinterpret_cast<const char *>(header), CHUNK_HEADER_SIZE);
+    file.write(payload);
+}
+
+bool MatchArchiveWriter::finish()
+{
+    if (!file.isOpen()) {
+        return false;
+    }
+
+    qint64 indexStart = file.pos();
+    QByteArray entries(index.size() * INDEX_ENTRY_SIZE, '\0');
+    uchar *entry = reinterpret_cast<uchar *>(entries.data());
+    for (const IndexEntry &keyframe : index) {
+        qToLittleEndian<quint32>(keyframe.tick, entry);
+        qToLittleEndian<qint64>(keyframe.offset, entry + 8);
+        entry += INDEX_ENTRY_SIZE;
+    }
+    file.write(entries);
+
+    uchar footer[FOOTER_SIZE] = {};
+    qToLittleEndian<qint64>(indexStart, footer);
+    qToLittleEndian<quint32>(quint32(index.size()), footer + 8);
+    memcpy(footer + 12, FOOTER_MAGIC, 4);
+    file.write(reinterpret_cast<const char *>(footer), FOOTER_SIZE);
+
+    bool ok = file.error() == QFileDevice::NoError;
+    file.close();
+    index.clear();
+    return ok;
+}
+
+MatchArchiveReader::~MatchArchiveReader()
+{
+    close();
+}
+
+bool MatchArchiveReader::open(const QString &path)
+{
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open match archive" << path << ":" << file.errorString();
+        return false;
+    }
+
+    size = file.size();
+    data = size >= HEADER_SIZE + FOOTER_SIZE ? file.map(0, size) : nullptr;
+    if (!data || memcmp(data, HEADER_MAGIC, 4) != 0 || qFromLittleEndian<quint16>(data + 4) != ARCHIVE_VERSION
+        || memcmp(data + size - 4, FOOTER_MAGIC, 4) != 0) {
+        qWarning() << "Not a finished match archive:" << path;
+        close();
+        return false;
+    }
+
+    tickMs = qFromLittleEndian<quint16>(data + 6);
+    width = qFromLittleEndian<quint16>(data + 8);
+    height = qFromLittleEndian<quint16>(data + 10);
+    startedAt = qFromLittleEndian<qint64>(data + 16);
+
+    const uchar *footer = data + size - FOOTER_SIZE;
+    chunksEnd = qFromLittleEndian<qint64>(footer);
+    quint32 entries = qFromLittleEndian<quint32>(footer + 8);
+    if (chunksEnd < HEADER_SIZE || chunksEnd + qint64(entries) * INDEX_ENTRY_SIZE != size - FOOTER_SIZE) {
+        qWarning() << "Damaged index in match archive:" << path;
+        close();
+        return false;
+    }
+    entryCount = int(entries);
+    return true;
+}
+
+void MatchArchiveReader::close()
+{
+    if (data) {
+        file.unmap(const_cast<uchar *>(data));
+    }
+    file.close();
+    data = nullptr;
+    size = 0;
+    chunksEnd = 0;
+    entryCount = 0;
+}
+
+quint32 MatchArchiveReader::keyframeTick(int i) const
+{
+    return qFromLittleEndian<quint32>(data + chunksEnd + qint64(i) * INDEX_ENTRY_SIZE);
+}
+
+qint64 MatchArchiveReader::indexOffset(int i) const
+{
+    return qFromLittleEndian<qint64>(data + chunksEnd + qint64(i) * INDEX_ENTRY_SIZE + 8);
+}
+
+qint64 MatchArchiveReader::seek(quint32 tick) const
+{
+    if (entryCount == 0) {
+        return -1;
+    }
+
+    // First keyframe after the tick, the one before it is where playback starts
+    int low = 0;
+    int high = entryCount;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (keyframeTick(middle) <= tick) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return indexOffset(qMax(0, low - 1));
+}
+
+bool MatchArchiveReader::readChunk(qint64 *offset, MatchArchive::Chunk *chunk) const
+{
+    qint64 at = *offset;
+    if (!data || at < HEADER_SIZE || at + CHUNK_HEADER_SIZE > chunksEnd) {
+        return false;
+    }
+
+    const uchar *header = data + at;
+    quint32 length = qFromLittleEndian<quint32>(header + 8);
+    if (header[0] < MatchArchive::Keyframe || header[0] > MatchArchive::Input
+        || length > MAX_CHUNK_SIZE || at + CHUNK_HEADER_SIZE + length > chunksEnd) {
+        return false;
+    }
+
+    chunk->type = MatchArchive::ChunkType(header[0]);
+    chunk->tick = qFromLittleEndian<quint32>(header + 4);
+    chunk->payload = QByteArray::fromRawData(reinterpret_cast<const char *>(header + CHUNK_HEADER_SIZE), int(length));
+    *offset = at + CHUNK_HEADER_SIZE + length;
+    return true;
+}
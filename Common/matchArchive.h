@@ -0,0 +1,96 @@
+// matchArchive.h
+
+#ifndef MATCHARCHIVE_H
+#define MATCHARCHIVE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// Recorded match on disk, all integers little endian:
+//
+//   header   "TRNA", version, tick length, arena size, start time
+//   chunks   type, tick, length, payload; keyframes every second or so with
+//            snapshots and turns in between, in tick order
+//   index    tick and file offset of every keyframe
+//   footer   index offset, index size, "TRNI"
+//
+// The index sits at the end so the writer never has to go back; a reader finds
+// it through the fixed size footer, then binary searches it to start at any tick.
+namespace MatchArchive {
+
+enum ChunkType : quint8 {
+    Keyframe = 1, // encoded Keyframe, players plus the whole trail grid
+    Snapshot = 2, // encoded Snapshot, player positions since the last keyframe
+    Input = 3     // player id and key of a turn received after this tick
+};
+
+struct Chunk {
+    ChunkType type = Keyframe;
+    quint32 tick = 0;
+    QByteArray payload; // points into the reader's mapping, copy it to keep it past close()
+};
+
+} // namespace MatchArchive
+
+class MatchArchiveWriter
+{
+public:
+    MatchArchiveWriter() = default;
+    ~MatchArchiveWriter(); // finishes the archive if still open
+
+    bool open(const QString &path, int arenaWidth, int arenaHeight, int tickIntervalMs);
+    bool isOpen() const { return file.isOpen(); }
+    void write(MatchArchive::ChunkType type, quint32 tick, const QByteArray &payload);
+    bool finish(); // index and footer; without them the reader rejects the file
+
+private:
+    struct IndexEntry {
+        quint32 tick;
+        qint64 offset;
+    };
+
+    QFile file;
+    QVector<IndexEntry> index;
+};
+
+class MatchArchiveReader
+{
+public:
+    MatchArchiveReader() = default;
+    ~MatchArchiveReader();
+
+    bool open(const QString &path); // maps the file, nothing else is read until asked for
+    void close();
+
+    int arenaWidth() const { return width; }
+    int arenaHeight() const { return height; }
+    int tickIntervalMs() const { return tickMs; }
+    qint64 startedAtMs() const { return startedAt; } // since the epoch
+
+    int keyframeCount() const { return entryCount; }
+    quint32 keyframeTick(int i) const;
+
+    // Offset of the last keyframe at or before tick, or of the first one if the tick is earlier; -1 if there are none
+    qint64 seek(quint32 tick) const;
+    // Chunk at *offset, which is moved on to the next one; false past the last chunk or on a damaged one
+    bool readChunk(qint64 *offset, MatchArchive::Chunk *chunk) const;
+
+private:
+    qint64 indexOffset(int i) const;
+
+    QFile file;
+    const uchar *data = nullptr;
+    qint64 size = 0;
+    qint64 chunksEnd = 0; // where the index starts
+    int entryCount = 0;
+
+    int width = 0;
+    int height = 0;
+    int tickMs = 0;
+    qint64 startedAt = 0;
+};
+
+#endif // MATCHARCHIVE_H
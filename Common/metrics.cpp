@@ -0,0 +1,99 @@
+// metrics.cpp
+#include "metrics.h"
+#include <atomic>
+#include <cmath>
+
+constexpr int MAX_THREAD_SLOTS = 64; // threads past this share the last slot, still correct, just contended
+
+namespace {
+
+struct alignas(64) CounterSlot {
+    std::atomic<quint64> values[Metrics::CounterCount];
+};
+
+// Zero initialised before any code runs, so counting works even during static initialisation
+CounterSlot counterSlots[MAX_THREAD_SLOTS];
+std::atomic<int> slotsTaken(0);
+thread_local int threadSlot = -1;
+
+QByteArray formatValue(double value)
+{
+    if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        return QByteArray::number(qint64(value));
+    }
+    return QByteArray::number(value, 'g', 12);
+}
+
+} // namespace
+
+void Metrics::add(Counter counter, quint64 amount)
+{
+    if (threadSlot < 0) {
+        threadSlot = qMin(slotsTaken.fetch_add(1, std::memory_order_relaxed), MAX_THREAD_SLOTS - 1);
+    }
+    counterSlots[threadSlot].values[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+quint64 Metrics::total(Counter counter)
+{
+    int used = qMin(slotsTaken.load(std::memory_order_relaxed), MAX_THREAD_SLOTS);
+    quint64 sum = 0;
+    for (int i = 0; i < used; ++i) {
+        sum += counterSlots[i].values[counter].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+DurationHistogram::DurationHistogram()
+    : buckets(bounds().size() + 1, 0)
+{
+}
+
+const QVector<double> &DurationHistogram::bounds() const
+{
+    // A tick is 10 ms, so the interesting range is well below that
+    static const QVector<double> upperBounds = {0.0001, 0.00025, 0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05};
+    return upperBounds;
+}
+
+void DurationHistogram::observe(qint64 nanoseconds)
+{
+    double seconds = nanoseconds / 1e9;
+    const QVector<double> &upperBounds = bounds();
+    int bucket = 0;
+    while (bucket < upperBounds.size() && seconds > upperBounds[bucket]) {
+        ++bucket;
+    }
+    ++buckets[bucket];
+    ++observations;
+    totalNanoseconds += quint64(qMax<qint64>(0, nanoseconds));
+}
+
+void MetricsText::family(const QByteArray &name, const char *type, const char *help)
+{
+    body += "# HELP " + name + ' ' + help + '\n';
+    body += "# TYPE " + name + ' ' + type + '\n';
+}
+
+void MetricsText::sample(const QByteArray &name, double value, const QByteArray &labels)
+{
+    body += name;
+    if (!labels.isEmpty()) {
+        body += '{' + labels + '}';
+    }
+    body += ' ' + formatValue(value) + '\n';
+}
+
+void MetricsText::histogram(const QByteArray &name, const DurationHistogram &histogram, const QByteArray &labels)
+{
+    QByteArray prefix = labels.isEmpty() ? QByteArray() : labels + ',';
+    QByteArray bucketName = name + "_bucket";
+    quint64 cumulative = 0;
+    for (int i = 0; i < histogram.bounds().size(); ++i) {
+        cumulative += histogram.bucketCounts()[i];
+        sample(bucketName, double(cumulative), prefix + "le=\"" + formatValue(histogram.bounds()[i]) + '"');
+    }
+    sample(bucketName, double(histogram.count()), prefix + "le=\"+Inf\"");
+    sample(name + "_sum", histogram.sumSeconds(), labels);
+    sample(name + "_count", double(histogram.count()), labels);
+}
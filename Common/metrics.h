@@ -0,0 +1,70 @@
+// metrics.h
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QVector>
+
+// Process wide counters for the metrics endpoint. Every thread adds to its own
+// cache line of atomics, so counting never takes a lock and threads never share
+// a line; reading sums the lines. Nothing here allocates, so it can be used from
+// inside operator new.
+class Metrics
+{
+public:
+    enum Counter {
+        TcpBytesIn,
+        TcpBytesOut,
+        UdpBytesIn,
+        UdpBytesOut,
+        InputMessages,     // turns received, TCP or UDP
+        InputsDropped,     // turns over a connection's rate limit
+        TurnsRewound,      // late turns applied at the tick they were made
+        SnapshotMessages,  // snapshots sent, one per recipient
+        SnapshotsSkipped,  // snapshots not queued for a client that fell behind
+        DbWrites,
+        DbWriteNanoseconds,
+        Allocations,
+        Deallocations,
+        CounterCount
+    };
+
+    static void add(Counter counter, quint64 amount = 1);
+    static quint64 total(Counter counter); // over every thread
+};
+
+// Fixed bucket histogram of durations, written by one thread and read by the same
+// thread when the endpoint is scraped.
+class DurationHistogram
+{
+public:
+    DurationHistogram();
+
+    void observe(qint64 nanoseconds);
+    const QVector<double> &bounds() const; // upper bounds in seconds, +Inf is implied
+    const QVector<quint64> &bucketCounts() const { return buckets; } // not cumulative, last one is +Inf
+    quint64 count() const { return observations; }
+    double sumSeconds() const { return totalNanoseconds / 1e9; }
+
+private:
+    QVector<quint64> buckets;
+    quint64 observations = 0;
+    quint64 totalNanoseconds = 0;
+};
+
+// Text exposition format, one metric family at a time
+class MetricsText
+{
+public:
+    void family(const QByteArray &name, const char *type, const char *help);
+    void sample(const QByteArray &name, double value, const QByteArray &labels = QByteArray());
+    void histogram(const QByteArray &name, const DurationHistogram &histogram, const QByteArray &labels = QByteArray());
+    const QByteArray &text() const { return body; }
+
+private:
+    QByteArray body;
+};
+
+#endif // METRICS_H
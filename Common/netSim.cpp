@@ -0,0 +1,105 @@
+// netSim.cpp
+#include "netSim.h"
+#include <QDebug>
+#include <algorithm>
+
+bool NetSimConfig::isActive() const
+{
+    return latencyMs > 0 || jitterMs > 0 || lossPercent > 0 || reorderPercent > 0 || bandwidthKbps > 0;
+}
+
+NetSimConfig NetSimConfig::fromEnvironment()
+{
+    NetSimConfig config;
+    config.latencyMs = qMax(0, qEnvironmentVariableIntValue("TRON_SIM_LATENCY"));
+    config.jitterMs = qMax(0, qEnvironmentVariableIntValue("TRON_SIM_JITTER"));
+    config.lossPercent = qBound(0, qEnvironmentVariableIntValue("TRON_SIM_LOSS"), 100);
+    config.reorderPercent = qBound(0, qEnvironmentVariableIntValue("TRON_SIM_REORDER"), 100);
+    config.bandwidthKbps = qMax(0, qEnvironmentVariableIntValue("TRON_SIM_BANDWIDTH"));
+    config.seed = qgetenv("TRON_SIM_SEED").toUInt();
+    return config;
+}
+
+NetSim::NetSim(Mode mode, const NetSimConfig &config, QObject *parent)
+    : QObject(parent),
+      mode(mode),
+      conditions(config),
+      usedSeed(config.seed ? config.seed : QRandomGenerator::global()->generate()),
+      random(usedSeed),
+      timer(new QTimer(this))
+{
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &NetSim::deliverDue);
+    clock.start();
+
+    if (conditions.isActive()) {
+        qDebug() << "NetSim" << (mode == Stream ? "stream" : "datagrams")
+                 << "latency" << conditions.latencyMs << "jitter" << conditions.jitterMs
+                 << "loss" << conditions.lossPercent << "reorder" << conditions.reorderPercent
+                 << "bandwidth" << conditions.bandwidthKbps << "seed" << usedSeed;
+    }
+}
+
+void NetSim::transmit(int bytes, const std::function<void()> &deliver)
+{
+    if (!conditions.isActive()) {
+        deliver(); // perfect link, no queueing at all
+        return;
+    }
+
+    // Draw every random number up front so the sequence only depends on the seed and call order
+    bool lost = random.bounded(100) < conditions.lossPercent;
+    int jitter = conditions.jitterMs > 0 ? random.bounded(2 * conditions.jitterMs + 1) - conditions.jitterMs : 0;
+    bool reordered = random.bounded(100) < conditions.reorderPercent;
+    int holdBack = random.bounded(qMax(conditions.jitterMs, 10) * 2) + 1;
+
+    if (mode == Datagrams && lost) {
+        return;
+    }
+
+    qint64 now = clock.elapsed();
+
+    // Bandwidth cap: the data has to wait for the wire and then takes time to send
+    qint64 sentAt = now;
+    if (conditions.bandwidthKbps > 0) {
+        qint64 transmitMs = (qint64(bytes) * 8 + conditions.bandwidthKbps - 1) / conditions.bandwidthKbps;
+        sentAt = qMax(now, linkFreeAtMs) + transmitMs;
+        linkFreeAtMs = sentAt;
+    }
+
+    qint64 due = sentAt + qMax(0, conditions.latencyMs + jitter);
+    if (mode == Datagrams && reordered) {
+        due += holdBack; // lets packets sent after this one overtake it
+    }
+    if (mode == Stream) {
+        due = qMax(due, lastStreamDueMs); // jitter never reorders a stream
+        lastStreamDueMs = due;
+    }
+
+    Pending pending{due, nextOrder++, deliver};
+    auto position = std::upper_bound(queue.begin(), queue.end(), pending, [](const Pending &a, const Pending &b) {
+        return a.dueMs < b.dueMs || (a.dueMs == b.dueMs && a.order < b.order);
+    });
+    queue.insert(position, pending);
+    schedule();
+}
+
+void NetSim::deliverDue()
+{
+    qint64 now = clock.elapsed();
+    while (!queue.isEmpty() && queue.first().dueMs <= now) {
+        Pending pending = queue.takeFirst();
+        pending.deliver(); // may call transmit() again, the queue stays consistent
+    }
+    schedule();
+}
+
+void NetSim::schedule()
+{
+    if (queue.isEmpty()) {
+        timer->stop();
+        return;
+    }
+    timer->start(int(qMax<qint64>(0, queue.first().dueMs - clock.elapsed())));
+}
@@ -0,0 +1,75 @@
+// netSim.h
+
+#ifndef NETSIM_H
+#define NETSIM_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <functional>
+
+// Link conditions to simulate. All zero means a perfect link and no overhead.
+struct NetSimConfig
+{
+    int latencyMs = 0;      // one way delay added to everything
+    int jitterMs = 0;       // uniform +/- variation on top of the latency
+    int lossPercent = 0;    // datagrams only, streams never lose data
+    int reorderPercent = 0; // datagrams only, chance of holding one back past its successors
+    int bandwidthKbps = 0;  // 0 is unlimited
+    quint32 seed = 0;       // 0 picks a random seed, which is logged so the run can be repeated
+
+    bool isActive() const;
+    static NetSimConfig fromEnvironment(); // TRON_SIM_LATENCY, _JITTER, _LOSS, _REORDER, _BANDWIDTH, _SEED
+};
+
+// Delays, drops and reorders deliveries the way a bad network link would.
+// Each end of a connection routes what it receives through one of these, so
+// running both client and server with the same settings simulates both
+// directions of the link on a single machine.
+class NetSim : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Mode {
+        Datagrams, // may lose and reorder, like UDP
+        Stream     // delayed and rate limited but always complete and in order, like TCP
+    };
+
+    NetSim(Mode mode, const NetSimConfig &config, QObject *parent = nullptr);
+
+    // Runs deliver once the simulated link would have delivered bytes, or never if it was lost
+    void transmit(int bytes, const std::function<void()> &deliver);
+
+    const NetSimConfig &config() const { return conditions; }
+    int pending() const { return queue.size(); }
+    quint32 seed() const { return usedSeed; }
+
+private slots:
+    void deliverDue();
+
+private:
+    struct Pending {
+        qint64 dueMs;
+        quint64 order; // keeps equal due times in arrival order
+        std::function<void()> deliver;
+    };
+
+    void schedule();
+
+    Mode mode;
+    NetSimConfig conditions;
+    quint32 usedSeed;
+    QRandomGenerator random;
+    QElapsedTimer clock;
+    QTimer *timer;
+    QList<Pending> queue; // sorted by due time
+    qint64 linkFreeAtMs = 0;  // when the simulated wire finishes sending what is already on it
+    qint64 lastStreamDueMs = 0;
+    quint64 nextOrder = 0;
+};
+
+#endif // NETSIM_H
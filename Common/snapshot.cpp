@@ -0,0 +1,74 @@
+// snapshot.cpp
+#include "snapshot.h"
+#include "bitStream.h"
+#include <cmath>
+
+constexpr int COORDINATE_WIDTH_BITS = 5; // how many bits each coordinate takes, sign included
+constexpr int MAX_COORDINATE_BITS = 22;  // far past any arena, anything wider is a damaged payload
+constexpr qint32 MAX_STEPS = (1 << (MAX_COORDINATE_BITS - 1)) - 1;
+constexpr int HEADING_BITS = 2;
+
+// Offset from the arena's center in steps
+static qint32 quantize(float coordinate)
+{
+    long steps = std::lround(double(coordinate) * Snapshot::STEPS_PER_UNIT);
+    return qint32(qBound(long(-MAX_STEPS), steps, long(MAX_STEPS)));
+}
+
+static float dequantize(qint32 steps)
+{
+    return float(double(steps) / Snapshot::STEPS_PER_UNIT);
+}
+
+QByteArray Snapshot::encode() const
+{
+    BitWriter out;
+    out.writeVarint(tick);
+    out.writeVarint(quint32(players.size()));
+
+    // The farthest player from the center sets the width, stored offset by half the range so it is never negative
+    qint32 farthest = 0;
+    for (const PlayerState &player : players) {
+        farthest = qMax(farthest, qMax(qAbs(quantize(player.x)), qAbs(quantize(player.y))));
+    }
+    const int coordinateBits = bitsFor(quint32(farthest)) + 1;
+    const qint32 bias = qint32(1) << (coordinateBits - 1);
+    out.writeBits(quint32(coordinateBits), COORDINATE_WIDTH_BITS);
+
+    for (const PlayerState &player : players) {
+        out.writeVarint(player.id);
+        out.writeBits(quint32(quantize(player.x) + bias), coordinateBits);
+        out.writeBits(quint32(quantize(player.y) + bias), coordinateBits);
+        out.writeBits(player.heading, HEADING_BITS);
+        out.writeBool(player.moving);
+        out.writeBool(player.alive);
+    }
+    return out.finish();
+}
+
+bool Snapshot::decode(const QByteArray &bytes, Snapshot *snapshot)
+{
+    BitReader in(bytes);
+    snapshot->tick = in.readVarint();
+    quint32 count = in.readVarint();
+    if (!in.ok() || count > quint32(bytes.size())) { // every player takes more than a byte
+        return false;
+    }
+
+    const int coordinateBits = int(in.readBits(COORDINATE_WIDTH_BITS));
+    if (!in.ok() || coordinateBits < 1 || coordinateBits > MAX_COORDINATE_BITS) {
+        return false;
+    }
+    const qint32 bias = qint32(1) << (coordinateBits - 1);
+
+    snapshot->players.resize(int(count));
+    for (PlayerState &player : snapshot->players) {
+        player.id = quint8(in.readVarint());
+        player.x = dequantize(qint32(in.readBits(coordinateBits)) - bias);
+        player.y = dequantize(qint32(in.readBits(coordinateBits)) - bias);
+        player.heading = quint8(in.readBits(HEADING_BITS));
+        player.moving = in.readBool();
+        player.alive = in.readBool();
+    }
+    return in.ok();
+}
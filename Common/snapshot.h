@@ -0,0 +1,38 @@
+// snapshot.h
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+// State of one player at a given server tick
+struct PlayerState
+{
+    quint8 id = 0;          // join order, also selects the player's color
+    float x = 0;            // scene coordinates, the arena is centered on (0, 0)
+    float y = 0;
+    quint8 heading = 0;     // Up, Down, Left, Right in the same order as Game::Direction
+    bool moving = false;    // false until the player's first turn
+    bool alive = true;      // false once the player has crashed
+};
+
+// Everything a client needs to draw the arena for one server tick. On the wire
+// positions are whole half units from the arena's center, which is all the server
+// ever produces with its speed of 1.5, so they arrive exactly as they were sent.
+// Every snapshot says how many bits its coordinates take, so it does not depend
+// on the arena's size and small arenas pay for small numbers only.
+class Snapshot
+{
+public:
+    static constexpr int STEPS_PER_UNIT = 2;
+
+    quint32 tick = 0;
+    QVector<PlayerState> players;
+
+    QByteArray encode() const; // bit packed, about 4 bytes per player
+    static bool decode(const QByteArray &bytes, Snapshot *snapshot); // returns false on a malformed payload
+};
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,244 @@
+// trailGrid.cpp
+#include "trailGrid.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRAILGRID_SSE2
+#endif
+
+constexpr int SIMD_WIDTH = 16; // cells per SSE2 register
+
+// Decrement one row, saturating at 0. Returns true and the span of cells that reached 0
+// if any did; the span is found per block of 16, which is precise enough for a repaint.
+static bool decayRow(uchar *row, int width, int *firstExpired, int *lastExpired)
+{
+    int first = width;
+    int last = -1;
+    int x = 0;
+
+#ifdef TRAILGRID_SSE2
+    const __m128i one = _mm_set1_epi8(1);
+    for (; x + SIMD_WIDTH <= width; x += SIMD_WIDTH) {
+        __m128i cells = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(cells, one))) {
+            first = qMin(first, x);
+            last = x + SIMD_WIDTH - 1;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row + x), _mm_subs_epu8(cells, one));
+    }
+#endif
+
+    // Rest of the row, or all of it without SSE2; simple enough for the compiler to vectorize
+    for (; x < width; ++x) {
+        if (row[x] == 1) {
+            first = qMin(first, x);
+            last = x;
+        }
+        row[x] = row[x] ? uchar(row[x] - 1) : uchar(0);
+    }
+
+    *firstExpired = first;
+    *lastExpired = last;
+    return last >= 0;
+}
+
+TrailGrid::Chunk::Chunk()
+{
+    memset(life, 0, sizeof(life));
+    memset(owners, 0, sizeof(owners));
+}
+
+TrailGrid::TrailGrid(int width, int height)
+    : gridWidth(qMax(0, width)),
+      gridHeight(qMax(0, height)),
+      chunksAcross((gridWidth + CHUNK_SIZE - 1) / CHUNK_SIZE),
+      chunksDown((gridHeight + CHUNK_SIZE - 1) / CHUNK_SIZE),
+      chunks(chunksAcross * chunksDown)
+{
+}
+
+void TrailGrid::clear()
+{
+    for (int index : liveChunks) {
+        chunks[index] = QSharedDataPointer<Chunk>();
+    }
+    liveChunks.clear();
+}
+
+TrailGrid::Chunk *TrailGrid::writableChunk(int x, int y)
+{
+    int index = (y / CHUNK_SIZE) * chunksAcross + x / CHUNK_SIZE;
+    QSharedDataPointer<Chunk> &chunk = chunks[index];
+    if (!chunk) {
+        chunk = new Chunk;
+        liveChunks.append(index);
+    }
+    return chunk.data(); // copies it first if another grid shares it
+}
+
+bool TrailGrid::isOccupiedAt(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= gridWidth || y >= gridHeight) {
+        return false; // past the edge the index would land in another chunk, or outside them all
+    }
+    const Chunk *chunk = chunkAt(x, y);
+    return chunk && chunk->life[(y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE] != 0;
+}
+
+QRect TrailGrid::toGrid(const QRectF &sceneRect) const
+{
+    QRectF shifted = sceneRect.translated(gridWidth / 2.0, gridHeight / 2.0);
+    return shifted.toAlignedRect() & QRect(0, 0, gridWidth, gridHeight);
+}
+
+QRect TrailGrid::stamp(const QRectF &sceneRect, quint8 owner, int age, const QRect &clip)
+{
+    // Whole cells, the same size every time wherever the segment falls between pixels
+    QRect whole(qRound(sceneRect.x() + gridWidth / 2.0), qRound(sceneRect.y() + gridHeight / 2.0),
+                qRound(sceneRect.width()), qRound(sceneRect.height()));
+    QRect area = whole & QRect(0, 0, gridWidth, gridHeight);
+    if (clip.isValid()) {
+        area &= clip;
+    }
+    if (area.isEmpty()) {
+        return QRect();
+    }
+
+    for (int y = area.top(); y <= area.bottom(); ++y) {
+        int ringY = qMin(y - whole.top(), whole.bottom() - y);
+        int rowInChunk = (y % CHUNK_SIZE) * CHUNK_SIZE;
+
+        // One chunk lookup per piece of the row that falls in the same chunk
+        for (int x = area.left(); x <= area.right();) {
+            int pieceEnd = qMin(area.right(), (x / CHUNK_SIZE + 1) * CHUNK_SIZE - 1);
+            Chunk *chunk = nullptr;
+            for (; x <= pieceEnd; ++x) {
+                int ring = qMin(ringY, qMin(x - whole.left(), whole.right() - x)); // 0 on the edge
+                int cellLife = qMin(255, (ring + 1) * LIFE_PER_SHRINK_STEP) - age;
+                if (cellLife <= 0) {
+                    continue;
+                }
+                if (!chunk) {
+                    chunk = writableChunk(x, y);
+                }
+                int index = rowInChunk + x % CHUNK_SIZE;
+                if (cellLife >= chunk->life[index]) {
+                    chunk->life[index] = uchar(cellLife);
+                    chunk->owners[index] = owner; // newest segment is on top
+                }
+            }
+        }
+    }
+    return area;
+}
+
+void TrailGrid::clearArea(const QRect &area)
+{
+    QRect part = area & QRect(0, 0, gridWidth, gridHeight);
+    if (part.isEmpty()) {
+        return;
+    }
+
+    for (int y = part.top(); y <= part.bottom(); ++y) {
+        for (int x = part.left(); x <= part.right();) {
+            int pieceEnd = qMin(part.right(), (x / CHUNK_SIZE + 1) * CHUNK_SIZE - 1);
+            if (chunkAt(x, y)) {
+                Chunk *chunk = writableChunk(x, y);
+                memset(chunk->life + (y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE, 0, size_t(pieceEnd - x + 1));
+            }
+            x = pieceEnd + 1;
+        }
+    }
+}
+
+bool TrailGrid::isOccupied(const QRectF &sceneRect) const
+{
+    QRect area = toGrid(sceneRect);
+    if (area.isEmpty()) {
+        return false;
+    }
+
+    for (int y = area.top(); y <= area.bottom(); ++y) {
+        for (int x = area.left(); x <= area.right();) {
+            int pieceEnd = qMin(area.right(), (x / CHUNK_SIZE + 1) * CHUNK_SIZE - 1);
+            const Chunk *chunk = chunkAt(x, y);
+            if (chunk) {
+                const uchar *row = chunk->life + (y % CHUNK_SIZE) * CHUNK_SIZE;
+                int chunkLeft = (x / CHUNK_SIZE) * CHUNK_SIZE;
+                for (int cell = x; cell <= pieceEnd; ++cell) {
+                    if (row[cell - chunkLeft]) {
+                        return true;
+                    }
+                }
+            }
+            x = pieceEnd + 1;
+        }
+    }
+    return false;
+}
+
+void TrailGrid::decay(QVector<QRect> *expired)
+{
+    int first = 0;
+    int last = 0;
+    for (int i = 0; i < liveChunks.size();) {
+        int index = liveChunks[i];
+        Chunk *chunk = chunks[index].data();
+        int left = (index % chunksAcross) * CHUNK_SIZE;
+        int top = (index / chunksAcross) * CHUNK_SIZE;
+
+        for (int row = 0; row < CHUNK_SIZE; ++row) {
+            if (decayRow(chunk->life + row * CHUNK_SIZE, CHUNK_SIZE, &first, &last) && expired) {
+                expired->append(QRect(left + first, top + row, last - first + 1, 1));
+            }
+        }
+
+        // A chunk whose trail has all gone is handed back
+        quint64 remaining = 0;
+        const uchar *cells = chunk->life;
+        for (int offset = 0; offset < CHUNK_CELLS; offset += int(sizeof(quint64))) {
+            quint64 word;
+            memcpy(&word, cells + offset, sizeof(word));
+            remaining |= word;
+        }
+        if (remaining) {
+            ++i;
+        } else {
+            chunks[index] = QSharedDataPointer<Chunk>();
+            liveChunks.removeAt(i);
+        }
+    }
+}
+
+void TrailGrid::readRow(int x, int y, int count, uchar *lifeOut, uchar *ownersOut) const
+{
+    int end = x + count;
+    while (x < end) {
+        int pieceEnd = qMin(end, (x / CHUNK_SIZE + 1) * CHUNK_SIZE);
+        int length = pieceEnd - x;
+        const Chunk *chunk = chunkAt(x, y);
+        if (chunk) {
+            int offset = (y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE;
+            memcpy(lifeOut, chunk->life + offset, size_t(length));
+            memcpy(ownersOut, chunk->owners + offset, size_t(length));
+        } else {
+            memset(lifeOut, 0, size_t(length));
+            memset(ownersOut, 0, size_t(length));
+        }
+        lifeOut += length;
+        ownersOut += length;
+        x = pieceEnd;
+    }
+}
+
+QVector<QRect> TrailGrid::usedAreas() const
+{
+    QVector<QRect> areas;
+    areas.reserve(liveChunks.size());
+    for (int index : liveChunks) {
+        QRect chunk((index % chunksAcross) * CHUNK_SIZE, (index / chunksAcross) * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE);
+        areas.append(chunk & QRect(0, 0, gridWidth, gridHeight));
+    }
+    return areas;
+}
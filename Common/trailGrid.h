@@ -0,0 +1,75 @@
+// trailGrid.h
+
+#ifndef TRAILGRID_H
+#define TRAILGRID_H
+
+#include <QByteArray>
+#include <QRect>
+#include <QRectF>
+#include <QVector>
+#include <QSharedData>
+#include <QSharedDataPointer>
+#include <QtGlobal>
+
+// Every trail in the arena as one byte of remaining life per pixel, plus the id of
+// the player that left it. The arena is cut into square chunks that are only
+// allocated once a trail reaches them and freed again once everything in them has
+// decayed, so memory follows how much of the arena is in use, not its area.
+// Aging is a saturating subtract over the chunks in use. Collision and drawing
+// both read this grid, so they always agree. Copies share chunks until written.
+class TrailGrid
+{
+public:
+    static constexpr int DECAY_INTERVAL_MS = 250;     // how often every cell loses one unit of life
+    static constexpr int LIFE_PER_SHRINK_STEP = 10;   // 2500 ms, the time a segment takes to lose 1px per side
+    static constexpr int CHUNK_SIZE = 64;             // cells per chunk side
+
+    TrailGrid() = default;
+    TrailGrid(int width, int height); // one cell per scene unit, arena centered on (0, 0)
+
+    int width() const { return gridWidth; }
+    int height() const { return gridHeight; }
+    void clear(); // frees every chunk
+
+    // Lay down a segment; its outer ring dies first, so it shrinks by 1px per side per step.
+    // A segment laid down age steps ago and aged since can be replayed with age set, and
+    // only the part inside clip (grid cells) is written when one is given.
+    // Returns the cells that changed.
+    QRect stamp(const QRectF &sceneRect, quint8 owner, int age = 0, const QRect &clip = QRect());
+    void clearArea(const QRect &area); // grid cells, chunks stay allocated until the next decay
+    static int peakLife(int segmentSize) { return qMin(255, (segmentSize + 1) / 2 * LIFE_PER_SHRINK_STEP); } // life at a segment's center
+
+    bool isOccupied(const QRectF &sceneRect) const; // any live cell under the rectangle
+    bool isOccupiedAt(int x, int y) const; // grid cell, false outside the grid
+    QRect toGrid(const QRectF &sceneRect) const; // clipped to the grid
+
+    // Age every cell by one unit. For each chunk row where cells died, appends the span that
+    // has to be redrawn. Chunks left without any trail are freed.
+    void decay(QVector<QRect> *expired = nullptr);
+
+    // count cells of row y starting at x, zero where no trail was ever laid
+    void readRow(int x, int y, int count, uchar *lifeOut, uchar *ownersOut) const;
+    QVector<QRect> usedAreas() const; // grid rectangles of the chunks holding trail
+    int chunksInUse() const { return liveChunks.size(); }
+
+private:
+    static constexpr int CHUNK_CELLS = CHUNK_SIZE * CHUNK_SIZE;
+
+    struct Chunk : public QSharedData {
+        Chunk();
+        uchar life[CHUNK_CELLS];   // remaining decay intervals, 0 is free
+        uchar owners[CHUNK_CELLS]; // player id, only meaningful where life is not 0
+    };
+
+    const Chunk *chunkAt(int x, int y) const { return chunks.at((y / CHUNK_SIZE) * chunksAcross + x / CHUNK_SIZE).constData(); }
+    Chunk *writableChunk(int x, int y); // allocates it on first use
+
+    int gridWidth = 0;
+    int gridHeight = 0;
+    int chunksAcross = 0;
+    int chunksDown = 0;
+    QVector<QSharedDataPointer<Chunk>> chunks; // row major, null where nothing was laid
+    QVector<int> liveChunks;                   // indexes of the allocated ones
+};
+
+#endif // TRAILGRID_H
@@ -0,0 +1,288 @@
+// trailLog.cpp
+#include "trailLog.h"
+#include "bitStream.h"
+#include <algorithm>
+#include <cmath>
+
+constexpr int STEPS_PER_UNIT = 2; // the server moves in multiples of half a unit
+constexpr int HEADING_BITS = 2;
+constexpr quint32 MAX_SPANS = 1 << 16; // more than any arena can hold alive, anything above is a damaged payload
+constexpr int SEGMENT_SIZE_BITS = 8;   // the stride shares a varint with the segment size, older payloads read as stride 1
+
+enum StepHeading { Up, Down, Left, Right }; // same order as PlayerState::heading
+
+// Whole steps, or -1 if the value is not on the half unit grid
+static long toSteps(qreal value)
+{
+    qreal scaled = value * STEPS_PER_UNIT;
+    long steps = std::lround(scaled);
+    return std::fabs(scaled - steps) < 1e-6 ? steps : -1;
+}
+
+static quint32 quantize(qreal coordinate, int extent)
+{
+    long steps = std::lround((coordinate + extent / 2.0) * STEPS_PER_UNIT);
+    return quint32(qBound(0L, steps, long(extent) * STEPS_PER_UNIT));
+}
+
+static qreal dequantize(quint32 steps, int extent)
+{
+    return qreal(steps) / STEPS_PER_UNIT - extent / 2.0;
+}
+
+// A step along one axis on the half unit grid; anything else starts a new span
+static bool isEncodableStep(const QPointF &step)
+{
+    if (step.isNull()) {
+        return false;
+    }
+    if (step.x() != 0 && step.y() != 0) {
+        return false;
+    }
+    return toSteps(step.x()) != -1 && toSteps(step.y()) != -1;
+}
+
+TrailLog::TrailLog(int segmentSize, int decayIntervalTicks, int tickStride)
+    : segmentSize(segmentSize),
+      decayIntervalTicks(qMax(1, decayIntervalTicks)),
+      tickStride(qMax(1, tickStride))
+{
+}
+
+QRectF TrailLog::segmentAt(const QPointF &center) const
+{
+    return QRectF(center.x() - segmentSize / 2.0, center.y() - segmentSize / 2.0, segmentSize, segmentSize);
+}
+
+int TrailLog::decaysBetween(quint32 laidTick, quint32 tick) const
+{
+    // The grid ages at the end of every tick that is a multiple of the interval
+    return int(tick / quint32(decayIntervalTicks) - laidTick / quint32(decayIntervalTicks));
+}
+
+void TrailLog::record(quint32 tick, const QPointF &center, quint8 owner)
+{
+    auto open = openRun.constFind(owner);
+    if (open != openRun.constEnd()) {
+        Span &span = runs[*open];
+        if (tick == tickOf(span, span.count)) {
+            if (span.count == 1 && isEncodableStep(center - span.first)) {
+                span.step = center - span.first;
+                ++span.count;
+                return;
+            }
+            if (span.count > 1 && center == span.end()) {
+                ++span.count;
+                return;
+            }
+        }
+    }
+
+    Span span;
+    span.owner = owner;
+    span.firstTick = tick;
+    span.first = center;
+    span.count = 1;
+    openRun.insert(owner, runs.size());
+    runs.append(span);
+}
+
+void TrailLog::prune(quint32 tick)
+{
+    int peak = TrailGrid::peakLife(segmentSize);
+    auto dead = [this, tick, peak](const Span &span) {
+        return decaysBetween(tickOf(span, span.count - 1), tick) >= peak;
+    };
+    int before = runs.size();
+    runs.erase(std::remove_if(runs.begin(), runs.end(), dead), runs.end());
+    if (runs.size() != before) {
+        indexOpenRuns();
+    }
+}
+
+void TrailLog::indexOpenRuns()
+{
+    openRun.clear();
+    for (int i = 0; i < runs.size(); ++i) {
+        openRun.insert(runs[i].owner, i); // later runs of the same owner overwrite earlier ones
+    }
+}
+
+QRectF TrailLog::rewind(quint8 owner, quint32 tick)
+{
+    // The owner's runs follow each other in time, so walking back stops at the first one that began earlier
+    QRectF removed;
+    bool changed = false;
+    for (int i = runs.size() - 1; i >= 0; --i) {
+        Span &span = runs[i];
+        if (span.owner != owner) {
+            continue;
+        }
+        quint32 stride = quint32(tickStride);
+        int keep = span.firstTick >= tick ? 0 : int(qMin<quint32>((tick - span.firstTick + stride - 1) / stride, quint32(span.count)));
+        if (keep < span.count) {
+            // A run is straight, its first and last dropped segments bound the rest
+            QPointF firstDropped = span.first + span.step * keep;
+            removed |= segmentAt(firstDropped).united(segmentAt(span.last()));
+            changed = true;
+        }
+        if (keep == 0) {
+            runs.removeAt(i);
+            continue;
+        }
+        span.count = keep;
+        break;
+    }
+    if (changed) {
+        indexOpenRuns();
+    }
+    return removed;
+}
+
+void TrailLog::clear()
+{
+    runs.clear();
+    openRun.clear();
+}
+
+void TrailLog::replay(TrailGrid *grid, quint32 tick, const QRect &area) const
+{
+    if (area.isValid()) {
+        grid->clearArea(area);
+    } else {
+        grid->clear();
+    }
+
+    // Segments go down in the order they were laid, so where two are equally alive the newer one
+    // owns the cell, as on the server; within a tick the order is by span, close enough for a color
+    struct Segment {
+        quint32 tick;
+        QPointF center;
+        quint8 owner;
+        int age;
+    };
+    QVector<Segment> segments;
+    int peak = TrailGrid::peakLife(segmentSize);
+    for (const Span &span : runs) {
+        // A run is straight, its first and last segments bound it; with a small area most runs are
+        // wholly outside and only the few that meet it are walked segment by segment
+        if (area.isValid() && !grid->toGrid(segmentAt(span.first).united(segmentAt(span.last()))).intersects(area)) {
+            continue;
+        }
+        if (decaysBetween(tickOf(span, span.count - 1), tick) >= peak) {
+            continue; // its newest segment has died, so have the rest
+        }
+        for (int i = 0; i < span.count; ++i) {
+            quint32 laid = tickOf(span, i);
+            int age = decaysBetween(laid, tick);
+            QPointF center = span.first + span.step * i;
+            if (age < peak && (!area.isValid() || grid->toGrid(segmentAt(center)).intersects(area))) {
+                segments.append({laid, center, span.owner, age});
+            }
+        }
+    }
+    std::stable_sort(segments.begin(), segments.end(), [](const Segment &a, const Segment &b) {
+        return a.tick < b.tick;
+    });
+
+    for (const Segment &segment : segments) {
+        grid->stamp(segmentAt(segment.center), segment.owner, segment.age, area);
+    }
+}
+
+void TrailLog::encode(BitWriter *out, int arenaWidth, int arenaHeight) const
+{
+    const int xBits = bitsFor(quint32(arenaWidth * STEPS_PER_UNIT));
+    const int yBits = bitsFor(quint32(arenaHeight * STEPS_PER_UNIT));
+
+    out->writeVarint(quint32(segmentSize) | quint32(tickStride - 1) << SEGMENT_SIZE_BITS);
+    out->writeVarint(quint32(decayIntervalTicks));
+    out->writeVarint(quint32(runs.size()));
+
+    // Every field is relative to what came before: ticks to the previous span, and a span that
+    // turns off its owner's last one one stride later carries no position or tick at all
+    quint32 previousTick = 0;
+    QHash<quint8, const Span *> lastOf;
+    for (const Span &span : runs) {
+        out->writeVarint(span.owner);
+
+        StepHeading heading = Right;
+        qreal length = span.step.x();
+        if (span.step.y() < 0) {
+            heading = Up;
+            length = -span.step.y();
+        } else if (span.step.y() > 0) {
+            heading = Down;
+            length = span.step.y();
+        } else if (span.step.x() < 0) {
+            heading = Left;
+            length = -span.step.x();
+        }
+        out->writeBits(heading, HEADING_BITS);
+        out->writeVarint(quint32(qMax(0L, toSteps(length))));
+        out->writeVarint(quint32(span.count));
+
+        const Span *last = lastOf.value(span.owner, nullptr);
+        bool turns = last && span.firstTick == tickOf(*last, last->count) && span.first == last->last() + span.step;
+        out->writeBool(turns);
+        if (!turns) {
+            out->writeVarint(span.firstTick - previousTick);
+            out->writeBits(quantize(span.first.x(), arenaWidth), xBits);
+            out->writeBits(quantize(span.first.y(), arenaHeight), yBits);
+        }
+
+        previousTick = span.firstTick;
+        lastOf.insert(span.owner, &span);
+    }
+}
+
+bool TrailLog::decode(BitReader *in, int arenaWidth, int arenaHeight)
+{
+    const int xBits = bitsFor(quint32(arenaWidth * STEPS_PER_UNIT));
+    const int yBits = bitsFor(quint32(arenaHeight * STEPS_PER_UNIT));
+
+    clear();
+    quint32 sizeAndStride = in->readVarint();
+    segmentSize = int(sizeAndStride & ((1u << SEGMENT_SIZE_BITS) - 1));
+    tickStride = int(sizeAndStride >> SEGMENT_SIZE_BITS) + 1;
+    decayIntervalTicks = qMax(1, int(in->readVarint()));
+    quint32 count = in->readVarint();
+    if (!in->ok() || count > MAX_SPANS || tickStride > 255) {
+        return false;
+    }
+
+    quint32 previousTick = 0;
+    runs.reserve(int(count));
+    for (quint32 i = 0; i < count && in->ok(); ++i) {
+        Span span;
+        span.owner = quint8(in->readVarint());
+
+        quint32 heading = in->readBits(HEADING_BITS);
+        qreal length = qreal(in->readVarint()) / STEPS_PER_UNIT;
+        switch (heading) {
+        case Up: span.step = QPointF(0, -length); break;
+        case Down: span.step = QPointF(0, length); break;
+        case Left: span.step = QPointF(-length, 0); break;
+        default: span.step = QPointF(length, 0); break;
+        }
+        span.count = int(qMin<quint32>(in->readVarint(), MAX_SPANS * 64u));
+
+        int last = openRun.value(span.owner, -1);
+        if (in->readBool()) {
+            if (last < 0) {
+                return false;
+            }
+            span.first = runs[last].last() + span.step;
+            span.firstTick = tickOf(runs[last], runs[last].count);
+        } else {
+            span.firstTick = previousTick + in->readVarint();
+            span.first.setX(dequantize(in->readBits(xBits), arenaWidth));
+            span.first.setY(dequantize(in->readBits(yBits), arenaHeight));
+        }
+
+        previousTick = span.firstTick;
+        openRun.insert(span.owner, runs.size());
+        runs.append(span);
+    }
+    return in->ok();
+}
@@ -0,0 +1,74 @@
+// trailLog.h
+
+#ifndef TRAILLOG_H
+#define TRAILLOG_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QPointF>
+#include <QRect>
+#include <QRectF>
+#include <QVector>
+#include <QtGlobal>
+#include "trailGrid.h"
+
+class BitWriter;
+class BitReader;
+
+// The trail segments still alive in a match, as straight runs: a player moving at
+// a constant speed lays a segment every tick (or every few ticks, on the grid
+// rules) at evenly spaced points, so a run is a start, a step and a count until
+// the next turn. Replaying the runs into an
+// empty grid, each segment aged by the decays it has been through, gives back the
+// grid the server has, so a keyframe only has to carry a few hundred bytes of runs
+// instead of the grid itself.
+class TrailLog
+{
+public:
+    struct Span {
+        quint8 owner = 0;
+        quint32 firstTick = 0; // tick the first segment was laid in
+        QPointF first;         // center of the first segment
+        QPointF step;          // between consecutive segments, one tick stride apart
+        int count = 0;
+
+        QPointF end() const { return first + step * count; } // where the next segment would go
+        QPointF last() const { return first + step * (count - 1); }
+    };
+
+    TrailLog() = default;
+    TrailLog(int segmentSize, int decayIntervalTicks, int tickStride = 1);
+
+    int segmentSide() const { return segmentSize; } // width and height of every segment
+
+    QRectF segmentAt(const QPointF &center) const; // the square laid at a center
+    void record(quint32 tick, const QPointF &center, quint8 owner); // extends the owner's run when it can
+    void prune(quint32 tick); // forget runs whose every segment has died by this tick
+    void clear();
+
+    // Forget the owner's segments laid at tick or later, so a turn can be applied where it was made.
+    // Returns the scene area they covered, replay() that area to take them out of the grid.
+    QRectF rewind(quint8 owner, quint32 tick);
+
+    const QVector<Span> &spans() const { return runs; } // in the order they were started
+
+    // Rebuild the grid as it was at the end of tick, which must not be earlier than the last segment.
+    // With an area (grid cells) only that part is rebuilt and the rest of the grid is left alone.
+    void replay(TrailGrid *grid, quint32 tick, const QRect &area = QRect()) const;
+    int decaysBetween(quint32 laidTick, quint32 tick) const; // decays a segment from laidTick saw by the end of tick
+
+    void encode(BitWriter *out, int arenaWidth, int arenaHeight) const;
+    bool decode(BitReader *in, int arenaWidth, int arenaHeight);
+
+private:
+    void indexOpenRuns(); // after runs were removed
+    quint32 tickOf(const Span &span, int index) const { return span.firstTick + quint32(index) * quint32(tickStride); }
+
+    int segmentSize = 10;
+    int decayIntervalTicks = 25;
+    int tickStride = 1; // ticks between consecutive segments of a run
+    QVector<Span> runs;
+    QHash<quint8, int> openRun; // index in runs of each owner's latest run
+};
+
+#endif // TRAILLOG_H
@@ -0,0 +1,61 @@
+// udpChannel.cpp
+#include "udpChannel.h"
+#include "metrics.h"
+#include <QNetworkDatagram>
+#include <QDebug>
+
+UdpChannel::UdpChannel(QObject *parent)
+    : QObject(parent),
+      socket(new QUdpSocket(this)),
+      inbound(new NetSim(NetSim::Datagrams, NetSimConfig::fromEnvironment(), this))
+{
+    connect(socket, &QUdpSocket::readyRead, this, &UdpChannel::onReadyRead);
+}
+
+bool UdpChannel::bind(const QHostAddress &address, quint16 port)
+{
+    if (!socket->bind(address, port)) {
+        qWarning() << "UDP bind failed:" << socket->errorString();
+        return false;
+    }
+    return true;
+}
+
+void UdpChannel::close()
+{
+    socket->close();
+}
+
+bool UdpChannel::isBound() const
+{
+    return socket->state() == QAbstractSocket::BoundState;
+}
+
+quint16 UdpChannel::localPort() const
+{
+    return socket->localPort();
+}
+
+void UdpChannel::sendTo(const QByteArray &datagram, const QHostAddress &address, quint16 port)
+{
+    if (socket->writeDatagram(datagram, address, port) > 0) {
+        Metrics::add(Metrics::UdpBytesOut, quint64(datagram.size()));
+    }
+}
+
+void UdpChannel::setNetworkConditions(const NetSimConfig &config)
+{
+    delete inbound; // anything still in flight on the old link is dropped
+    inbound = new NetSim(NetSim::Datagrams, config, this);
+}
+
+void UdpChannel::onReadyRead()
+{
+    while (socket->hasPendingDatagrams()) {
+        QNetworkDatagram datagram = socket->receiveDatagram();
+        Metrics::add(Metrics::UdpBytesIn, quint64(datagram.data().size()));
+        inbound->transmit(datagram.data().size(), [this, datagram]() {
+            emit datagramReceived(datagram.data(), datagram.senderAddress(), quint16(datagram.senderPort()));
+        });
+    }
+}
@@ -0,0 +1,41 @@
+// udpChannel.h
+
+#ifndef UDPCHANNEL_H
+#define UDPCHANNEL_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include "netSim.h"
+
+// Thin wrapper around QUdpSocket shared by the client and the server.
+// Received datagrams pass through a NetSim, so loopback tests can add latency,
+// jitter, loss and reordering (configured from the TRON_SIM_* variables).
+class UdpChannel : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UdpChannel(QObject *parent = nullptr);
+
+    bool bind(const QHostAddress &address, quint16 port); // port 0 picks any free port
+    void close();
+    bool isBound() const;
+    quint16 localPort() const;
+
+    void sendTo(const QByteArray &datagram, const QHostAddress &address, quint16 port);
+
+    void setNetworkConditions(const NetSimConfig &config); // replaces the conditions read from the environment
+
+signals:
+    void datagramReceived(const QByteArray &datagram, const QHostAddress &sender, quint16 senderPort);
+
+private slots:
+    void onReadyRead();
+
+private:
+    QUdpSocket *socket;
+    NetSim *inbound; // simulated link for everything this end receives
+};
+
+#endif // UDPCHANNEL_H
@@ -0,0 +1,128 @@
+// allocationCounter.cpp
+// Replaces the global allocation functions so the metrics endpoint can report
+// how often the server allocates. Counting is a relaxed add on the calling
+// thread's own counter, so it costs next to nothing.
+#include "../Common/metrics.h"
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+void *operator new(std::size_t size)
+{
+    Metrics::add(Metrics::Allocations);
+    if (void *memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    Metrics::add(Metrics::Allocations);
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void *memory) noexcept
+{
+    if (memory) {
+        Metrics::add(Metrics::Deallocations);
+        std::free(memory);
+    }
+}
+
+void operator delete[](void *memory) noexcept
+{
+    operator delete(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    operator delete(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    operator delete(memory);
+}
+
+#ifdef __cpp_aligned_new
+// Over-aligned types come through here from C++17 on; without these they would reach the
+// library's versions, which count nothing and pair with a free() that is not ours
+
+static void *allocateAligned(std::size_t size, std::align_val_t alignment) noexcept
+{
+    Metrics::add(Metrics::Allocations);
+    std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    return _aligned_malloc(size ? size : 1, align);
+#else
+    void *memory = nullptr;
+    if (posix_memalign(&memory, align < sizeof(void *) ? sizeof(void *) : align, size ? size : 1) != 0) {
+        return nullptr;
+    }
+    return memory;
+#endif
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void *memory = allocateAligned(size, alignment)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    if (memory) {
+        Metrics::add(Metrics::Deallocations);
+#ifdef _WIN32
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+}
+
+void operator delete[](void *memory, std::align_val_t alignment) noexcept
+{
+    operator delete(memory, alignment);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(memory, alignment);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(memory, alignment);
+}
+#endif
@@ -0,0 +1,285 @@
+// batchRunner.cpp
+#include "batchRunner.h"
+#include "simulation.h"
+#include "../Common/keyframe.h"
+#include "../Common/matchArchive.h"
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+constexpr int OPENING_TURNS = 3;          // random turns every bot gets early on, or all matches would be the same
+constexpr quint32 OPENING_TICKS = 200;    // they land somewhere in the first two seconds
+static const char TURN_KEYS[] = {'W', 'A', 'S', 'D'};
+
+void BatchReport::merge(const BatchReport &other)
+{
+    if (other.matches == 0) {
+        return;
+    }
+    shortest = matches ? qMin(shortest, other.shortest) : other.shortest;
+    longest = qMax(longest, other.longest);
+    matches += other.matches;
+    ticks += other.ticks;
+    draws += other.draws;
+    timeouts += other.timeouts;
+    wins.resize(qMax(wins.size(), other.wins.size()));
+    firstCrashes.resize(qMax(firstCrashes.size(), other.firstCrashes.size()));
+    for (int i = 0; i < other.wins.size(); ++i) {
+        wins[i] += other.wins[i];
+    }
+    for (int i = 0; i < other.firstCrashes.size(); ++i) {
+        firstCrashes[i] += other.firstCrashes[i];
+    }
+}
+
+QString BatchReport::format() const
+{
+    double seconds = elapsedNs / 1e9;
+    QString text;
+    QTextStream out(&text);
+    out << matches << " matches on " << threads << " threads in " << QString::number(seconds, 'f', 2) << " s: "
+        << QString::number(seconds > 0 ? matches / seconds : 0, 'f', 1) << " matches/s, "
+        << QString::number(seconds > 0 ? ticks / seconds / 1e6 : 0, 'f', 2) << "M ticks/s\n";
+    if (matches == 0) {
+        return text;
+    }
+
+    out << "Length: mean " << ticks / quint64(matches) << " ticks, shortest " << shortest << ", longest " << longest << "\n";
+    out << "Draws: " << draws << ", timeouts: " << timeouts << "\n";
+    out << "By start position:  wins      first out\n";
+    for (int id = 0; id < qMax(wins.size(), firstCrashes.size()); ++id) {
+        int won = wins.value(id);
+        int first = firstCrashes.value(id);
+        out << QString("  %1  %2 %3%  %4 %5%\n")
+                   .arg(id, 2)
+                   .arg(won, 8)
+                   .arg(100.0 * won / matches, 5, 'f', 1)
+                   .arg(first, 8)
+                   .arg(100.0 * first / matches, 5, 'f', 1);
+    }
+    return text;
+}
+
+BatchRunner::BatchRunner(const BatchOptions &options)
+    : options(options)
+{
+    if (this->options.threads <= 0) {
+        this->options.threads = qMax(1, QThread::idealThreadCount());
+    }
+}
+
+bool BatchRunner::loadReplay(QString *error)
+{
+    MatchArchiveReader reader;
+    if (!reader.open(options.replayPath)) {
+        *error = "Cannot read the archive " + options.replayPath;
+        return false;
+    }
+    options.arenaSize = QSize(reader.arenaWidth(), reader.arenaHeight());
+
+    // The first keyframe says how many players there were; only members' turns are archived,
+    // and rooms add members before bots, so every id up to the highest one that turned is human
+    qint64 offset = reader.seek(0);
+    MatchArchive::Chunk chunk;
+    bool sawKeyframe = false;
+    int highestId = -1;
+    while (offset >= 0 && reader.readChunk(&offset, &chunk)) {
+        if (chunk.type == MatchArchive::Keyframe && !sawKeyframe) {
+            Keyframe keyframe;
+            if (Keyframe::decode(chunk.payload, &keyframe)) {
+                options.players = keyframe.snapshot.players.size();
+                sawKeyframe = true;
+            }
+        } else if (chunk.type == MatchArchive::Input && chunk.payload.size() >= 2) {
+            RecordedTurn turn;
+            turn.tick = chunk.tick;
+            turn.id = quint8(chunk.payload.at(0));
+            turn.key = chunk.payload.at(1);
+            recordedTurns.append(turn);
+            highestId = qMax(highestId, int(turn.id));
+        }
+    }
+    if (!sawKeyframe) {
+        *error = "The archive has no keyframe to take the players from";
+        return false;
+    }
+    humanCount = qMin(highestId + 1, options.players);
+    return true;
+}
+
+void BatchRunner::playMatch(int index, BatchReport *report) const
+{
+    Simulation simulation;
+    if (options.arenaSize.isValid()) {
+        simulation.setArenaSize(options.arenaSize);
+    }
+    if (options.gridRules) {
+        simulation.setRules(Simulation::GridRules);
+    }
+
+    QStringList names;
+    for (int id = 0; id < options.players; ++id) {
+        names.append((id < humanCount ? "Player " : "Bot ") + QString::number(id + 1));
+        if (id < humanCount) {
+            simulation.addPlayer(names.last());
+        } else {
+            simulation.addBot(names.last());
+        }
+    }
+
+    // Bots always choose the same way, so each match gets its own few early turns, from its own seed
+    QVector<RecordedTurn> turns = recordedTurns;
+    if (options.replayPath.isEmpty()) {
+        QRandomGenerator random(options.seed + quint32(index));
+        for (int id = 0; id < options.players; ++id) {
+            for (int i = 0; i < OPENING_TURNS; ++i) {
+                turns.append({random.bounded(OPENING_TICKS), quint8(id), TURN_KEYS[random.bounded(4)]});
+            }
+        }
+        std::stable_sort(turns.begin(), turns.end(), [](const RecordedTurn &a, const RecordedTurn &b) {
+            return a.tick < b.tick;
+        });
+    }
+
+    int nextTurn = 0;
+    while (!simulation.isOver() && simulation.currentTick() < options.maxTicks) {
+        for (; nextTurn < turns.size() && turns[nextTurn].tick <= simulation.currentTick(); ++nextTurn) {
+            const RecordedTurn &turn = turns[nextTurn];
+            if (turn.id < names.size()) {
+                simulation.processInput(names[turn.id], QString(QChar(turn.key)));
+            }
+        }
+        simulation.advance();
+    }
+
+    quint32 length = simulation.currentTick();
+    report->shortest = report->matches ? qMin(report->shortest, length) : length;
+    report->longest = qMax(report->longest, length);
+    ++report->matches;
+    report->ticks += length;
+    report->wins.resize(options.players);
+    report->firstCrashes.resize(options.players);
+
+    if (!simulation.isOver()) {
+        ++report->timeouts;
+    } else if (simulation.playersLeft() == 1) {
+        ++report->wins[simulation.playerId(simulation.lastPlayerLeft())];
+    } else {
+        ++report->draws;
+    }
+    if (!simulation.crashOrder().isEmpty()) {
+        ++report->firstCrashes[simulation.playerId(simulation.crashOrder().first())];
+    }
+}
+
+BatchReport BatchRunner::run()
+{
+    // Every worker starts with an even block of match numbers in its own queue
+    struct Queue {
+        std::mutex mutex;
+        std::deque<int> matches;
+    };
+    int threadCount = qMin(options.threads, qMax(1, options.matches));
+    std::vector<Queue> queues(threadCount);
+    for (int i = 0; i < options.matches; ++i) {
+        queues[size_t(qint64(i) * threadCount / options.matches)].matches.push_back(i);
+    }
+    std::vector<BatchReport> partial(threadCount); // one per worker, merged once they are all done
+
+    QElapsedTimer clock;
+    clock.start();
+
+    // A worker takes from the front of its own queue and, once that is empty, from the back of
+    // the others'; nothing is added after the start, so finding every queue empty means done
+    auto work = [&queues, &partial, threadCount, this](int self) {
+        for (;;) {
+            int match = -1;
+            for (int k = 0; k < threadCount && match == -1; ++k) {
+                Queue &queue = queues[size_t((self + k) % threadCount)];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.matches.empty()) {
+                    continue;
+                }
+                if (k == 0) {
+                    match = queue.matches.front();
+                    queue.matches.pop_front();
+                } else {
+                    match = queue.matches.back();
+                    queue.matches.pop_back();
+                }
+            }
+            if (match == -1) {
+                return;
+            }
+            playMatch(match, &partial[size_t(self)]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threadCount; ++t) {
+        workers.emplace_back(work, t);
+    }
+    work(0); // this thread is a worker too
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    BatchReport report;
+    for (const BatchReport &part : partial) {
+        report.merge(part);
+    }
+    report.threads = threadCount;
+    report.elapsedNs = clock.nsecsElapsed();
+    return report;
+}
+
+int BatchRunner::main(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Plays matches without clients or a display and reports how they went.");
+    parser.addHelpOption();
+    QCommandLineOption batchOption("batch");
+    QCommandLineOption matchesOption("matches", "Matches to play.", "count", "1000");
+    QCommandLineOption playersOption("players", "Players per match.", "count", "4");
+    QCommandLineOption threadsOption("threads", "Worker threads, one per core by default.", "count", "0");
+    QCommandLineOption seedOption("seed", "Seed of the first match's opening turns.", "seed", "1");
+    QCommandLineOption widthOption("width", "Arena width.", "units");
+    QCommandLineOption heightOption("height", "Arena height.", "units");
+    QCommandLineOption maxTicksOption("max-ticks", "Ticks after which a match is abandoned.", "ticks", "60000");
+    QCommandLineOption replayOption("replay", "Play the recorded turns of a match archive.", "archive");
+    QCommandLineOption gridOption("grid", "Play on the grid rules, a whole cell at a time.");
+    parser.addOptions({batchOption, matchesOption, playersOption, threadsOption, seedOption,
+                       widthOption, heightOption, maxTicksOption, replayOption, gridOption});
+    parser.process(arguments);
+
+    BatchOptions options;
+    options.matches = qMax(0, parser.value(matchesOption).toInt());
+    options.players = qBound(1, parser.value(playersOption).toInt(), 255);
+    options.threads = parser.value(threadsOption).toInt();
+    options.seed = parser.value(seedOption).toUInt();
+    options.maxTicks = parser.value(maxTicksOption).toUInt();
+    options.replayPath = parser.value(replayOption);
+    options.gridRules = parser.isSet(gridOption);
+    if (parser.isSet(widthOption) || parser.isSet(heightOption)) {
+        options.arenaSize = QSize(parser.value(widthOption).toInt(), parser.value(heightOption).toInt());
+    }
+
+    QLoggingCategory::setFilterRules("default.debug=false"); // a line per crash would drown the report
+
+    BatchRunner runner(options);
+    QString error;
+    if (!options.replayPath.isEmpty() && !runner.loadReplay(&error)) {
+        QTextStream(stderr) << error << "\n";
+        return 1;
+    }
+    QTextStream(stdout) << runner.run().format();
+    return 0;
+}
@@ -0,0 +1,71 @@
+// batchRunner.h
+
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+
+struct BatchOptions
+{
+    int matches = 1000;
+    int players = 4;      // per match, all bots unless a replay says otherwise
+    int threads = 0;      // 0 for one per core
+    quint32 seed = 1;     // match i uses seed + i, so any single match can be run again
+    QSize arenaSize;      // empty for the default arena
+    quint32 maxTicks = 60000; // ten minutes of play; a match still going by then counts as a timeout
+    QString replayPath;   // archive whose recorded turns every match plays, instead of random openings
+    bool gridRules = false; // play on Simulation::GridRules
+};
+
+// Outcome of a whole batch, merged from every worker thread
+struct BatchReport
+{
+    int matches = 0;
+    int threads = 0;
+    qint64 elapsedNs = 0;
+    quint64 ticks = 0;       // over all matches
+    quint32 shortest = 0;    // match length in ticks
+    quint32 longest = 0;
+    int draws = 0;           // the last players crashed on the same tick
+    int timeouts = 0;
+    QVector<int> wins;       // by player id, which is also the start position
+    QVector<int> firstCrashes; // by player id, who went out first
+
+    void merge(const BatchReport &other);
+    QString format() const; // the summary printed at the end of a run
+};
+
+// Plays many matches without clients, window or database, as fast as the machine
+// allows. Every match is a Simulation, the same code Game runs on its timer, so
+// the outcomes and the cost per tick are those of the server. Matches are spread
+// over worker threads in blocks; a worker that runs out steals from the far end
+// of another's block, so a few long matches do not hold up the batch.
+class BatchRunner
+{
+public:
+    explicit BatchRunner(const BatchOptions &options);
+
+    bool loadReplay(QString *error); // when a replay path is set, before run()
+    BatchReport run(); // blocks until every match is done
+
+    static int main(const QStringList &arguments); // the --batch command line
+
+private:
+    struct RecordedTurn {
+        quint32 tick; // applied before the tick after this one, like a turn received then
+        quint8 id;
+        char key;
+    };
+
+    void playMatch(int index, BatchReport *report) const;
+
+    BatchOptions options;
+    int humanCount = 0; // replay: players whose turns were recorded, the rest are bots
+    QVector<RecordedTurn> recordedTurns; // in tick order
+};
+
+#endif // BATCHRUNNER_H
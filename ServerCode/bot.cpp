@@ -0,0 +1,71 @@
+// bot.cpp
+#include "bot.h"
+
+// Points in front of the bot that must be free before a move is considered. They start past
+// the bot's own newest trail and span its width, since the whole front edge can crash.
+static const qreal PROBE_DISTANCES[] = {12, 20};
+static const qreal PROBE_OFFSETS[] = {-8, 0, 8};
+constexpr int TURN_MARGIN = 8;       // territory a turn must gain over going straight, avoids jitter
+
+static QPoint stepFor(QChar key)
+{
+    switch (key.toLatin1()) {
+    case 'W': return QPoint(0, -1);
+    case 'S': return QPoint(0, 1);
+    case 'A': return QPoint(-1, 0);
+    case 'D': return QPoint(1, 0);
+    default:  return QPoint(0, 0);
+    }
+}
+
+static QChar reverseOf(QChar key)
+{
+    switch (key.toLatin1()) {
+    case 'W': return 'S';
+    case 'S': return 'W';
+    case 'A': return 'D';
+    case 'D': return 'A';
+    default:  return QChar();
+    }
+}
+
+QChar Bot::chooseMove(const OccupancyGrid &grid, const QPointF &position, QChar heading, const QVector<QPoint> &opponents) const
+{
+    static const QChar keys[] = {'W', 'A', 'S', 'D'};
+
+    QChar bestKey;
+    int bestScore = -1;
+    for (QChar key : keys) {
+        if (key == reverseOf(heading)) {
+            continue; // would drive straight into our own trail
+        }
+
+        // The area right in front has to be free, otherwise this move crashes before any lookahead matters
+        QPointF forward = stepFor(key);
+        QPointF sideways(forward.y(), forward.x());
+        bool safe = true;
+        for (qreal distance : PROBE_DISTANCES) {
+            for (qreal offset : PROBE_OFFSETS) {
+                safe = safe && !grid.isBlocked(grid.cellAt(position + forward * distance + sideways * offset));
+            }
+        }
+        if (!safe) {
+            continue;
+        }
+
+        // Room we would own by heading this way, measured against everybody else's reach
+        int score = grid.territory(grid.cellAt(position + forward * PROBE_DISTANCES[0]), opponents);
+        if (key == heading) {
+            score += TURN_MARGIN;
+        }
+        if (score > bestScore) {
+            bestScore = score;
+            bestKey = key;
+        }
+    }
+
+    if (bestKey.isNull() || bestKey == heading) {
+        return QChar(); // keep going, either it is best or every move crashes anyway
+    }
+    return bestKey;
+}
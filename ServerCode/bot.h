@@ -0,0 +1,25 @@
+// bot.h
+
+#ifndef BOT_H
+#define BOT_H
+
+#include <QChar>
+#include <QPoint>
+#include <QPointF>
+#include <QVector>
+#include "occupancyGrid.h"
+
+// Computer controlled player. It is fed into Game::processClientInput exactly
+// like a remote player's PLAYERMOVE, it only decides which key to press.
+class Bot
+{
+public:
+    Bot() = default;
+
+    // Key to press (W, A, S or D) given where everyone is, or a null QChar to keep going.
+    // position is the bot's center in scene coordinates, opponents are grid cells.
+    // heading is the key the bot is currently moving with, null if it has not moved yet.
+    QChar chooseMove(const OccupancyGrid &grid, const QPointF &position, QChar heading, const QVector<QPoint> &opponents) const;
+};
+
+#endif // BOT_H
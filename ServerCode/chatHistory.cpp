@@ -0,0 +1,32 @@
+// chatHistory.cpp
+#include "chatHistory.h"
+
+ChatHistory::ChatHistory(int capacity)
+    : ring(qMax(1, capacity))
+{
+}
+
+void ChatHistory::append(const SharedMessage &message)
+{
+    ring[next] = message;
+    next = (next + 1) % ring.size();
+    count = qMin(count + 1, ring.size());
+}
+
+void ChatHistory::replayTo(Connection *connection) const
+{
+    if (!connection) {
+        return;
+    }
+    int oldest = (next - count + ring.size()) % ring.size();
+    for (int i = 0; i < count; ++i) {
+        connection->send(ring[(oldest + i) % ring.size()]);
+    }
+}
+
+void ChatHistory::clear()
+{
+    ring.fill(SharedMessage());
+    next = 0;
+    count = 0;
+}
@@ -0,0 +1,32 @@
+// chatHistory.h
+
+#ifndef CHATHISTORY_H
+#define CHATHISTORY_H
+
+#include <QVector>
+#include "sharedMessage.h"
+#include "connection.h"
+
+// The last few chat lines of a lobby or room, kept in a fixed ring so a server
+// that runs for days holds the same amount of chat as one that just started.
+// Lines are the already framed messages that were broadcast, so replaying them
+// to a late joiner only shares them.
+class ChatHistory
+{
+public:
+    static constexpr int DEFAULT_CAPACITY = 50;
+
+    explicit ChatHistory(int capacity = DEFAULT_CAPACITY);
+
+    void append(const SharedMessage &message); // overwrites the oldest line once full
+    void replayTo(Connection *connection) const; // oldest first
+    int size() const { return count; }
+    void clear();
+
+private:
+    QVector<SharedMessage> ring;
+    int next = 0;  // slot the next line goes in
+    int count = 0;
+};
+
+#endif // CHATHISTORY_H
@@ -0,0 +1,80 @@
+// connection.cpp
+#include "connection.h"
+#include "../Common/metrics.h"
+#include <QDebug>
+#include <QTimer>
+
+// Stop handing data to the socket once this much is waiting in its own buffer,
+// so a slow reader backs up in our queue of shared messages instead of in copies.
+constexpr qint64 WRITE_HIGH_WATER_MARK = 64 * 1024;
+constexpr qint64 SNAPSHOT_QUEUE_LIMIT = 256 * 1024; // past this snapshots are skipped, the next one supersedes them
+constexpr qint64 OUTBOUND_QUEUE_LIMIT = 1024 * 1024; // past this the peer has stopped reading and is dropped
+constexpr double INPUT_BURST = 8;             // turns a client may send back to back
+constexpr double INPUT_TOKENS_PER_SECOND = 20; // sustained turn rate, well above what a player can manage
+
+Connection::Connection(QTcpSocket *socket, QObject *parent)
+    : QObject(parent),
+      tcpSocket(socket),
+      inboundLink(new NetSim(NetSim::Stream, NetSimConfig::fromEnvironment(), this)),
+      inputTokens(INPUT_BURST)
+{
+    connect(tcpSocket, &QTcpSocket::bytesWritten, this, &Connection::pump);
+    inputClock.start();
+}
+
+bool Connection::takeInputToken()
+{
+    qint64 now = inputClock.elapsed();
+    inputTokens = qMin(INPUT_BURST, inputTokens + (now - inputRefilledAtMs) * INPUT_TOKENS_PER_SECOND / 1000.0);
+    inputRefilledAtMs = now;
+    if (inputTokens < 1) {
+        return false;
+    }
+    inputTokens -= 1;
+    return true;
+}
+
+void Connection::send(const SharedMessage &message)
+{
+    if (message.isEmpty() || stalled) {
+        return;
+    }
+
+    // A reader that falls behind misses snapshots first; one that stops altogether is cut off
+    if (outboundBytes >= SNAPSHOT_QUEUE_LIMIT && message.isSnapshot()) {
+        Metrics::add(Metrics::SnapshotsSkipped);
+        return;
+    }
+    if (outboundBytes + message.size() > OUTBOUND_QUEUE_LIMIT) {
+        qWarning() << "Dropping a client that stopped reading," << outboundBytes << "bytes queued";
+        stalled = true;
+        outbound.clear();
+        outboundBytes = 0;
+        QTimer::singleShot(0, tcpSocket, &QTcpSocket::abort); // the caller may be iterating over the room
+        return;
+    }
+
+    outbound.enqueue(message); // shares the payload, no copy
+    outboundBytes += message.size();
+    pump();
+}
+
+void Connection::pump()
+{
+    if (tcpSocket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+
+    bool wrote = false;
+    while (!outbound.isEmpty() && tcpSocket->bytesToWrite() < WRITE_HIGH_WATER_MARK) {
+        SharedMessage message = outbound.dequeue();
+        outboundBytes -= message.size();
+        tcpSocket->write(message.bytes());
+        Metrics::add(Metrics::TcpBytesOut, quint64(message.size()));
+        wrote = true;
+    }
+
+    if (wrote) {
+        tcpSocket->flush(); // make sure that it's sent immediately
+    }
+}
@@ -0,0 +1,68 @@
+// connection.h
+
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <QObject>
+#include <QQueue>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QElapsedTimer>
+#include "sharedMessage.h"
+#include "../Common/netSim.h"
+
+// Per-socket state kept by the server. Owns the outbound queue that broadcasts
+// are appended to; the queue holds shared messages, so a broadcast costs one
+// reference per recipient no matter how large the payload is.
+class Connection : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Connection(QTcpSocket *socket, QObject *parent = nullptr);
+
+    QTcpSocket *socket() const { return tcpSocket; }
+    NetSim *inbound() const { return inboundLink; } // simulated link for messages from this client
+
+    void send(const SharedMessage &message); // queue a message and push as much as the socket will take, bounded per peer
+    int queuedMessages() const { return outbound.size(); }
+    qint64 queuedBytes() const { return outboundBytes; }
+
+    // Token handed out over TCP once the player has a name, proves ownership of a UDP endpoint
+    quint64 sessionToken() const { return token; }
+    void setSessionToken(quint64 sessionToken) { token = sessionToken; }
+
+    // UDP endpoint, only set once the client answered the offer; until then everything goes over TCP
+    bool hasUdpEndpoint() const { return udpPort != 0; }
+    QHostAddress udpAddress() const { return udpHost; }
+    quint16 udpEndpointPort() const { return udpPort; }
+    void setUdpEndpoint(const QHostAddress &address, quint16 port) { udpHost = address; udpPort = port; }
+
+    // Highest input sequence applied, redundant copies at or below it are dropped
+    quint32 lastInputSequence() const { return inputSequence; }
+    void setLastInputSequence(quint32 sequence) { inputSequence = sequence; }
+
+    // Token bucket for turns, false once the client sends faster than anyone can press keys
+    bool takeInputToken();
+
+private slots:
+    void pump(); // move queued messages into the socket while it is below the high water mark
+
+private:
+    QTcpSocket *tcpSocket;
+    NetSim *inboundLink;
+    QQueue<SharedMessage> outbound; // messages not yet handed to the socket
+    qint64 outboundBytes = 0;
+    bool stalled = false; // went over the queue limit, closing
+
+    quint64 token = 0;
+    QHostAddress udpHost;
+    quint16 udpPort = 0;
+    quint32 inputSequence = 0;
+
+    QElapsedTimer inputClock;
+    double inputTokens;
+    qint64 inputRefilledAtMs = 0;
+};
+
+#endif // CONNECTION_H
@@ -1,43 +1,28 @@
 #include "game.h"
-#include <QGraphicsScene>
-#include <QGraphicsRectItem>
-#include <QGraphicsEllipseItem>
 #include <QTimer>
-#include <QPen>
 #include <QDebug>
-#include <QGraphicsItem>
+#include <QStringList>
+#include <QElapsedTimer>
 
 // Constants for the game
-constexpr int SCENE_WIDTH = 800;
-constexpr int SCENE_HEIGHT = 600;
-constexpr int PLAYER_WIDTH = 20;
-constexpr int PLAYER_HEIGHT = 20;
-constexpr qreal PLAYER_SPEED = 1.5;
+constexpr quint32 SNAPSHOT_INTERVAL_TICKS = 3; // 10 ms ticks, so roughly 33 snapshots per second
+constexpr quint32 KEYFRAME_INTERVAL_TICKS = 99; // every 33rd snapshot is preceded by a keyframe
 
 Game::Game(QWidget *parent)
-    : QDialog(parent),
-      scene(new QGraphicsScene(-SCENE_WIDTH / 2, -SCENE_HEIGHT / 2, SCENE_WIDTH, SCENE_HEIGHT, this))
+    : QDialog(parent)
 {
     setWindowTitle("Game");
     resize(900, 700);
 
-    // Set up the scene
-    scene->setItemIndexMethod(QGraphicsScene::NoIndex);
-    scene->setBackgroundBrush(Qt::black);
+    // Create and configure the view; it keeps the trails in a raster and only repaints what changed
+    arena = new ArenaView(DEFAULT_ARENA_WIDTH, DEFAULT_ARENA_HEIGHT, this);
+    arena->move((900 - arena->width()) / 2, (700 - arena->height()) / 2);
+    simulation.setTrackChanges(true);
 
-    // Create and configure the view
-    view = new QGraphicsView(scene, this);
-    view->setRenderHint(QPainter::Antialiasing);
-    view->setFixedSize(900, 700);
-    view->move(0, 0);
-
-    // Draw the perimeter lines
-    drawPerimeterLines();
-
-    // Timer for advancing the game state
-    QTimer *timer = new QTimer(this);
-    connect(timer, &QTimer::timeout, this, &Game::advance);
-    timer->start(10); // 10 ms interval
+    // Timer for advancing the game state, started by begin()
+    tickTimer = new QTimer(this);
+    tickTimer->setInterval(Simulation::TICK_MS);
+    connect(tickTimer, &QTimer::timeout, this, &Game::advance);
 
     initializeDatabase();
 
@@ -45,229 +30,117 @@ Game::Game(QWidget *parent)
 
 Game::~Game()
 {
-    delete view;
-    delete scene;
-
-    // Deallocate the players
-    for( auto it = players.cbegin(); it != players.cend(); ++it){
-        QString playerName = it.key();
-        QGraphicsRectItem *rect =it.value();
-        delete rect;
-    }
-    players.clear();
-
-    // Deallocate trails
-    for (QGraphicsRectItem* obj : trailItems) { delete obj; }
-    trailItems.clear();
+    delete arena;
 
-    playerVelocities.clear();
-
-    for (auto it = playerFrontRectangles.cbegin(); it != playerFrontRectangles.cend(); ++it) {
-        QString playerName = it.key();
-        QGraphicsRectItem *rect = it.value();
-        delete rect;
-    }
-    playerFrontRectangles.clear();
-
-    // Cleanup database when the game ends
+    // Cleanup database when the game ends; every game has its own connection, so rooms don't share one
+    QString connectionName = db.connectionName();
     if (db.isOpen()) {
         db.close();
     }
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(connectionName);
+}
 
-    displayLossOrder();
-
+void Game::begin()
+{
+    tickTimer->start();
 }
 
-void Game::addPlayer(const QString &playerName)
+void Game::setArenaSize(const QSize &size)
 {
-    if (players.contains(playerName)) {
-        qWarning() << "Player" << playerName << "already exists.";
+    QSize before = simulation.arenaSize();
+    simulation.setArenaSize(size);
+    if (simulation.arenaSize() == before) {
         return;
     }
+    arena->setArenaSize(simulation.arenaSize().width(), simulation.arenaSize().height());
+    arena->move((900 - arena->width()) / 2, (700 - arena->height()) / 2);
+}
 
-    // Define a list of colors for players
-    static QVector<QColor> predefinedColors = {Qt::blue, QColor(255, 165, 0), Qt::green, Qt::red}; // Blue, Orange, Green, Red
-
-    // Determine the color for the player based on the number of existing players
-    QColor playerColor = predefinedColors[players.size() % predefinedColors.size()];
-
-    // Store the player's color
-    playerColors[playerName] = playerColor;
-
-    // Create a new rectangle for the player
-    QGraphicsRectItem *playerRect = scene->addRect(-PLAYER_WIDTH / 2, -PLAYER_HEIGHT / 2, PLAYER_WIDTH, PLAYER_HEIGHT);
-    playerRect->setPen(QPen(Qt::white));
-    playerRect->setBrush(playerColor); // Set the player's color
-
-    // Position players in a line at the start
-    QPointF initialPosition(players.size() * 120 - SCENE_HEIGHT / 4 - 20, -250);
-    playerRect->setPos(initialPosition);
+void Game::reset()
+{
+    tickTimer->stop();
+    hide();
 
-    players[playerName] = playerRect;
-    playerVelocities[playerName] = QPointF(0, 0);
+    // Everything a match adds is dropped; the view, grids and database connection stay
+    simulation.reset();
+    arena->clearTrails();
+    arena->setPlayers(QVector<PlayerState>());
 
-    // Add a small rectangle in front of the player
-    QGraphicsRectItem *frontRect = scene->addRect(-10, -10, 20, 5, QPen(Qt::transparent), QBrush(Qt::transparent));
-    playerFrontRectangles[playerName] = frontRect;
+    tickHistogram = DurationHistogram();
+    hasGameEnded = false;
+    lossCounter = 1;
 
-    qDebug() << "Added player:" << playerName << "at position" << initialPosition << "with color" << playerColor.name();
+    QSqlQuery query(db);
+    if (!query.exec("DELETE FROM player_losses")) {
+        qCritical() << "Error: Unable to clear losses" << query.lastError();
+    }
 }
 
+void Game::addPlayer(const QString &playerName)
+{
+    simulation.addPlayer(playerName);
+}
 
+void Game::addBot(const QString &botName)
+{
+    simulation.addBot(botName);
+}
 
-void Game::processClientInput(const QString &playerName, const QString &keyInput)
+void Game::processClientInput(const QString &playerName, const QString &keyInput, qint64 clientTick)
 {
-    if (!players.contains(playerName)) {
-        qWarning() << "Unknown player:" << playerName;
-        return;
-    }
+    simulation.processInput(playerName, keyInput, clientTick);
+}
 
-    QPointF velocity(0, 0);
-    qreal rotation = 0; // Rotation angle for the front rectangle
-
-    if (keyInput == "W") {
-        velocity.setY(-PLAYER_SPEED);
-        rotation = 0; // Facing up
-    } else if (keyInput == "S") {
-        velocity.setY(PLAYER_SPEED);
-        rotation = 180; // Facing down
-    } else if (keyInput == "A") {
-        velocity.setX(-PLAYER_SPEED);
-        rotation = 270; // Facing left
-    } else if (keyInput == "D") {
-        velocity.setX(PLAYER_SPEED);
-        rotation = 90; // Facing right
-    } else {
-        qWarning() << "Unknown key input from player" << playerName << ":" << keyInput;
-        return;
+bool Game::restoreState(const MatchState &state)
+{
+    QSize before = simulation.arenaSize();
+    if (!simulation.restoreState(state)) {
+        return false;
     }
-
-    playerVelocities[playerName] = velocity;
-
-    // Update front rectangle rotation
-    if (playerFrontRectangles.contains(playerName)) {
-        QGraphicsRectItem *frontRect = playerFrontRectangles[playerName];
-        frontRect->setRotation(rotation); // Rotate the front rectangle
+    if (simulation.arenaSize() != before) {
+        arena->setArenaSize(simulation.arenaSize().width(), simulation.arenaSize().height());
+        arena->move((900 - arena->width()) / 2, (700 - arena->height()) / 2);
     }
-
-    qDebug() << "Updated velocity for player" << playerName << "to" << velocity << "with rotation" << rotation;
+    syncView(); // the whole grid and the crashes so far
+    arena->setPlayers(simulation.buildSnapshot().players);
+    return true;
 }
 
 
 void Game::advance()
 {
-    bool allFrozen = true; // Assume all players are frozen initially
-    QString activePlayer;  // Keep track of the last active player
-    int activePlayerCount = 0; // Count the number of active players
-
-    for (auto it = players.begin(); it != players.end(); ++it) {
-        QString playerName = it.key();
-        QGraphicsRectItem *playerRect = it.value();
-
-        // Skip processing for frozen players
-        if (frozenPlayers.contains(playerName)) {
-            continue;
-        }
-
-        allFrozen = false; // At least one player is active
-        activePlayer = playerName; // Update the active player
-        ++activePlayerCount; // Increment the active player count
-
-        QPointF velocity = playerVelocities[playerName];
-
-        // Update the player's position
-        qreal x = playerRect->pos().x() + velocity.x();
-        qreal y = playerRect->pos().y() + velocity.y();
-
-        // Leave a trail behind the player
-        if (!velocity.isNull()) {
-            leaveTrail(playerRect, currentDirection, playerColors[playerName]); // Use player's color for the trail
-        }
-
-        // Clamp position to stay within scene bounds
-        x = qBound(-SCENE_WIDTH / 2 + static_cast<qreal>(PLAYER_WIDTH) / 2, x, SCENE_WIDTH / 2 - static_cast<qreal>(PLAYER_WIDTH) / 2);
-        y = qBound(-SCENE_HEIGHT / 2 + static_cast<qreal>(PLAYER_HEIGHT) / 2, y, SCENE_HEIGHT / 2 - static_cast<qreal>(PLAYER_HEIGHT) / 2);
-        playerRect->setPos(x, y);
-
-        // Update front rectangle position and rotation
-        if (playerFrontRectangles.contains(playerName)) {
-            QGraphicsRectItem *frontRect = playerFrontRectangles[playerName];
-
-            // Determine the offset for the front rectangle based on velocity
-            QPointF frontOffset(0, 0);
-            qreal rotation = 0;
-            if (velocity.y() < 0) { // Moving up
-                frontOffset = QPointF(0, -PLAYER_HEIGHT / 2 + 6);
-                rotation = 0;
-            } else if (velocity.y() > 0) { // Moving down
-                frontOffset = QPointF(0, PLAYER_HEIGHT / 2 + 6);
-                rotation = 180;
-            } else if (velocity.x() < 0) { // Moving left
-                frontOffset = QPointF(-PLAYER_WIDTH / 2, 7);
-                rotation = 270;
-            } else if (velocity.x() > 0) { // Moving right
-                frontOffset = QPointF(PLAYER_WIDTH / 2 - 2, 7);
-                rotation = 90;
-            }
-
-            // Update front rectangle's position and rotation
-            frontRect->setPos(playerRect->pos() + frontOffset);
-            frontRect->setRotation(rotation);
-            frontRect->setTransformOriginPoint(frontRect->rect().center());
-
-            // Check for collisions with trails
-            for (auto *trailSegment : trailItems) {
-                if (frontRect->collidesWithItem(trailSegment)) {
-                    qDebug() << "Player" << playerName << "collided with a trail!";
-                    frozenPlayers.insert(playerName); // Freeze the player
-                    playerVelocities[playerName] = QPointF(0, 0); // Stop the player's movement
-
-                    // Record the player's loss order in the database
-                    recordPlayerLoss(playerName, lossCounter++);
-
-                    // Update the player's color to indicate collision
-                    if (playerColors.contains(playerName)) {
-                        QColor collisionColor = Qt::gray; // Use gray to indicate frozen state
-                        playerColors[playerName] = collisionColor;
-                        playerRect->setBrush(collisionColor);
-                    }
-                    break; // Exit collision detection for this player
-                }
-            }
-
-            // Check for collisions with the border
-            for (auto *border : borderItems) {
-                if (frontRect->collidesWithItem(border)) {
-                    qDebug() << "Player" << playerName << "collided with the border!";
-                    frozenPlayers.insert(playerName); // Freeze the player
-                    playerVelocities[playerName] = QPointF(0, 0); // Stop the player's movement
-
-                    // Record the player's loss order in the database
-                    recordPlayerLoss(playerName, lossCounter++);
-
-                    // Update the player's color to indicate collision
-                    if (playerColors.contains(playerName)) {
-                        QColor collisionColor = Qt::gray; // Use gray to indicate frozen state
-                        playerColors[playerName] = collisionColor;
-                        playerRect->setBrush(collisionColor);
-                    }
-                    break; // Exit collision detection for this player
-                }
-            }
+    QElapsedTimer tickClock;
+    tickClock.start();
+
+    simulation.advance();
+    syncView();
+
+    quint32 tickCount = simulation.currentTick();
+    Snapshot snapshot = simulation.buildSnapshot();
+    arena->setPlayers(snapshot.players);
+    if (tickCount % SNAPSHOT_INTERVAL_TICKS == 0 && !hasGameEnded) {
+        if (tickCount % KEYFRAME_INTERVAL_TICKS == SNAPSHOT_INTERVAL_TICKS) { // the first snapshot is always a keyframe
+            emit keyframeReady(simulation.buildKeyframe().encode());
         }
+        emit snapshotReady(snapshot);
     }
+    tickHistogram.observe(tickClock.nsecsElapsed()); // simulation and encoding, not the end of game dialogs
 
     // Check if only one player is active
-    if (activePlayerCount == 1 && !hasGameEnded) {
+    if (simulation.playersLeft() == 1 && !hasGameEnded) {
+        QString activePlayer = simulation.lastPlayerLeft();
         qDebug() << activePlayer << "wins!";
 
-        // Show the winner message
-        QMessageBox winnerBox;
-        winnerBox.setStyleSheet("background-color: #000000; color: #00FFFF; font-weight: bold; font-size: 18px; border: 2px solid #00FFFF;");
-        winnerBox.setWindowTitle("Game Over");
-        winnerBox.setText(activePlayer + " wins!");
-        winnerBox.setStandardButtons(QMessageBox::Ok);
-        winnerBox.exec();
+        // Show the winner message, unless nobody is watching this room's window
+        if (isVisible()) {
+            QMessageBox winnerBox;
+            winnerBox.setStyleSheet("background-color: #000000; color: #00FFFF; font-weight: bold; font-size: 18px; border: 2px solid #00FFFF;");
+            winnerBox.setWindowTitle("Game Over");
+            winnerBox.setText(activePlayer + " wins!");
+            winnerBox.setStandardButtons(QMessageBox::Ok);
+            winnerBox.exec();
+        }
 
         hasGameEnded = true;
 
@@ -282,7 +155,7 @@ void Game::advance()
     }
 
     // Check if all players are frozen and emit the gameEnded signal
-    if (allFrozen && !hasGameEnded) {
+    if (simulation.playersLeft() == 0 && !hasGameEnded) {
         qDebug() << "All players are frozen. Game over!";
         hasGameEnded = true;
 
@@ -293,56 +166,18 @@ void Game::advance()
     }
 }
 
-
-void Game::leaveTrail(QGraphicsRectItem *playerRect, Direction direction, const QColor &color)
+void Game::syncView()
 {
-    int trailWidth = 10;
-    int trailHeight = 10;
-
-    // Calculate offset based on direction
-    int offsetX = 0, offsetY = 0;
-    switch (direction) {
-        case Up:    offsetY = PLAYER_HEIGHT / 2; offsetX = 0; break;
-        case Down:  offsetY = -PLAYER_HEIGHT / 2; offsetX = 0; break;
-        case Left:  offsetX = PLAYER_WIDTH / 2; offsetY = 0; break;
-        case Right: offsetX = -PLAYER_WIDTH / 2; offsetY = 0; break;
+    for (const QRect &area : simulation.takeChangedAreas()) {
+        arena->syncTrail(simulation.trailGrid(), area);
     }
 
-    // Calculate trail segment position
-    qreal trailX = playerRect->x();
-    qreal trailY = playerRect->y();
-
-
-
-    // Create a trail segment
-    QGraphicsRectItem *trailSegment = new QGraphicsRectItem(trailX - trailWidth / 2, trailY - trailHeight / 2, trailWidth, trailHeight);
-    trailSegment->setBrush(QBrush(color)); // Use the passed color for the trail
-    trailSegment->setPen(Qt::NoPen);       // No border for the trail
-
-    // Add to the scene and keep track of it
-    if (scene) {
-        scene->addItem(trailSegment);
-        trailItems.append(trailSegment);
+    // Losses are recorded in the order the simulation saw the crashes
+    const QStringList &crashes = simulation.crashOrder();
+    while (lossCounter - 1 < crashes.size()) {
+        recordPlayerLoss(crashes.at(lossCounter - 1), lossCounter);
+        ++lossCounter;
     }
-
-    // Start a timer to shrink and remove the trail segment
-    QTimer *timer = new QTimer(this);
-    connect(timer, &QTimer::timeout, this, [this, trailSegment, timer]() {
-        QRectF rect = trailSegment->rect();
-        if (rect.width() > 0 && rect.height() > 0) {
-            // Shrink the trail segment
-            rect.adjust(1, 1, -1, -1); // Reduce size from all sides
-            trailSegment->setRect(rect);
-        } else {
-            // Remove the trail segment when it's fully shrunk
-            trailItems.removeOne(trailSegment);
-            scene->removeItem(trailSegment);
-            delete trailSegment;
-            timer->stop();
-            timer->deleteLater();
-        }
-    });
-    timer->start(2500); // Shrink every 2500ms
 }
 
 
@@ -358,27 +193,9 @@ void Game::changeDirection(Direction newDirection) {
 
 
 
-void Game::drawPerimeterLines()
-{
-    QBrush brush(Qt::blue); // Use a blue brush for the border
-    int thickness = 5; // Thickness of the border rectangles
-
-    // Top border
-    borderItems.append(scene->addRect(-SCENE_WIDTH / 2, -SCENE_HEIGHT / 2 - thickness / 2, SCENE_WIDTH, thickness, Qt::NoPen, brush));
-
-    // Bottom border
-    borderItems.append(scene->addRect(-SCENE_WIDTH / 2, SCENE_HEIGHT / 2 - thickness / 2, SCENE_WIDTH, thickness, Qt::NoPen, brush));
-
-    // Left border
-    borderItems.append(scene->addRect(-SCENE_WIDTH / 2 - thickness / 2, -SCENE_HEIGHT / 2, thickness, SCENE_HEIGHT, Qt::NoPen, brush));
-
-    // Right border
-    borderItems.append(scene->addRect(SCENE_WIDTH / 2 - thickness / 2, -SCENE_HEIGHT / 2, thickness, SCENE_HEIGHT, Qt::NoPen, brush));
-}
-
 void Game::initializeDatabase() {
     // Create an in-memory SQLite database
-    db = QSqlDatabase::addDatabase("QSQLITE");
+    db = QSqlDatabase::addDatabase("QSQLITE", "game-" + QString::number(quintptr(this), 16)); // one connection per game
     db.setDatabaseName(":memory:");  // In-memory database
 
     if (!db.open()) {
@@ -387,7 +204,7 @@ void Game::initializeDatabase() {
     }
 
     // Create a table to store player names and their loss order
-    QSqlQuery query;
+    QSqlQuery query(db);
     if (!query.exec("CREATE TABLE player_losses (player_name TEXT, loss_order INTEGER)")) {
         qCritical() << "Error: Unable to create table" << query.lastError();
     }
@@ -396,7 +213,9 @@ void Game::initializeDatabase() {
 void Game::recordPlayerLoss(const QString &playerName, int lossOrder)
 {
     // Insert the player name and loss order into the table
-    QSqlQuery query;
+    QElapsedTimer writeClock;
+    writeClock.start();
+    QSqlQuery query(db);
     query.prepare("INSERT INTO player_losses (player_name, loss_order) VALUES (:player_name, :loss_order)");
     query.bindValue(":player_name", playerName);
     query.bindValue(":loss_order", lossOrder);
@@ -404,6 +223,8 @@ void Game::recordPlayerLoss(const QString &playerName, int lossOrder)
     if (!query.exec()) {
         qCritical() << "Error: Unable to record loss" << query.lastError();
     }
+    Metrics::add(Metrics::DbWrites);
+    Metrics::add(Metrics::DbWriteNanoseconds, quint64(writeClock.nsecsElapsed()));
 
     qDebug() << "Recorded loss for player" << playerName << "with order" << lossOrder;
 }
@@ -413,7 +234,7 @@ void Game::displayLossOrder()
     // Adjust point mapping based on the number of players
     QMap<int, int> pointsMap;
 
-    int totalPlayers = players.size();  // get the total number of players
+    int totalPlayers = simulation.playerCount();  // get the total number of players
     if (totalPlayers == 2)
     {
         pointsMap = {{2, 1}, {1, 10}};  // map 10 points to first place
@@ -427,7 +248,7 @@ void Game::displayLossOrder()
         pointsMap = {{4, 1}, {3, 2}, {2, 5}, {1, 10}};  // do more of the same
     }
 
-    QSqlQuery query("SELECT * FROM player_losses ORDER BY loss_order DESC");  // make sure to list in descending order
+    QSqlQuery query("SELECT * FROM player_losses ORDER BY loss_order DESC", db);  // make sure to list in descending order
 
     QString scoreDisplay = "Player Scores:\n";
     int placement = 1;
@@ -456,6 +277,10 @@ void Game::displayLossOrder()
     }
 
     // Display the final scores
+    if (!isVisible()) {
+        qDebug().noquote() << scoreDisplay;
+        return;
+    }
     QMessageBox scoreBox;
     scoreBox.setStyleSheet("background-color: #000000; color: #00FFFF; font-weight: bold; font-size: 18px; border: 2px solid #00FFFF;");
     scoreBox.setWindowTitle("Game Over - Final Scores");
@@ -464,6 +289,13 @@ void Game::displayLossOrder()
     scoreBox.exec();
 }
 
-
-
-
+QStringList Game::finishingOrder() const
+{
+    // The last to crash is recorded last, so the winner comes first
+    QStringList order;
+    QSqlQuery query("SELECT player_name FROM player_losses ORDER BY loss_order DESC", db);
+    while (query.next()) {
+        order.append(query.value(0).toString());
+    }
+    return order;
+}
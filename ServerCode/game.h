@@ -5,17 +5,22 @@
 #include <QGraphicsScene>
 #include <QGraphicsRectItem>
 #include <QGraphicsEllipseItem>
-#include <QGraphicsView>
 #include <QMap>
 #include <QString>
+#include <QStringList>
 #include <QGraphicsItem>
 #include <QSet>
+#include <QHash>
 #include <QMessageBox>
+#include <QTimer>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
 #include <QMessageBox>
+#include "../Common/arenaView.h"
+#include "../Common/metrics.h"
+#include "simulation.h"
 
 
 class Game : public QDialog
@@ -23,44 +28,59 @@ class Game : public QDialog
     Q_OBJECT
 
 public:
+    static constexpr int DEFAULT_ARENA_WIDTH = Simulation::DEFAULT_ARENA_WIDTH;
+    static constexpr int DEFAULT_ARENA_HEIGHT = Simulation::DEFAULT_ARENA_HEIGHT;
+    static constexpr int MAX_ARENA_SIDE = Simulation::MAX_ARENA_SIDE;
+    static constexpr int MAX_REWIND_TICKS = Simulation::MAX_REWIND_TICKS;
+
     explicit Game(QWidget *parent = nullptr);
     ~Game();
 
-    void processClientInput(const QString &playerName, const QString &keyInput);
+    // A turn, applied at the start of the next tick. With the tick the player was looking at
+    // when they turned, it is applied there instead, up to MAX_REWIND_TICKS back.
+    void processClientInput(const QString &playerName, const QString &keyInput, qint64 clientTick = -1);
     void addPlayer(const QString &playerName);
+    void addBot(const QString &botName); // a player whose moves are chosen by the server
+    void begin(); // start ticking, once the players are in
+    void reset(); // back to an empty arena with the clock stopped, ready for the next match
+    void setArenaSize(const QSize &size); // before any player is added; clamped, and kept across reset()
+    void setRules(Simulation::Rules rules) { simulation.setRules(rules); } // likewise
 
     enum Direction { Up, Down, Left, Right };
     Direction currentDirection;
-    QList<QGraphicsRectItem *> trailItems;
     void initializeDatabase();
     void initializeLifetimeDatabase();
     void recordPlayerLoss(const QString &playerName, int lossOrder);
     void displayLossOrder();
     void updateLifetimeLeaderboard();
     void displayLifetimeLeaderboard();
+    QStringList finishingOrder() const; // winner first, filled in as players crash
+    quint32 currentTick() const { return simulation.currentTick(); }
+    QSize arenaSize() const { return simulation.arenaSize(); }
+    int playerId(const QString &playerName) const { return simulation.playerId(playerName); }
+    const DurationHistogram &tickDurations() const { return tickHistogram; } // time spent in advance()
+
+    Snapshot buildSnapshot() const { return simulation.buildSnapshot(); } // current positions of every player
+    Keyframe buildKeyframe() const { return simulation.buildKeyframe(); } // players plus the trail grid, for clients joining late
+    MatchState captureState() const { return simulation.captureState(); } // the match between two ticks, for carrying it on in another process
+    bool restoreState(const MatchState &state); // on a reset game, before begin(); false if the state does not fit
 
 signals:
     void gameEnded();
+    void snapshotReady(const Snapshot &snapshot); // emitted every few ticks, each room member gets their own view of it
+    void keyframeReady(const QByteArray &payload); // encoded Keyframe, emitted about once a second before that tick's snapshot
 
 private slots:
     void advance();
 
 private:
-    void drawPerimeterLines();
     void changeDirection(Direction d);
-    void leaveTrail(QGraphicsRectItem *re, Direction d, const QColor &color);
+    void syncView(); // trails that changed and crashes since the last tick, into the view and the database
 
-    QColor playerColor;
-    bool hasStartedMoving;
-    QMap<QString, QColor> playerColors;
-    QSet<QString> frozenPlayers;
-    QList<QGraphicsRectItem *> borderItems;
-
-    QGraphicsScene *scene;
-    QGraphicsView *view;
-    QMap<QString, QPointF> playerVelocities;
-    QMap<QString, QGraphicsRectItem *> players;
-    QHash<QString, QGraphicsRectItem*> playerFrontRectangles;
+    Simulation simulation; // the match itself, this dialog only times, shows and records it
+    ArenaView *arena;      // what the server operator sees
+    QTimer *tickTimer;
+    DurationHistogram tickHistogram;
 
     bool hasGameEnded = false;
 
@@ -71,4 +91,3 @@ private:
 };
 
 #endif // GAME_H
-
@@ -0,0 +1,49 @@
+// gamePool.cpp
+#include "gamePool.h"
+#include <QDebug>
+
+GamePool::GamePool(QWidget *window, int capacity, QObject *parent)
+    : QObject(parent),
+      window(window),
+      maxIdle(qMax(0, capacity))
+{
+}
+
+GamePool::~GamePool()
+{
+    for (const QPointer<Game> &game : idle) {
+        delete game;
+    }
+}
+
+void GamePool::prewarm()
+{
+    while (idle.size() < maxIdle) {
+        idle.append(new Game(window));
+    }
+}
+
+Game *GamePool::acquire()
+{
+    while (!idle.isEmpty()) {
+        Game *game = idle.takeLast();
+        if (game) {
+            return game;
+        }
+    }
+    qDebug() << "Game pool empty, building a new game";
+    return new Game(window);
+}
+
+void GamePool::release(Game *game)
+{
+    if (!game) {
+        return;
+    }
+    if (idle.size() >= maxIdle) {
+        game->deleteLater(); // it may still be inside one of its own signals
+        return;
+    }
+    game->reset();
+    idle.append(game);
+}
@@ -0,0 +1,35 @@
+// gamePool.h
+
+#ifndef GAMEPOOL_H
+#define GAMEPOOL_H
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include "game.h"
+
+// Idle Game instances, built ahead of time and reset in place after every match.
+// Building a Game means a scene, a view with its trail image, two grids and a
+// database connection; drawing a ready one from the pool makes a match start
+// right away, and reusing them keeps memory flat however many matches are played.
+class GamePool : public QObject
+{
+    Q_OBJECT
+
+public:
+    GamePool(QWidget *window, int capacity, QObject *parent = nullptr);
+    ~GamePool();
+
+    void prewarm(); // fill the pool up to its capacity
+    Game *acquire(); // an idle game, or a new one if the pool ran dry
+    void release(Game *game); // reset and keep it, or delete it when the pool is full
+    int idleCount() const { return idle.size(); }
+    int capacity() const { return maxIdle; }
+
+private:
+    QWidget *window; // parent of every game window
+    int maxIdle;
+    QVector<QPointer<Game>> idle; // the window may be destroyed along with its parent first
+};
+
+#endif // GAMEPOOL_H
@@ -0,0 +1,92 @@
+// interestFilter.cpp
+#include "interestFilter.h"
+#include <cmath>
+
+constexpr int INTEREST_RADIUS_CELLS = 1;  // cells around the viewer's own that count as nearby
+constexpr quint32 DISTANT_INTERVAL = 4;   // a distant player is refreshed every this many snapshots
+constexpr int MAX_DISTANT_PER_SNAPSHOT = 8; // caps the far part of a snapshot however big the room
+
+InterestFilter::InterestFilter(int cellSize)
+    : cellSize(qMax(1, cellSize))
+{
+}
+
+quint64 InterestFilter::cellKey(int cellX, int cellY)
+{
+    return (quint64(quint32(cellX)) << 32) | quint32(cellY);
+}
+
+QPoint InterestFilter::cellOf(const PlayerState &player) const
+{
+    return QPoint(int(std::floor(player.x / cellSize)), int(std::floor(player.y / cellSize)));
+}
+
+void InterestFilter::update(const Snapshot &snapshot)
+{
+    current = &snapshot;
+    ++snapshotCount;
+    occupied.clear();
+    indexOfId.clear();
+    for (int i = 0; i < snapshot.players.size(); ++i) {
+        const PlayerState &player = snapshot.players[i];
+        QPoint cell = cellOf(player);
+        occupied[cellKey(cell.x(), cell.y())].append(i);
+        indexOfId.insert(player.id, i);
+    }
+}
+
+Snapshot InterestFilter::viewFor(int viewerId, bool *complete) const
+{
+    *complete = true;
+    if (!current) {
+        return Snapshot();
+    }
+    int viewerIndex = indexOfId.value(viewerId, -1);
+    if (viewerIndex < 0) {
+        return *current; // not playing, nothing to center the view on
+    }
+
+    const QVector<PlayerState> &players = current->players;
+    QVector<bool> included(players.size(), false);
+    int count = 0;
+
+    // Everyone in the cells around the viewer, the viewer included
+    QPoint center = cellOf(players[viewerIndex]);
+    for (int dy = -INTEREST_RADIUS_CELLS; dy <= INTEREST_RADIUS_CELLS; ++dy) {
+        for (int dx = -INTEREST_RADIUS_CELLS; dx <= INTEREST_RADIUS_CELLS; ++dx) {
+            auto cell = occupied.constFind(cellKey(center.x() + dx, center.y() + dy));
+            if (cell == occupied.constEnd()) {
+                continue;
+            }
+            for (int index : *cell) {
+                included[index] = true;
+                ++count;
+            }
+        }
+    }
+
+    // Distant players take turns, staggered by id so each snapshot carries a different few
+    int distant = 0;
+    for (int i = 0; i < players.size() && distant < MAX_DISTANT_PER_SNAPSHOT; ++i) {
+        if (!included[i] && (snapshotCount + players[i].id) % DISTANT_INTERVAL == 0) {
+            included[i] = true;
+            ++count;
+            ++distant;
+        }
+    }
+
+    if (count == players.size()) {
+        return *current;
+    }
+
+    *complete = false;
+    Snapshot view;
+    view.tick = current->tick;
+    view.players.reserve(count);
+    for (int i = 0; i < players.size(); ++i) {
+        if (included[i]) {
+            view.players.append(players[i]);
+        }
+    }
+    return view;
+}
@@ -0,0 +1,38 @@
+// interestFilter.h
+
+#ifndef INTERESTFILTER_H
+#define INTERESTFILTER_H
+
+#include <QHash>
+#include <QPoint>
+#include <QVector>
+#include "../Common/snapshot.h"
+
+// Decides which players each member of a room hears about. Players are bucketed
+// into coarse cells once per snapshot; everyone in the cells around a viewer is
+// sent every time, everyone further away only every few snapshots and only a
+// handful at a time. A snapshot's size then depends on how crowded it is around
+// the viewer, not on how many players the room has.
+class InterestFilter
+{
+public:
+    static constexpr int DEFAULT_CELL_SIZE = 200; // a viewer sees its own cell and the eight around it
+
+    explicit InterestFilter(int cellSize = DEFAULT_CELL_SIZE);
+
+    void update(const Snapshot &snapshot); // once per snapshot, before asking for views
+    // What viewerId should receive; complete is set when that is the whole snapshot
+    Snapshot viewFor(int viewerId, bool *complete) const;
+
+private:
+    static quint64 cellKey(int cellX, int cellY);
+    QPoint cellOf(const PlayerState &player) const;
+
+    int cellSize;
+    quint32 snapshotCount = 0;
+    const Snapshot *current = nullptr;   // valid between update() and the end of the snapshot's fan-out
+    QHash<quint64, QVector<int>> occupied; // cell to indexes in the snapshot's player list
+    QHash<int, int> indexOfId;
+};
+
+#endif // INTERESTFILTER_H
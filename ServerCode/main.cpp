@@ -1,11 +1,24 @@
 #include "server.h"
+#include "batchRunner.h"
 #include <QApplication>
+#include <QCoreApplication>
+#include <cstring>
 
 int main(int argc, char *argv[])
 {
+    // "--batch" plays matches headless and exits, without a display or the server window
+    if (argc > 1 && std::strcmp(argv[1], "--batch") == 0) {
+        QCoreApplication app(argc, argv);
+        return BatchRunner::main(app.arguments());
+    }
+
     QApplication a(argc, argv);
     Dialog w;
-    w.show();
+    if (qEnvironmentVariableIsSet("TRON_SUPERVISOR")) {
+        w.startWorker(); // started by a supervisor, no window
+    } else {
+        w.show();
+    }
 
     return a.exec();
 }
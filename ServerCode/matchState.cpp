@@ -0,0 +1,145 @@
+// matchState.cpp
+#include "matchState.h"
+#include "../Common/bitStream.h"
+#include <cmath>
+
+constexpr quint32 FORMAT_VERSION = 3; // 2 added the rules, 3 the pending turns
+constexpr quint32 OLDEST_VERSION = 2;
+constexpr int STEPS_PER_UNIT = 2;           // positions and speeds are whole half units
+constexpr quint32 MAX_ARENA_SIDE = 20000;   // the largest arena a server runs
+constexpr quint32 MAX_PLAYERS = 256;        // ids are a byte
+constexpr quint32 MAX_NAME_BYTES = 1024;
+constexpr int HEADING_BITS = 2;
+constexpr quint32 MAX_PENDING_TURNS = 16;   // the simulation keeps a few
+
+enum Heading { Up, Down, Left, Right }; // same order as PlayerState::heading
+
+// Offset from the arena's left or top edge in steps, never negative
+static quint32 quantize(qreal coordinate, int extent)
+{
+    long steps = std::lround((coordinate + extent / 2.0) * STEPS_PER_UNIT);
+    return quint32(qBound(0L, steps, long(extent) * STEPS_PER_UNIT));
+}
+
+static qreal dequantize(quint32 steps, int extent)
+{
+    return qreal(steps) / STEPS_PER_UNIT - extent / 2.0;
+}
+
+// Players only ever move along one axis, so a heading and a speed say it all
+static void writeVelocity(BitWriter *out, const QPointF &velocity)
+{
+    Heading heading = Right;
+    qreal speed = velocity.x();
+    if (velocity.y() < 0) {
+        heading = Up;
+        speed = -velocity.y();
+    } else if (velocity.y() > 0) {
+        heading = Down;
+        speed = velocity.y();
+    } else if (velocity.x() < 0) {
+        heading = Left;
+        speed = -velocity.x();
+    }
+    out->writeBits(heading, HEADING_BITS);
+    out->writeVarint(quint32(qMax(0L, std::lround(speed * STEPS_PER_UNIT))));
+}
+
+static QPointF readVelocity(BitReader *in)
+{
+    quint32 heading = in->readBits(HEADING_BITS);
+    qreal speed = qreal(in->readVarint()) / STEPS_PER_UNIT;
+    switch (heading) {
+    case Up: return QPointF(0, -speed);
+    case Down: return QPointF(0, speed);
+    case Left: return QPointF(-speed, 0);
+    default: return QPointF(speed, 0);
+    }
+}
+
+QByteArray MatchState::encode() const
+{
+    const int xBits = bitsFor(quint32(arenaWidth * STEPS_PER_UNIT));
+    const int yBits = bitsFor(quint32(arenaHeight * STEPS_PER_UNIT));
+
+    BitWriter out;
+    out.writeVarint(FORMAT_VERSION);
+    out.writeVarint(quint32(arenaWidth));
+    out.writeVarint(quint32(arenaHeight));
+    out.writeVarint(tick);
+    out.writeVarint(quint32(lossCounter));
+    out.writeBool(gridRules);
+    out.writeVarint(quint32(players.size()));
+
+    for (const Player &player : players) {
+        QByteArray name = player.name.toUtf8();
+        out.writeVarint(quint32(name.size()));
+        out.writeBytes(name);
+        out.writeVarint(player.id);
+        out.writeBool(player.bot);
+        out.writeBool(player.frozen);
+        out.writeVarint(quint32(player.lossOrder));
+        out.writeBits(quantize(player.position.x(), arenaWidth), xBits);
+        out.writeBits(quantize(player.position.y(), arenaHeight), yBits);
+        writeVelocity(&out, player.velocity);
+        out.writeVarint(quint32(player.pendingTurns.size()));
+        for (const QPointF &turn : player.pendingTurns) {
+            writeVelocity(&out, turn);
+        }
+    }
+
+    trailLog.encode(&out, arenaWidth, arenaHeight);
+    return out.finish();
+}
+
+bool MatchState::decode(const QByteArray &bytes, MatchState *state)
+{
+    BitReader in(bytes);
+    quint32 version = in.readVarint();
+    if (version < OLDEST_VERSION || version > FORMAT_VERSION) {
+        return false; // written by a build that stores something else
+    }
+    quint32 width = in.readVarint();
+    quint32 height = in.readVarint();
+    state->tick = in.readVarint();
+    state->lossCounter = int(in.readVarint());
+    state->gridRules = in.readBool();
+    quint32 count = in.readVarint();
+    if (!in.ok() || width == 0 || height == 0 || width > MAX_ARENA_SIDE || height > MAX_ARENA_SIDE || count > MAX_PLAYERS) {
+        return false;
+    }
+    state->arenaWidth = int(width);
+    state->arenaHeight = int(height);
+
+    const int xBits = bitsFor(width * STEPS_PER_UNIT);
+    const int yBits = bitsFor(height * STEPS_PER_UNIT);
+    state->players.resize(int(count));
+    for (Player &player : state->players) {
+        quint32 nameSize = in.readVarint();
+        if (!in.ok() || nameSize > MAX_NAME_BYTES) {
+            return false;
+        }
+        player.name = QString::fromUtf8(in.readBytes(int(nameSize)));
+        player.id = quint8(in.readVarint());
+        player.bot = in.readBool();
+        player.frozen = in.readBool();
+        player.lossOrder = int(in.readVarint());
+        player.position.setX(dequantize(in.readBits(xBits), state->arenaWidth));
+        player.position.setY(dequantize(in.readBits(yBits), state->arenaHeight));
+        player.velocity = readVelocity(&in);
+
+        player.pendingTurns.clear();
+        quint32 turns = version >= 3 ? in.readVarint() : 0;
+        if (!in.ok() || turns > MAX_PENDING_TURNS) {
+            return false;
+        }
+        for (quint32 i = 0; i < turns; ++i) {
+            player.pendingTurns.append(readVelocity(&in));
+        }
+    }
+    if (!in.ok()) {
+        return false;
+    }
+
+    return state->trailLog.decode(&in, state->arenaWidth, state->arenaHeight);
+}
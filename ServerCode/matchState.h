@@ -0,0 +1,45 @@
+// matchState.h
+
+#ifndef MATCHSTATE_H
+#define MATCHSTATE_H
+
+#include <QByteArray>
+#include <QPointF>
+#include <QString>
+#include <QVector>
+#include "../Common/trailLog.h"
+
+// Everything a Game needs to carry on with a match in another process: the
+// players as they are after a tick, the trail runs with the ticks they were laid
+// in, which gives every segment its age, and the order players have crashed in.
+// Bots are players with a flag, the simulation makes them bots again; they keep
+// nothing between ticks but the turns they chose and have not taken yet, which
+// come along with everyone else's. The rewind history is left out, a late turn
+// made before the handover is rewound no further back than the handover tick.
+class MatchState
+{
+public:
+    struct Player {
+        QString name;
+        quint8 id = 0;      // join order, the game assigns them again in the same order
+        bool bot = false;
+        bool frozen = false;
+        QPointF position;   // on the half unit grid, like everything the game produces
+        QPointF velocity;
+        int lossOrder = 0;  // 0 while still in the match
+        QVector<QPointF> pendingTurns; // velocities chosen but not applied yet, oldest first
+    };
+
+    int arenaWidth = 0;
+    int arenaHeight = 0;
+    quint32 tick = 0;       // ticks already run
+    int lossCounter = 1;    // order the next crash is recorded with
+    bool gridRules = false; // played on the grid rules, see Simulation::Rules
+    QVector<Player> players; // by id
+    TrailLog trailLog;
+
+    QByteArray encode() const; // bit packed, trails as in a keyframe
+    static bool decode(const QByteArray &bytes, MatchState *state); // returns false on a damaged blob
+};
+
+#endif // MATCHSTATE_H
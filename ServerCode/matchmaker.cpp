@@ -0,0 +1,208 @@
+// matchmaker.cpp
+#include "matchmaker.h"
+#include <QDebug>
+#include <algorithm>
+#include <numeric>
+
+constexpr int PASS_INTERVAL_MS = 500;     // passes are batched, joining never triggers one
+constexpr int PASS_BUDGET = 1024;         // most tickets looked at in one pass, the longest waiting first
+constexpr int BASE_RATING_GAP = 100;      // widest rating gap inside a room for someone who just queued
+constexpr int RATING_GAP_PER_SECOND = 25; // how fast that gap grows while waiting
+constexpr int DEFAULT_MAX_WAIT_MS = 30000; // after this a room with fewer players is formed
+
+Matchmaker::Matchmaker(int roomSize, QObject *parent)
+    : QObject(parent),
+      playersPerRoom(qMax(2, roomSize)),
+      maxWaitMs(DEFAULT_MAX_WAIT_MS)
+{
+    if (qEnvironmentVariableIsSet("TRON_MATCH_MAX_WAIT")) {
+        maxWaitMs = qMax(0, qEnvironmentVariableIntValue("TRON_MATCH_MAX_WAIT"));
+    }
+
+    clock.start();
+    connect(&passTimer, &QTimer::timeout, this, &Matchmaker::runPass);
+    passTimer.start(PASS_INTERVAL_MS);
+}
+
+void Matchmaker::enqueue(Connection *connection, const QString &playerName, int rating)
+{
+    if (!connection || isQueued(connection)) {
+        return;
+    }
+
+    Ticket ticket;
+    ticket.connection = connection;
+    ticket.playerName = playerName;
+    ticket.rating = rating;
+    ticket.queuedAtMs = clock.elapsed();
+    ticket.number = nextTicket++;
+    ticketOf.insert(connection, ticket.number);
+    queue.append(ticket);
+}
+
+bool Matchmaker::remove(Connection *connection)
+{
+    // The ticket itself stays in the queue until the next pass drops it, so leaving costs the same at any queue length
+    return ticketOf.remove(connection) > 0;
+}
+
+bool Matchmaker::isQueued(Connection *connection) const
+{
+    return ticketOf.contains(connection);
+}
+
+void Matchmaker::clear()
+{
+    queue.clear();
+    ticketOf.clear();
+}
+
+int Matchmaker::allowedRatingGap(qint64 waitedMs) const
+{
+    return BASE_RATING_GAP + int(waitedMs / 1000) * RATING_GAP_PER_SECOND;
+}
+
+void Matchmaker::runPass()
+{
+    // Tickets of players who left since the last pass; the connection may even be gone
+    if (queue.size() != ticketOf.size()) {
+        QList<Ticket> live;
+        live.reserve(ticketOf.size());
+        for (const Ticket &ticket : queue) {
+            if (isLive(ticket)) {
+                live.append(ticket);
+            }
+        }
+        queue = live;
+    }
+    if (queue.size() < 2) {
+        return;
+    }
+
+    QElapsedTimer passClock;
+    passClock.start();
+    qint64 now = clock.elapsed();
+
+    // Only the front of the queue is considered, so a pass costs the same however many are waiting
+    const int considered = qMin(queue.size(), PASS_BUDGET);
+    QVector<int> byRating(considered);
+    std::iota(byRating.begin(), byRating.end(), 0);
+    std::stable_sort(byRating.begin(), byRating.end(), [this](int a, int b) {
+        return queue[a].rating < queue[b].rating;
+    });
+
+    QVector<bool> matched(considered, false);
+    int roomsFormed = 0;
+
+    // Full rooms: neighbours in rating order, as long as the longest waiting of them accepts the gap
+    int first = 0;
+    while (first + playersPerRoom <= considered) {
+        int last = first + playersPerRoom - 1;
+        qint64 oldestWait = 0;
+        for (int i = first; i <= last; ++i) {
+            oldestWait = qMax(oldestWait, now - queue[byRating[i]].queuedAtMs);
+        }
+
+        if (queue[byRating[last]].rating - queue[byRating[first]].rating > allowedRatingGap(oldestWait)) {
+            ++first;
+            continue;
+        }
+
+        QVector<Ticket> tickets;
+        for (int i = first; i <= last; ++i) {
+            tickets.append(queue[byRating[i]]);
+            matched[byRating[i]] = true;
+        }
+        formRoom(tickets, now);
+        ++roomsFormed;
+        first = last + 1;
+    }
+
+    // Someone who has waited too long plays in a smaller room with the nearest ratings still left;
+    // everyone else keeps waiting for a full room
+    QVector<int> leftovers; // indexes into the queue, by rating
+    QVector<int> overdue;   // positions in leftovers
+    for (int index : byRating) {
+        if (!matched[index]) {
+            if (now - queue[index].queuedAtMs >= maxWaitMs) {
+                overdue.append(leftovers.size());
+            }
+            leftovers.append(index);
+        }
+    }
+    std::stable_sort(overdue.begin(), overdue.end(), [&](int a, int b) {
+        return queue[leftovers[a]].queuedAtMs < queue[leftovers[b]].queuedAtMs; // longest waiting first
+    });
+    for (int position : overdue) {
+        if (matched[leftovers[position]]) {
+            continue; // already in the room of someone who waited longer
+        }
+
+        const int rating = queue[leftovers[position]].rating;
+        QVector<int> members = {leftovers[position]};
+        int below = position - 1;
+        int above = position + 1;
+        while (members.size() < playersPerRoom) {
+            while (below >= 0 && matched[leftovers[below]]) {
+                --below;
+            }
+            while (above < leftovers.size() && matched[leftovers[above]]) {
+                ++above;
+            }
+            bool belowLeft = below >= 0;
+            bool aboveLeft = above < leftovers.size();
+            if (!belowLeft && !aboveLeft) {
+                break;
+            }
+            if (!aboveLeft || (belowLeft && rating - queue[leftovers[below]].rating <= queue[leftovers[above]].rating - rating)) {
+                members.append(leftovers[below--]);
+            } else {
+                members.append(leftovers[above++]);
+            }
+        }
+        if (members.size() < 2) {
+            break; // nobody left to play with, and nobody after this one will find anyone either
+        }
+
+        QVector<Ticket> tickets;
+        for (int index : members) {
+            tickets.append(queue[index]);
+            matched[index] = true;
+        }
+        formRoom(tickets, now);
+        ++roomsFormed;
+    }
+
+    if (roomsFormed == 0) {
+        return;
+    }
+
+    // Keep the rest in arrival order
+    QList<Ticket> remaining;
+    remaining.reserve(queue.size());
+    for (int i = 0; i < considered; ++i) {
+        if (!matched[i]) {
+            remaining.append(queue[i]);
+        }
+    }
+    remaining.append(queue.mid(considered));
+    queue = remaining;
+
+    qDebug() << "Matchmaking pass formed" << roomsFormed << "rooms in" << passClock.nsecsElapsed() / 1000 << "us,"
+             << queue.size() << "still queued, average wait" << averageWaitMs() << "ms";
+}
+
+void Matchmaker::formRoom(QVector<Ticket> tickets, qint64 now)
+{
+    std::sort(tickets.begin(), tickets.end(), [](const Ticket &a, const Ticket &b) {
+        return a.rating < b.rating;
+    });
+    for (const Ticket &ticket : tickets) {
+        qint64 waited = now - ticket.queuedAtMs;
+        ticketOf.remove(ticket.connection);
+        ++matchedCount;
+        totalWaitMs += waited;
+        longestWait = qMax(longestWait, waited);
+    }
+    emit roomFormed(tickets);
+}
@@ -0,0 +1,75 @@
+// matchmaker.h
+
+#ifndef MATCHMAKER_H
+#define MATCHMAKER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QString>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "connection.h"
+
+// Queue of players waiting for a match. Every pass looks at a bounded number of
+// the longest waiting tickets, sorts them by rating and cuts them into rooms of
+// players with similar ratings; the rating gap allowed grows the longer someone
+// waits, and after the maximum wait a player is put in a smaller room with the
+// nearest ratings still waiting rather than none. Joining, leaving and lookups
+// go through an index and never scan the queue.
+class Matchmaker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_RATING = 1000; // players without a rating yet
+
+    struct Ticket {
+        Connection *connection = nullptr;
+        QString playerName;
+        int rating = DEFAULT_RATING;
+        qint64 queuedAtMs = 0;
+        quint64 number = 0; // order of queueing, tells a live ticket from one left behind by remove()
+    };
+
+    Matchmaker(int roomSize, QObject *parent = nullptr);
+
+    int roomSize() const { return playersPerRoom; }
+    void enqueue(Connection *connection, const QString &playerName, int rating = DEFAULT_RATING);
+    bool remove(Connection *connection); // false if they were not queued
+    bool isQueued(Connection *connection) const;
+    int queuedCount() const { return ticketOf.size(); }
+    void clear();
+
+    // Time to match, over every player matched so far
+    qint64 matchedPlayers() const { return matchedCount; }
+    qint64 averageWaitMs() const { return matchedCount ? totalWaitMs / matchedCount : 0; }
+    qint64 summedWaitMs() const { return totalWaitMs; }
+    qint64 longestWaitMs() const { return longestWait; }
+
+signals:
+    void roomFormed(const QVector<Matchmaker::Ticket> &tickets);
+
+private slots:
+    void runPass();
+
+private:
+    int allowedRatingGap(qint64 waitedMs) const;
+    void formRoom(QVector<Ticket> tickets, qint64 now);
+    bool isLive(const Ticket &ticket) const { return ticketOf.value(ticket.connection) == ticket.number; }
+
+    int playersPerRoom;
+    int maxWaitMs;
+    QList<Ticket> queue;                  // oldest first, may still hold removed tickets until the next pass
+    QHash<Connection*, quint64> ticketOf; // number of each queued connection's live ticket
+    quint64 nextTicket = 1;
+    QTimer passTimer;
+    QElapsedTimer clock;
+
+    qint64 matchedCount = 0;
+    qint64 totalWaitMs = 0;
+    qint64 longestWait = 0;
+};
+
+#endif // MATCHMAKER_H
@@ -0,0 +1,68 @@
+// metricsServer.cpp
+#include "metricsServer.h"
+#include <QTimer>
+#include <QDebug>
+
+constexpr int MAX_REQUEST_BYTES = 8192;    // scrapers send a few hundred bytes of headers
+constexpr int REQUEST_TIMEOUT_MS = 5000;   // drop connections that never finish their request
+
+MetricsServer::MetricsServer(std::function<QByteArray()> collector, QObject *parent)
+    : QObject(parent),
+      server(new QTcpServer(this)),
+      collect(collector)
+{
+    connect(server, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::listen(quint16 port)
+{
+    if (!server->listen(QHostAddress::LocalHost, port)) {
+        qWarning() << "Metrics endpoint failed to listen:" << server->errorString();
+        return false;
+    }
+    return true;
+}
+
+void MetricsServer::close()
+{
+    server->close();
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (QTcpSocket *socket = server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            // Only the request line matters, wait until the headers are complete
+            QByteArray request = socket->peek(MAX_REQUEST_BYTES);
+            if (request.contains("\r\n\r\n") || request.contains("\n\n") || request.size() >= MAX_REQUEST_BYTES) {
+                respond(socket);
+            }
+        });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        QTimer::singleShot(REQUEST_TIMEOUT_MS, socket, &QTcpSocket::abort);
+    }
+}
+
+void MetricsServer::respond(QTcpSocket *socket)
+{
+    QList<QByteArray> requestLine = socket->readLine().trimmed().split(' ');
+    socket->readAll();
+    disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+
+    QByteArray status = "200 OK";
+    QByteArray body;
+    if (requestLine.size() < 2 || requestLine[0] != "GET") {
+        status = "405 Method Not Allowed";
+    } else if (requestLine[1] != "/metrics" && requestLine[1] != "/") {
+        status = "404 Not Found";
+    } else {
+        body = collect();
+    }
+
+    QByteArray response = "HTTP/1.0 " + status + "\r\n"
+                          "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n" + body;
+    socket->write(response);
+    socket->disconnectFromHost(); // after the response has been written
+}
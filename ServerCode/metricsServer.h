@@ -0,0 +1,37 @@
+// metricsServer.h
+
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QByteArray>
+#include <functional>
+
+// Minimal HTTP endpoint on localhost that answers GET /metrics with the text the
+// collector builds at that moment, for Prometheus style scrapers. One request per
+// connection, nothing is kept between scrapes.
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    MetricsServer(std::function<QByteArray()> collector, QObject *parent = nullptr);
+
+    bool listen(quint16 port); // localhost only
+    void close();
+    bool isListening() const { return server->isListening(); }
+    quint16 port() const { return server->serverPort(); }
+
+private slots:
+    void onNewConnection();
+
+private:
+    void respond(QTcpSocket *socket);
+
+    QTcpServer *server;
+    std::function<QByteArray()> collect;
+};
+
+#endif // METRICSSERVER_H
@@ -13,3 +13,18 @@ void Movements::handleKeyPress(QKeyEvent *event, Player *player1, Player *player
         case Qt::Key_Right: player2->changeDirection(Player::Right); break;
     }
 }
+
+bool Movements::directionForKey(const QString &key, Player::Direction *direction) {
+    if (key == "W") {
+        *direction = Player::Up;
+    } else if (key == "S") {
+        *direction = Player::Down;
+    } else if (key == "A") {
+        *direction = Player::Left;
+    } else if (key == "D") {
+        *direction = Player::Right;
+    } else {
+        return false;
+    }
+    return true;
+}
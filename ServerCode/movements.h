@@ -9,6 +9,7 @@
 class Movements {
 public:
     static void handleKeyPress(QKeyEvent *event, Player *player1, Player *player2);
+    static bool directionForKey(const QString &key, Player::Direction *direction); // W, A, S or D as sent in PLAYERMOVE
 };
 
 #endif // MOVEMENTS_H
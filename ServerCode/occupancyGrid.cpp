@@ -0,0 +1,169 @@
+// occupancyGrid.cpp
+#include "occupancyGrid.h"
+#include <cmath>
+
+static int popcount64(quint64 value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(value);
+#else
+    int count = 0;
+    while (value) {
+        value &= value - 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+OccupancyGrid::OccupancyGrid(int sceneWidth, int sceneHeight, int cellSize)
+    : sceneWidth(sceneWidth),
+      sceneHeight(sceneHeight),
+      cellSize(cellSize),
+      arenaColumns((sceneWidth + cellSize - 1) / cellSize),
+      arenaRows((sceneHeight + cellSize - 1) / cellSize),
+      columnCount(qMin(arenaColumns, int(MAX_VIEW_CELLS))),
+      rowCount(qMin(arenaRows, int(MAX_VIEW_CELLS))),
+      wordsPerRow((columnCount + 63) / 64),
+      lastWordMask(columnCount % 64 ? (quint64(1) << (columnCount % 64)) - 1 : ~quint64(0)),
+      blocked(rowCount * wordsPerRow, 0)
+{
+    clear();
+}
+
+void OccupancyGrid::centerOn(const QPointF &scenePos)
+{
+    int column = int(std::floor((scenePos.x() + sceneWidth / 2.0) / cellSize));
+    int row = int(std::floor((scenePos.y() + sceneHeight / 2.0) / cellSize));
+    originColumn = qBound(0, column - columnCount / 2, arenaColumns - columnCount);
+    originRow = qBound(0, row - rowCount / 2, arenaRows - rowCount);
+}
+
+bool OccupancyGrid::inView(const QPointF &scenePos) const
+{
+    int column = int(std::floor((scenePos.x() + sceneWidth / 2.0) / cellSize)) - originColumn;
+    int row = int(std::floor((scenePos.y() + sceneHeight / 2.0) / cellSize)) - originRow;
+    return column >= 0 && row >= 0 && column < columnCount && row < rowCount;
+}
+
+void OccupancyGrid::clear()
+{
+    blocked.fill(0);
+
+    // The border ring is a wall
+    for (int column = 0; column < columnCount; ++column) {
+        setBit(blocked, column, 0);
+        setBit(blocked, column, rowCount - 1);
+    }
+    for (int row = 0; row < rowCount; ++row) {
+        setBit(blocked, 0, row);
+        setBit(blocked, columnCount - 1, row);
+    }
+}
+
+void OccupancyGrid::markTrails(const TrailGrid &trails)
+{
+    // A trail is as wide as a cell, so wherever it runs it covers a row or column of
+    // cell centers; sampling only the centers keeps a bot's newest trail, which lies
+    // behind its center, out of the cells ahead of it. Only chunks holding trail are visited.
+    QRect window(originColumn * cellSize, originRow * cellSize, columnCount * cellSize, rowCount * cellSize);
+    for (const QRect &used : trails.usedAreas()) {
+        QRect area = used & window;
+        if (area.isEmpty()) {
+            continue;
+        }
+        int firstRow = (area.top() - cellSize / 2 + cellSize - 1) / cellSize;
+        int firstColumn = (area.left() - cellSize / 2 + cellSize - 1) / cellSize;
+        for (int row = firstRow; row * cellSize + cellSize / 2 <= area.bottom(); ++row) {
+            int y = row * cellSize + cellSize / 2;
+            for (int column = firstColumn; column * cellSize + cellSize / 2 <= area.right(); ++column) {
+                if (trails.isOccupiedAt(column * cellSize + cellSize / 2, y)) {
+                    setBit(blocked, column - originColumn, row - originRow);
+                }
+            }
+        }
+    }
+}
+
+QPoint OccupancyGrid::cellAt(const QPointF &scenePos) const
+{
+    int column = int(std::floor((scenePos.x() + sceneWidth / 2.0) / cellSize)) - originColumn;
+    int row = int(std::floor((scenePos.y() + sceneHeight / 2.0) / cellSize)) - originRow;
+    return QPoint(qBound(0, column, columnCount - 1), qBound(0, row, rowCount - 1));
+}
+
+bool OccupancyGrid::isBlocked(const QPoint &cell) const
+{
+    if (cell.x() < 0 || cell.y() < 0 || cell.x() >= columnCount || cell.y() >= rowCount) {
+        return true;
+    }
+    return blocked[cell.y() * wordsPerRow + cell.x() / 64] & (quint64(1) << (cell.x() % 64));
+}
+
+int OccupancyGrid::territory(const QPoint &start, const QVector<QPoint> &opponents) const
+{
+    const int size = blocked.size();
+    Bits mine(size, 0), theirs(size, 0), claimed(size, 0);
+    Bits grownMine(size, 0), grownTheirs(size, 0);
+
+    setBit(mine, start.x(), start.y());
+    for (const QPoint &cell : opponents) {
+        setBit(theirs, cell.x(), cell.y());
+    }
+    for (int i = 0; i < size; ++i) {
+        claimed[i] = mine[i] | theirs[i] | blocked[i];
+    }
+
+    // Grow both fronts one step at a time; a cell goes to whoever reaches it first
+    int owned = 0;
+    bool growing = true;
+    while (growing) {
+        dilate(mine, grownMine);
+        dilate(theirs, grownTheirs);
+
+        growing = false;
+        for (int i = 0; i < size; ++i) {
+            quint64 newMine = grownMine[i] & ~claimed[i];
+            quint64 newTheirs = grownTheirs[i] & ~claimed[i];
+            quint64 contested = newMine & newTheirs;
+            mine[i] = newMine & ~contested;
+            theirs[i] = newTheirs & ~contested;
+            claimed[i] |= newMine | newTheirs;
+            owned += popcount64(mine[i]);
+            growing = growing || newMine || newTheirs;
+        }
+    }
+    return owned;
+}
+
+void OccupancyGrid::setBit(Bits &bits, int column, int row) const
+{
+    if (column < 0 || row < 0 || column >= columnCount || row >= rowCount) {
+        return;
+    }
+    bits[row * wordsPerRow + column / 64] |= quint64(1) << (column % 64);
+}
+
+void OccupancyGrid::dilate(const Bits &in, Bits &out) const
+{
+    for (int row = 0; row < rowCount; ++row) {
+        const quint64 *line = in.constData() + row * wordsPerRow;
+        const quint64 *above = row > 0 ? line - wordsPerRow : nullptr;
+        const quint64 *below = row < rowCount - 1 ? line + wordsPerRow : nullptr;
+        quint64 *result = out.data() + row * wordsPerRow;
+
+        for (int word = 0; word < wordsPerRow; ++word) {
+            quint64 value = line[word];
+            quint64 left = (value << 1) | (word > 0 ? line[word - 1] >> 63 : 0);
+            quint64 right = (value >> 1) | (word < wordsPerRow - 1 ? line[word + 1] << 63 : 0);
+            quint64 grown = value | left | right;
+            if (above) {
+                grown |= above[word];
+            }
+            if (below) {
+                grown |= below[word];
+            }
+            result[word] = word == wordsPerRow - 1 ? grown & lastWordMask : grown;
+        }
+    }
+}
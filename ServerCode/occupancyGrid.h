@@ -0,0 +1,60 @@
+// occupancyGrid.h
+
+#ifndef OCCUPANCYGRID_H
+#define OCCUPANCYGRID_H
+
+#include <QPoint>
+#include <QPointF>
+#include <QVector>
+#include <QtGlobal>
+#include "../Common/trailGrid.h"
+
+// Coarse bitmap of the arena, one bit per cell, set where a player would crash.
+// Rows are packed into 64-bit words so that a flood fill advances a whole row
+// per word operation instead of one cell at a time. On arenas larger than
+// MAX_VIEW_CELLS a side the bitmap is a window that is moved to each bot in turn,
+// so its cost stays the same however big the arena gets.
+class OccupancyGrid
+{
+public:
+    typedef QVector<quint64> Bits; // rows * wordsPerRow words, row major
+
+    static constexpr int MAX_VIEW_CELLS = 128; // widest and tallest the window gets
+
+    OccupancyGrid(int sceneWidth, int sceneHeight, int cellSize);
+
+    bool coversArena() const { return columnCount == arenaColumns && rowCount == arenaRows; }
+    void centerOn(const QPointF &scenePos); // move the window, clamped to the arena; clear() and markTrails() again after
+    bool inView(const QPointF &scenePos) const;
+
+    void clear(); // everything free except the border ring, which is the arena's border or the window's edge
+    void markTrails(const TrailGrid &trails); // a cell is blocked when the trail covers its center
+
+    QPoint cellAt(const QPointF &scenePos) const; // clamped to the window
+    bool isBlocked(const QPoint &cell) const; // outside the grid counts as blocked
+    int columns() const { return columnCount; }
+    int rows() const { return rowCount; }
+
+    // Cells that one player reaches strictly before all the others, moving one cell per step.
+    // Every player starts from a single cell; cells reached at the same time belong to nobody.
+    int territory(const QPoint &start, const QVector<QPoint> &opponents) const;
+
+private:
+    void setBit(Bits &bits, int column, int row) const;
+    void dilate(const Bits &in, Bits &out) const; // in plus its 4-neighbours
+
+    int sceneWidth;
+    int sceneHeight;
+    int cellSize;
+    int arenaColumns;
+    int arenaRows;
+    int columnCount; // of the window
+    int rowCount;
+    int originColumn = 0; // arena cell at the window's top left
+    int originRow = 0;
+    int wordsPerRow;
+    quint64 lastWordMask; // valid columns in the last word of a row
+    Bits blocked;
+};
+
+#endif // OCCUPANCYGRID_H
@@ -11,30 +11,35 @@ Player::Player(const QPixmap &pixmap, int startX, int startY)
 }
 
 void Player::move() {
-    int x = pos().x();
-    int y = pos().y();
-
-    switch (currentDirection) {
-        case Up:    setPos(x, y - 5); break;
-        case Down:  setPos(x, y + 5); break;
-        case Left:  setPos(x - 5, y); break;
-        case Right: setPos(x + 5, y); break;
-    }
+    setPos(step(pos().toPoint(), currentDirection, STEP_SIZE));
     leaveTrail();
 }
 
 void Player::changeDirection(Direction newDirection) {
-    if ((currentDirection == Up && newDirection != Down) ||
-        (currentDirection == Down && newDirection != Up) ||
-        (currentDirection == Left && newDirection != Right) ||
-        (currentDirection == Right && newDirection != Left))
-    {
+    if (canTurn(currentDirection, newDirection)) {
         currentDirection = newDirection;
     }
 }
 
+QPoint Player::step(const QPoint &position, Direction direction, int distance) {
+    switch (direction) {
+        case Up:    return QPoint(position.x(), position.y() - distance);
+        case Down:  return QPoint(position.x(), position.y() + distance);
+        case Left:  return QPoint(position.x() - distance, position.y());
+        case Right: return QPoint(position.x() + distance, position.y());
+    }
+    return position;
+}
+
+bool Player::canTurn(Direction from, Direction to) {
+    return (from == Up && to != Down) ||
+           (from == Down && to != Up) ||
+           (from == Left && to != Right) ||
+           (from == Right && to != Left);
+}
+
 void Player::leaveTrail() {
-    QGraphicsRectItem *trailPart = new QGraphicsRectItem(x(), y(), 5, 5);
+    QGraphicsRectItem *trailPart = new QGraphicsRectItem(x(), y(), STEP_SIZE, STEP_SIZE);
     trailPart->setBrush(QBrush(Qt::yellow)); // Explicitly create a QBrush with the color
     trail.append(trailPart);
 }
@@ -6,16 +6,22 @@
 #include <QGraphicsPixmapItem>
 #include <QGraphicsRectItem>
 #include <QList>
+#include <QPoint>
 
 class Player : public QGraphicsPixmapItem {
 public:
     enum Direction { Up, Down, Left, Right };
+    static constexpr int STEP_SIZE = 5; // how far a player moves per step, also the size of a trail part
 
     Player(const QPixmap &pixmap, int startX, int startY);
     void move();
     void changeDirection(Direction newDirection);
     void leaveTrail();
 
+    // The rules behind move() and changeDirection(), in whole numbers so they can be used on a grid
+    static QPoint step(const QPoint &position, Direction direction, int distance);
+    static bool canTurn(Direction from, Direction to); // anything but straight back
+
     Direction currentDirection;
     QList<QGraphicsRectItem *> trail; // List of trail segments
 };
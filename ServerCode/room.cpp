@@ -0,0 +1,217 @@
+// room.cpp
+#include "room.h"
+#include "../Common/datagram.h"
+#include "../Common/metrics.h"
+#include <QDateTime>
+#include <QDir>
+#include <QDebug>
+
+constexpr int ARCHIVE_TICK_MS = 10; // the game's tick length
+
+Room::Room(int id, UdpChannel *udpChannel, GamePool *pool, QObject *parent)
+    : QObject(parent),
+      roomId(id),
+      udpChannel(udpChannel),
+      pool(pool),
+      arenaSize(Game::DEFAULT_ARENA_WIDTH, Game::DEFAULT_ARENA_HEIGHT)
+{
+}
+
+Room::~Room()
+{
+    if (!match) {
+        return;
+    }
+    match->disconnect(this);
+    if (pool) {
+        pool->release(match);
+    } else {
+        delete match;
+    }
+}
+
+void Room::addMember(Connection *connection, const QString &playerName)
+{
+    if (!connection || names.contains(connection)) {
+        return;
+    }
+    memberList.append(connection);
+    names.insert(connection, playerName);
+}
+
+void Room::removeMember(Connection *connection)
+{
+    memberList.removeOne(connection);
+    names.remove(connection);
+}
+
+QStringList Room::playerNames() const
+{
+    QStringList result;
+    for (Connection *connection : memberList) {
+        result.append(names.value(connection));
+    }
+    return result;
+}
+
+void Room::start(int botCount, bool showWindow)
+{
+    broadcast(SharedMessage::fromBytes("GAME_START"));
+
+    match = pool->acquire(); // reset and ready, nothing to build
+    match->setArenaSize(arenaSize);
+    match->setRules(rules);
+    match->setModal(false); // Make it non-modal
+    match->setWindowTitle("Game - Room " + QString::number(roomId));
+    if (showWindow) {
+        match->show();
+    }
+
+    // Add all players to the game
+    for (const QString &playerName : playerNames()) {
+        match->addPlayer(playerName);
+    }
+    for (int i = 0; i < botCount; ++i) {
+        match->addBot("Bot " + QString::number(i + 1));
+    }
+    for (Connection *connection : memberList) {
+        sendArena(connection);
+    }
+
+    // Record the match; the first snapshot is always preceded by a keyframe, so the archive starts with one
+    QString archiveDir = qEnvironmentVariable("TRON_ARCHIVE_DIR");
+    if (!archiveDir.isEmpty()) {
+        QString fileName = "match-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + "-room" + QString::number(roomId) + ".tronarc";
+        archive.open(QDir(archiveDir).filePath(fileName), match->arenaSize().width(), match->arenaSize().height(), ARCHIVE_TICK_MS);
+    }
+
+    run();
+}
+
+bool Room::restore(const MatchState &state)
+{
+    match = pool->acquire();
+    match->setModal(false);
+    match->setWindowTitle("Game - Room " + QString::number(roomId));
+    if (!match->restoreState(state)) {
+        pool->release(match);
+        match = nullptr;
+        return false;
+    }
+
+    // Not archived: an archive has to start at the match's first keyframe
+    run();
+    return true;
+}
+
+void Room::run()
+{
+    connect(match, &Game::gameEnded, this, &Room::onGameEnded);
+    connect(match, &Game::snapshotReady, this, &Room::onSnapshotReady);
+    connect(match, &Game::keyframeReady, this, &Room::onKeyframeReady);
+    match->begin();
+}
+
+void Room::broadcast(const SharedMessage &message)
+{
+    for (Connection *connection : memberList) {
+        connection->send(message);
+    }
+}
+
+void Room::chat(const SharedMessage &message)
+{
+    chatHistory.append(message);
+    broadcast(message);
+}
+
+void Room::processInput(Connection *connection, const QString &key, qint64 clientTick)
+{
+    if (!match || !names.contains(connection)) {
+        return;
+    }
+    QString playerName = names.value(connection);
+    if (archive.isOpen() && !key.isEmpty()) {
+        QByteArray turn;
+        turn.append(char(match->playerId(playerName)));
+        turn.append(key.at(0).toLatin1());
+        archive.write(MatchArchive::Input, match->currentTick(), turn);
+    }
+    match->processClientInput(playerName, key, clientTick);
+}
+
+void Room::resync(Connection *connection)
+{
+    if (!match || !names.contains(connection)) {
+        return;
+    }
+
+    // Everything needed to draw the arena again goes out in one burst, snapshots follow as usual
+    connection->send(SharedMessage::fromBytes("GAME_START"));
+    sendArena(connection);
+    chatHistory.replayTo(connection); // what was said while they were away
+}
+
+void Room::sendArena(Connection *connection)
+{
+    connection->send(SharedMessage::fromBytes("KEYFRAME:" + match->buildKeyframe().encode().toBase64()));
+    connection->send(SharedMessage::fromBytes("PLAYER_ID:" + QByteArray::number(match->playerId(names.value(connection)))));
+}
+
+void Room::onSnapshotReady(const Snapshot &snapshot)
+{
+    QByteArray payload = snapshot.encode();
+    Datagram datagram;
+    datagram.type = Datagram::State;
+    datagram.payload = payload;
+    QByteArray encoded = datagram.encode(); // encoded once for every UDP recipient that sees everything
+
+    // Spectators always get the TCP form, so it is built once per snapshot and shared by all of them
+    SharedMessage tcpMessage = SharedMessage::fromBytes("SNAPSHOT:" + payload.toBase64());
+
+    // Members only hear about players near them at full rate; when that is everyone, the shared encoding goes out
+    interest.update(snapshot);
+    for (Connection *connection : memberList) {
+        bool complete = true;
+        Snapshot view = interest.viewFor(match->playerId(names.value(connection)), &complete);
+        if (connection->hasUdpEndpoint()) {
+            if (complete) {
+                udpChannel->sendTo(encoded, connection->udpAddress(), connection->udpEndpointPort());
+            } else {
+                Datagram partial;
+                partial.type = Datagram::State;
+                partial.payload = view.encode();
+                udpChannel->sendTo(partial.encode(), connection->udpAddress(), connection->udpEndpointPort());
+            }
+        } else {
+            connection->send(complete ? tcpMessage : SharedMessage::fromBytes("SNAPSHOT:" + view.encode().toBase64()));
+        }
+    }
+    Metrics::add(Metrics::SnapshotMessages, quint64(memberList.size()));
+    emit snapshotPublished(tcpMessage);
+
+    if (archive.isOpen()) {
+        archive.write(MatchArchive::Snapshot, match->currentTick(), payload);
+    }
+}
+
+void Room::onKeyframeReady(const QByteArray &payload)
+{
+    if (archive.isOpen()) {
+        archive.write(MatchArchive::Keyframe, match->currentTick(), payload);
+    }
+    emit keyframePublished(payload);
+}
+
+void Room::onGameEnded()
+{
+    broadcast(SharedMessage::fromBytes("GAME_END"));
+    if (archive.isOpen()) {
+        archive.finish();
+    }
+    if (match) {
+        match->accept(); // End the game window
+    }
+    qDebug() << "Room" << roomId << "finished.";
+    emit finished(this);
+}
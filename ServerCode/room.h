@@ -0,0 +1,76 @@
+// room.h
+
+#ifndef ROOM_H
+#define ROOM_H
+
+#include <QObject>
+#include <QPointer>
+#include <QList>
+#include <QHash>
+#include <QStringList>
+#include "game.h"
+#include "gamePool.h"
+#include "connection.h"
+#include "sharedMessage.h"
+#include "chatHistory.h"
+#include "interestFilter.h"
+#include "../Common/udpChannel.h"
+#include "../Common/matchArchive.h"
+
+// One running match: the connections playing in it and their Game. The lobby's
+// match is a room, and so is every match the matchmaker forms, so several can
+// run side by side on the same server.
+class Room : public QObject
+{
+    Q_OBJECT
+
+public:
+    Room(int id, UdpChannel *udpChannel, GamePool *pool, QObject *parent = nullptr);
+    ~Room();
+
+    int id() const { return roomId; }
+    Game *game() const { return match; }
+
+    void addMember(Connection *connection, const QString &playerName);
+    void removeMember(Connection *connection); // their player stays in the match, they just stop hearing about it
+    const QList<Connection*> &members() const { return memberList; }
+    QStringList playerNames() const; // in the order they joined
+    QString playerName(Connection *connection) const { return names.value(connection); }
+
+    void setArenaSize(const QSize &size) { arenaSize = size; } // before start(), the game clamps it
+    void setRules(Simulation::Rules gameRules) { rules = gameRules; } // before start()
+    void start(int botCount, bool showWindow); // GAME_START, the empty arena and their player id to every member, then the match runs
+    bool restore(const MatchState &state); // carry on a match another process handed over; members come back by resuming
+    void broadcast(const SharedMessage &message);
+    void chat(const SharedMessage &message); // broadcast and remember it for members coming back
+    void processInput(Connection *connection, const QString &key, qint64 clientTick = -1); // a turn from one of the members, with the tick they saw if known
+    void resync(Connection *connection); // GAME_START, a keyframe of the match as it is now and their player id, for a member coming back
+
+signals:
+    void snapshotPublished(const SharedMessage &message); // TCP form of every snapshot, for spectators
+    void keyframePublished(const QByteArray &payload);
+    void finished(Room *room); // GAME_END has been sent
+
+private slots:
+    void onSnapshotReady(const Snapshot &snapshot); // each member's view, over UDP when they have it
+    void onKeyframeReady(const QByteArray &payload);
+    void onGameEnded();
+
+private:
+    void sendArena(Connection *connection); // keyframe and player id, all a client needs to size and follow its view
+    void run(); // hear about the game's ticks and start them
+
+    int roomId;
+    UdpChannel *udpChannel;
+    QPointer<GamePool> pool; // where the game comes from and goes back to
+    QPointer<Game> match;    // the window may be destroyed along with its parent first
+    QSize arenaSize;
+    Simulation::Rules rules = Simulation::ContinuousRules;
+    QList<Connection*> memberList;
+    QHash<Connection*, QString> names;
+    ChatHistory chatHistory;
+    InterestFilter interest;
+    MatchArchiveWriter archive; // only open when TRON_ARCHIVE_DIR is set
+};
+
+#endif // ROOM_H
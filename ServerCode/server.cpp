@@ -18,11 +18,43 @@
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <QLabel>
+#include <QRandomGenerator>
+#include <QCoreApplication>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextDocument>
+#include "sharedListener.h"
+#include "../Common/bitStream.h"
+#include "../Common/datagram.h"
+#include "../Common/metrics.h"
+
+constexpr int MAX_LOG_LINES = 500;  // older lines are dropped, so a server left running for days keeps a bounded log
+constexpr int MAX_ROOM_SIZE = 16;  // start positions and colors repeat beyond four, but past this the arena is too crowded
+constexpr int RATING_STEP = 16;    // rating the winner gains and the last player loses
+constexpr int DEFAULT_POOLED_GAMES = 1;              // the lobby runs one match at a time
+constexpr int DEFAULT_POOLED_GAMES_MATCHMAKING = 4;  // matchmade rooms come and go side by side
+constexpr quint32 HANDOVER_VERSION = 1;
+constexpr quint32 MAX_HANDOVER_BYTES = 1 << 24; // one match's state, far past any real arena
+
+// Names are sent inside join, chat and resume lines, so none may read as a control message
+static bool isValidPlayerName(const QString &name)
+{
+    static const QStringList reserved = {"CHAT", "GAME_START", "GAME_END", "SESSION", "RESUMED", "RESUME",
+                                         "UDP_OFFER", "SNAPSHOT", "KEYFRAME", "PLAYER_ID", "PLAYERMOVE",
+                                         "READY", "NOT_READY", "SPECTATE"};
+    // Without ':' a name can only pass for a command by being one, "SNAPSHOT" chatting "SNAPSHOT: <base64>"
+    return !name.trimmed().isEmpty() && !name.contains(':') && !reserved.contains(name.trimmed());
+}
 
 Dialog::Dialog(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::Dialog),
-    tcpServer(new QTcpServer(this))
+    tcpServer(new QTcpServer(this)),
+    udpChannel(new UdpChannel(this)),
+    spectatorRelay(new SpectatorRelay(this)),
+    sessions(new SessionTable(this)),
+    arenaSize(Game::DEFAULT_ARENA_WIDTH, Game::DEFAULT_ARENA_HEIGHT),
+    metricsServer(new MetricsServer([this]() { return renderMetrics(); }, this))
      //game(new Game(this))               // Initialize the TCP server
 {
     ui->setupUi(this); // necessary lol
@@ -45,6 +77,7 @@ Dialog::Dialog(QWidget *parent) :
     // Apply font and styles to UI elements
     ui->logOutput->setStyleSheet("background-color: #282828; color: #00FFFF; border: 2px solid #00FFFF; font-size: 14px; padding: 5px;");
     ui->logOutput->setFont(customFont);
+    ui->logOutput->document()->setMaximumBlockCount(MAX_LOG_LINES);
 
     ui->player1Label->setStyleSheet("color: #00FFFF; font-weight: bold;");
     ui->player1Label->setFont(customFont);
@@ -86,6 +119,40 @@ Dialog::Dialog(QWidget *parent) :
 
     // Connect the QTcpServer signal for new connections
     connect(tcpServer, &QTcpServer::newConnection, this, &Dialog::acceptConnection);
+    connect(udpChannel, &UdpChannel::datagramReceived, this, &Dialog::onDatagramReceived);
+
+    connect(sessions, &SessionTable::expired, this, [this](const QString &playerName) {
+        ui->logOutput->append(playerName + " did not come back in time.");
+        updateListening();
+    });
+
+    // Larger arenas only cost memory where trails are laid, the game clamps the size
+    if (qEnvironmentVariableIsSet("TRON_ARENA_WIDTH")) {
+        arenaSize.setWidth(qEnvironmentVariableIntValue("TRON_ARENA_WIDTH"));
+    }
+    if (qEnvironmentVariableIsSet("TRON_ARENA_HEIGHT")) {
+        arenaSize.setHeight(qEnvironmentVariableIntValue("TRON_ARENA_HEIGHT"));
+    }
+    if (qEnvironmentVariableIntValue("TRON_GRID_RULES") != 0) {
+        rules = Simulation::GridRules; // whole cells at a time, crashes come out the same on every machine
+    }
+
+    // TRON_ROOM_SIZE switches from the single ready-up lobby to a matchmaking queue
+    int roomSize = qEnvironmentVariableIntValue("TRON_ROOM_SIZE");
+    if (roomSize >= 2) {
+        matchmaker = new Matchmaker(qMin(roomSize, MAX_ROOM_SIZE), this);
+        connect(matchmaker, &Matchmaker::roomFormed, this, &Dialog::onRoomFormed);
+    }
+
+    // Games are built ahead of time and reused, TRON_ROOM_POOL sets how many are kept
+    int pooledGames = matchmaker ? DEFAULT_POOLED_GAMES_MATCHMAKING : DEFAULT_POOLED_GAMES;
+    if (qEnvironmentVariableIsSet("TRON_ROOM_POOL")) {
+        pooledGames = qMax(0, qEnvironmentVariableIntValue("TRON_ROOM_POOL"));
+    }
+    gamePool = new GamePool(this, pooledGames, this);
+
+    // Matches still running when the server stops are written here and picked up by the next start
+    handoverPath = qEnvironmentVariable("TRON_HANDOVER_FILE");
 }
 
 
@@ -93,7 +160,7 @@ Dialog::~Dialog()
 {
     delete ui; // destructor
     delete tcpServer;
-    delete game;
+    qDeleteAll(rooms);
 
     for(QTcpSocket* obj: playerSockets){
         delete obj;
@@ -157,24 +224,27 @@ void Dialog::on_startServerButton_clicked() {
     if (dialog.exec() == QDialog::Accepted) {
         // Get port value
         int port = portInput->text().toInt();
-        if (tcpServer->listen(QHostAddress::Any, port)) {
-            QString ipAddress;
-            ui->startServerButton->setEnabled(false);
-            ui->stopServerButton->setEnabled(true);
 
-            const QList<QHostAddress> &allAddresses = QNetworkInterface::allAddresses();
-            for (const QHostAddress &address : allAddresses) {
-                if (address != QHostAddress::LocalHost && address.protocol() == QAbstractSocket::IPv4Protocol) {
-                    ipAddress = address.toString();
-                    break;
-                }
+        // TRON_WORKERS splits the server over that many processes sharing the port
+        int workerCount = qEnvironmentVariableIntValue("TRON_WORKERS");
+        if (workerCount >= 2) {
+            if (!supervisor) {
+                supervisor = new Supervisor(this);
+                connect(supervisor, &Supervisor::log, this, [this](const QString &line) { ui->logOutput->append(line); });
             }
+            if (supervisor->start(quint16(port), workerCount)) {
+                ui->startServerButton->setEnabled(false);
+                ui->stopServerButton->setEnabled(true);
+                ui->logOutput->append("Running " + QString::number(workerCount) + " workers on port " + QString::number(port));
+            } else {
+                QMessageBox::critical(this, "Error", "Server workers failed to start. Please try again.");
+            }
+            return;
+        }
 
-            if (ipAddress.isEmpty())
-                ipAddress = QHostAddress(QHostAddress::LocalHost).toString();
-
-            ui->logOutput->append("Server started on IP: " + ipAddress + ", Port: " + QString::number(port));
-            qDebug() << "Server started on IP:" << ipAddress << ", Port:" << port;
+        if (startServer(quint16(port))) {
+            ui->startServerButton->setEnabled(false);
+            ui->stopServerButton->setEnabled(true);
         } else {
             QMessageBox::critical(this, "Error", "Server failed to start. Please try again.");
             ui->logOutput->append("Server failed to start.");
@@ -187,15 +257,18 @@ void Dialog::on_startServerButton_clicked() {
 }
 
 
-void Dialog::broadcastMessage(const QByteArray &message)
+void Dialog::broadcastMessage(const SharedMessage &message)
 {
-    for (QTcpSocket *socket : playerSockets) {
-        if (socket) {  // make sure that the socket is valid
-            socket->write(message);   // send the message to that socket
-            qDebug() << message;
-            socket->flush();          // make sure that it's sent immediately
+    // the message was encoded once by the caller, every queue just shares it;
+    // players in a matchmade room only hear their own room
+    for (QTcpSocket *socket : playerNames.keys()) {
+        Connection *connection = connections.value(socket, nullptr);
+        Room *room = roomOf.value(connection, nullptr);
+        if (connection && (!room || room == lobbyRoom)) {  // make sure that the socket is valid
+            connection->send(message);
         }
     }
+    spectatorRelay->broadcast(message);
 }
 
 bool Dialog::getReadyStatus(int index) const // this function just checks to see if all of the players are ready
@@ -209,19 +282,146 @@ bool Dialog::getReadyStatus(int index) const // this function just checks to see
     }
 }
 
+bool Dialog::startServer(quint16 port)
+{
+    // Workers share the port with their siblings, a lone server has it to itself
+    bool listening = workerIndex >= 0 ? listenShared(tcpServer, port) : tcpServer->listen(QHostAddress::Any, port);
+    if (!listening) {
+        return false;
+    }
+    gamePort = port;
+
+    QString ipAddress;
+    const QList<QHostAddress> &allAddresses = QNetworkInterface::allAddresses();
+    for (const QHostAddress &address : allAddresses) {
+        if (address != QHostAddress::LocalHost && address.protocol() == QAbstractSocket::IPv4Protocol) {
+            ipAddress = address.toString();
+            break;
+        }
+    }
+
+    if (ipAddress.isEmpty())
+        ipAddress = QHostAddress(QHostAddress::LocalHost).toString();
+
+    ui->logOutput->append("Server started on IP: " + ipAddress + ", Port: " + QString::number(port));
+    qDebug() << "Server started on IP:" << ipAddress << ", Port:" << port;
+
+    // UDP is optional, clients that never complete the handshake stay on TCP. Datagrams to a
+    // shared port would reach any worker, so a worker takes a port of its own and offers that
+    if (udpChannel->bind(QHostAddress::Any, workerIndex >= 0 ? 0 : port)) {
+        ui->logOutput->append("UDP channel open on port " + QString::number(udpChannel->localPort()));
+    } else {
+        ui->logOutput->append("UDP channel unavailable, movement will use TCP.");
+    }
+
+    // Metrics stay on localhost; scrapers on the same machine forward them
+    int metricsPort = qEnvironmentVariableIsSet("TRON_METRICS_PORT") ? qEnvironmentVariableIntValue("TRON_METRICS_PORT") : port + 1;
+    if (metricsPort > 0 && metricsServer->listen(quint16(metricsPort))) {
+        ui->logOutput->append("Metrics on http://127.0.0.1:" + QString::number(metricsPort) + "/metrics");
+    }
+
+    gamePool->prewarm(); // the first match starts as fast as the rest
+    if (!handoverPath.isEmpty()) {
+        adoptRooms();
+    }
+    return true;
+}
+
+void Dialog::startWorker()
+{
+    workerIndex = qEnvironmentVariableIntValue("TRON_WORKER_INDEX");
+    sessions->setWorker(workerIndex); // a resume reaching one of our siblings is passed back here
+    quint16 port = quint16(qEnvironmentVariableIntValue("TRON_WORKER_PORT"));
+    if (!startServer(port)) {
+        qWarning() << "Worker" << workerIndex << "failed to listen on port" << port;
+        QTimer::singleShot(0, []() { QCoreApplication::exit(1); }); // the supervisor restarts us
+        return;
+    }
+
+    workerLink = new WorkerLink(workerIndex, [this]() {
+        WorkerLoad load;
+        load.players = connections.size();
+        load.rooms = rooms.size();
+        load.queued = matchmaker ? matchmaker->queuedCount() : 0;
+        return load;
+    }, this);
+
+    connect(workerLink, &WorkerLink::acceptChanged, this, [this](bool accept) {
+        acceptingNew = accept;
+        updateListening();
+    });
+    connect(workerLink, &WorkerLink::stopRequested, this, [this]() {
+        if (!handoverPath.isEmpty() && sessions->graceMs() > 0) {
+            handOverRooms(); // to this worker's own file, its successor picks it up
+        }
+        QCoreApplication::exit(0);
+    });
+    connect(workerLink, &WorkerLink::supervisorLost, this, []() { QCoreApplication::exit(2); });
+    workerLink->connectTo(qEnvironmentVariable("TRON_SUPERVISOR"));
+
+    handoff = new SocketHandoff(qEnvironmentVariable("TRON_SUPERVISOR"), workerIndex, this);
+    connect(handoff, &SocketHandoff::received, this, &Dialog::onConnectionHandedOver);
+    if (!handoff->listen()) {
+        qWarning() << "Worker" << workerIndex << "cannot take players from other workers, resumes must reach it directly";
+    }
+}
+
+void Dialog::updateListening()
+{
+    if (!workerLink) {
+        return; // a lone server listens from start to stop
+    }
+
+    // Closing the listener takes this worker out of the kernel's rotation for new connections;
+    // anything still in its backlog is reset and the client's retry lands on another worker.
+    // While it holds dropped players' places it keeps listening, so their resumes can reach it
+    bool listen = acceptingNew || !sessions->held().isEmpty();
+    if (listen && !tcpServer->isListening()) {
+        listenShared(tcpServer, gamePort);
+    } else if (!listen && tcpServer->isListening()) {
+        tcpServer->close();
+    }
+}
+
 void Dialog::on_stopServerButton_clicked() // this function is fired when the server's stop button is clicked
 {
+    if (supervisor && supervisor->isRunning()) { // the workers hold every connection, stopping them is all there is
+        supervisor->stop();
+        ui->startServerButton->setEnabled(true);
+        ui->stopServerButton->setEnabled(false);
+        ui->logOutput->append("Server stopped.");
+        return;
+    }
+
     if (tcpServer->isListening()) { // make sure that the server is actually on first
         tcpServer->close(); // close the server
         ui->startServerButton->setEnabled(true); // enable the start server button
         ui->stopServerButton->setEnabled(false); // disable the stop server button
 
-        foreach (QTcpSocket *socket, playerSockets) { // for every socket in the list of player sockets
+        if (!handoverPath.isEmpty() && sessions->graceMs() > 0) {
+            handOverRooms(); // before anyone is disconnected, so their tokens go along
+        }
+
+        foreach (QTcpSocket *socket, connections.keys()) { // every connected socket, players and spectators alike
             socket->disconnectFromHost(); // disconnect them
             socket->deleteLater();
         }
         playerSockets.clear(); // clear the list of player sockets
         playerNames.clear(); // clear the list of player names
+        connections.clear(); // connections are children of their sockets
+        sessions->clear();
+        spectatorRelay->clear();
+        qDeleteAll(rooms);
+        rooms.clear();
+        roomOf.clear();
+        lobbyRoom = nullptr;
+        featuredRoom = nullptr;
+        if (matchmaker) {
+            matchmaker->clear();
+        }
+        udpChannel->close();
+        metricsServer->close();
+        lobbyChat.clear();
 
         ui->logOutput->append("Server stopped."); // inform the user through output that the server has stopped
         qDebug() << "Server stopped."; // output same thing to terminal
@@ -233,38 +433,70 @@ void Dialog::on_stopServerButton_clicked() // this function is fired when the se
 }
 
 void Dialog::acceptConnection() // this function allows the server to accept the connections from the players
+{
+    // Whether this is a player or a spectator is only known from its first message,
+    // so everyone is accepted here and given a player slot (if one is free) once they say who they are
+    QTcpSocket *incomingClient = tcpServer->nextPendingConnection(); // when someone is trying to join make an incomingClient socket object
+    watchConnection(incomingClient);
+
+    qDebug() << "Client connected from" << incomingClient->peerAddress();
+}
+
+void Dialog::watchConnection(QTcpSocket *playerSocket)
+{
+    connections.insert(playerSocket, new Connection(playerSocket, playerSocket)); // deleted along with the socket
+
+    connect(playerSocket, &QTcpSocket::disconnected, this, &Dialog::onPlayerDisconnected); // make connect statements to detect the signal of a player disconnecting
+    connect(playerSocket, &QTcpSocket::readyRead, this, &Dialog::onReadyRead); // detect signal of player/client sending packets
+}
+
+void Dialog::onConnectionHandedOver(QTcpSocket *playerSocket, const QByteArray &pending)
+{
+    watchConnection(playerSocket);
+    qDebug() << "Client handed over from another worker," << playerSocket->peerAddress();
+
+    // The lines the other worker had read, its RESUME first. The client sends nothing else
+    // before RESUMED, so a line cut in half by the handoff is not expected and is dropped
+    QList<QByteArray> lines = pending.split('\n');
+    lines.removeLast(); // after the last newline
+    for (const QByteArray &line : lines) {
+        QString data = QString::fromUtf8(line).trimmed();
+        if (!data.isEmpty()) {
+            processMessage(playerSocket, data);
+        }
+    }
+}
+
+int Dialog::assignPlayerSlot(QTcpSocket *playerSocket)
 {
     if (playerSockets.count(nullptr) == 0 && playerSockets.size() >= 4) // if there are already 4 players
     {
-        QTcpSocket *extraPlayer = tcpServer->nextPendingConnection(); // make a socket connection to that extra player
-        extraPlayer->write("Lobby is full. Try again later."); // inform player that the lobby is full
-        extraPlayer->disconnectFromHost(); // disconnect that player from the host
-        qDebug() << "Connection refused: Lobby is full."; // output to qdebug that the connection was refused because the lobby is full
-        return;
+        return -1;
     }
 
-    QTcpSocket *incomingClient = tcpServer->nextPendingConnection(); // when someone is trying to join make an incomingClient socket object
     // look for an empty slot in the playerSockets list (nullptr indicates an unused slot in the playerSockets list)
     int index = playerSockets.indexOf(nullptr);
 
     // if no empty slot is found (which means that the index is -1), add the incoming client to the end of the playerSockets list
     if (index == -1) {
         index = playerSockets.size();  // set index to the next available slot (end of the list)
-        playerSockets.append(incomingClient); // add the incoming client to the list of player sockets
+        playerSockets.append(playerSocket); // add the incoming client to the list of player sockets
     }
     else {
-        playerSockets[index] = incomingClient; // if an empty slot is found, reuse that slot for the new incoming client
+        playerSockets[index] = playerSocket; // if an empty slot is found, reuse that slot for the new incoming client
     }
 
-    connect(incomingClient, &QTcpSocket::disconnected, this, &Dialog::onPlayerDisconnected); // make connect statements to detect the signal of a player disconnecting
-    connect(incomingClient, &QTcpSocket::readyRead, this, &Dialog::onReadyRead); // detect signal of player/client sending packets
-
     qDebug() << "Player connected at index:" << index; // sending to server qDebug that a player connected and at what index
+    return index;
 }
 
 void Dialog::onPlayerDisconnected() // function for when a player disconnects
 {
-    QTcpSocket *playerSocket = qobject_cast<QTcpSocket*>(sender()); // make a player socket variable
+    dropPlayer(qobject_cast<QTcpSocket*>(sender()));
+}
+
+void Dialog::dropPlayer(QTcpSocket *playerSocket)
+{
     QString playerName = playerNames.value(playerSocket, "Unknown"); // pull the player name into this socket
 
     int index = playerSockets.indexOf(playerSocket); // getting the index of that player's socket
@@ -274,6 +506,9 @@ void Dialog::onPlayerDisconnected() // function for when a player disconnects
     }
 
     playerNames.remove(playerSocket); // removing this player from the list of player names
+    spectatorRelay->removeSpectator(connections.value(playerSocket, nullptr));
+    suspendSession(connections.value(playerSocket, nullptr));
+    removeConnection(playerSocket);
     playerSocket->deleteLater(); // queue up the socket to be deleted
 
     ui->logOutput->append(playerName + " disconnected."); // log the output to the server to show that the player disconnected
@@ -284,12 +519,91 @@ void Dialog::onReadyRead()
     QTcpSocket *playerSocket = qobject_cast<QTcpSocket *>(sender());
     if (!playerSocket) return; // If playerSocket is null, exit
 
-    QString data = QString::fromUtf8(playerSocket->readAll()).trimmed(); // Read the raw data from the client
+    Connection *connection = connections.value(playerSocket, nullptr);
+    if (!connection) {
+        return; // kicked or disconnected, the socket is only waiting for deleteLater
+    }
+
+    // Clients end every message with a newline, handle each one on its own
+    while (playerSocket->canReadLine()) {
+        QByteArray line = playerSocket->readLine();
+        QString data = QString::fromUtf8(line).trimmed();
+        if (data.isEmpty()) {
+            continue;
+        }
+
+        // The simulated link is a pass-through unless TRON_SIM_* conditions are set. It belongs to
+        // the Connection, which leaves the map before the socket is deleted, so a delayed line can
+        // still arrive for a player who is gone; processMessage drops it.
+        Metrics::add(Metrics::TcpBytesIn, quint64(line.size()));
+        connection->inbound()->transmit(line.size(), [this, playerSocket, data]() {
+            processMessage(playerSocket, data);
+        });
+    }
+}
 
-    qDebug() << "Received data from client:" << data;
+void Dialog::processMessage(QTcpSocket *playerSocket, const QString &data)
+{
+    Connection *connection = connections.value(playerSocket, nullptr);
+    if (!connection) {
+        return; // removed since the line was read, the socket is on its way out
+    }
+    if (spectatorRelay->isSpectator(connection)) {
+        return; // spectators are read-only
+    }
 
     // Check if the player's name has been set yet
     if (!playerNames.contains(playerSocket)) {
+        if (data.startsWith("RESUME:")) {
+            quint64 token = data.mid(7).trimmed().toULongLong();
+            int owner = SessionTable::workerOf(token);
+            if (handoff && owner >= 0 && owner != workerIndex) {
+                if (!passConnection(playerSocket, owner, (data + "\n").toUtf8())) {
+                    connection->send(SharedMessage::fromBytes("RESUME_FAILED")); // that worker may be back by the client's next try
+                }
+                return;
+            }
+            if (!resumeSession(playerSocket, token)) {
+                connection->send(SharedMessage::fromBytes("RESUME_FAILED")); // the client may still join with a name
+            }
+            return;
+        }
+
+        if (data.startsWith("SPECTATE:")) {
+            QString spectatorName = data.mid(9).trimmed();
+            spectatorRelay->addSpectator(connection);
+            lobbyChat.replayTo(connection);
+            ui->logOutput->append(spectatorName + " is spectating.");
+            qDebug() << spectatorName << "is spectating," << spectatorRelay->spectatorCount() << "spectators";
+            return;
+        }
+
+        if (!isValidPlayerName(data)) {
+            connection->send(SharedMessage::chat("That name cannot be used. Pick one without ':' that is not a command."));
+            playerSocket->disconnectFromHost();
+            qDebug() << "Connection refused: reserved name" << data;
+            return;
+        }
+
+        if (matchmaker) {
+            // No slots with matchmaking; ticking Ready puts the player in the queue
+            QString playerName = data;
+            playerNames[playerSocket] = playerName;
+            ui->logOutput->append(playerName + " connected.");
+            connection->send(SharedMessage::chat("Welcome " + playerName + ", tick Ready to find a match."));
+            lobbyChat.replayTo(connection);
+            issueSession(connection);
+            offerUdpChannel(connection);
+            return;
+        }
+
+        if (assignPlayerSlot(playerSocket) == -1) {
+            playerSocket->write(SharedMessage::chat("Lobby is full. Try again later.").bytes()); // inform player that the lobby is full
+            playerSocket->disconnectFromHost(); // disconnect that player from the host
+            qDebug() << "Connection refused: Lobby is full."; // output to qdebug that the connection was refused because the lobby is full
+            return;
+        }
+
         // Treat the first message as the player's name
         QString playerName = data;
         playerNames[playerSocket] = playerName;
@@ -299,12 +613,16 @@ void Dialog::onReadyRead()
             setPlayerLabel(index, playerName);  // Update the UI with the player's name
         }
 
+        lobbyChat.replayTo(connection); // catch up on the conversation before hearing about themselves
+
         // Broadcast the player's joining message
         QString joinMessage = playerName + " has joined the game.";
-        broadcastMessage(joinMessage.toUtf8());
+        broadcastMessage(SharedMessage::chat(joinMessage));
         ui->logOutput->append(joinMessage);
         qDebug() << joinMessage;
 
+        issueSession(connection);
+        offerUdpChannel(connection);
         return;
     }
 
@@ -312,29 +630,60 @@ void Dialog::onReadyRead()
 
     // Check if the data represents a movement command
     if (data.startsWith("PLAYERMOVE:")) {
-        QString direction = data.mid(11).trimmed(); // Extract the direction after "PLAYERMOVE: "
-        if (!direction.isEmpty()) {
-            // Validate and process the movement
-            if (game) {
-                qDebug() << "Processing movement for" << playerName << "in direction:" << direction;
-                game->processClientInput(playerName, direction);
+        // "W@1234,A@1235": the turns made since the client's last send, oldest first, each with
+        // the tick on the player's screen when they made it; the game applies them on successive ticks
+        const QStringList turns = data.mid(11).trimmed().split(',');
+        Room *room = roomOf.value(connection, nullptr);
+        if (turns.first().isEmpty()) {
+            qWarning() << "Invalid PLAYERMOVE format (direction missing):" << data;
+        } else if (!room) {
+            qWarning() << "Game instance does not exist. Cannot process movement.";
+        }
+        for (QString direction : turns) {
+            if (!room || direction.isEmpty()) {
+                break;
+            }
+            qint64 clientTick = -1;
+            int at = direction.indexOf('@');
+            if (at >= 0) {
+                bool ok = false;
+                clientTick = direction.mid(at + 1).toLongLong(&ok);
+                clientTick = ok ? clientTick : -1;
+                direction.truncate(at);
+            }
+            Metrics::add(Metrics::InputMessages);
+            if (connection->takeInputToken()) {
+                room->processInput(connection, direction.trimmed(), clientTick);
             } else {
-                qWarning() << "Game instance does not exist. Cannot process movement.";
+                Metrics::add(Metrics::InputsDropped);
             }
-        } else {
-            qWarning() << "Invalid PLAYERMOVE format (direction missing):" << data;
         }
     }
 
     // Handle other types of messages (READY, CHAT, etc.)
     else if (data.startsWith("READY:")) {
-        setPlayerReadyStatus(playerSocket, playerName, true);
+        if (matchmaker) {
+            setQueued(connection, playerName, true);
+        } else {
+            setPlayerReadyStatus(playerSocket, playerName, true);
+        }
     } else if (data.startsWith("NOT_READY:")) {
-        setPlayerReadyStatus(playerSocket, playerName, false);
+        if (matchmaker) {
+            setQueued(connection, playerName, false);
+        } else {
+            setPlayerReadyStatus(playerSocket, playerName, false);
+        }
     } else if (data.startsWith("CHAT:")) {
         QString chatMessage = data.mid(5).trimmed();
         QString fullMessage = playerName + ": " + chatMessage;
-        broadcastMessage(fullMessage.toUtf8());
+        Room *room = roomOf.value(connection, nullptr);
+        if (room && room != lobbyRoom) {
+            room->chat(SharedMessage::chat(fullMessage));
+        } else {
+            SharedMessage message = SharedMessage::chat(fullMessage);
+            lobbyChat.append(message);
+            broadcastMessage(message);
+        }
         ui->logOutput->append(fullMessage);
     } else {
         qDebug() << "Received unknown data:" << data;
@@ -343,6 +692,363 @@ void Dialog::onReadyRead()
 
 
 
+void Dialog::issueSession(Connection *connection)
+{
+    if (!connection) {
+        return;
+    }
+
+    quint64 token = sessions->issue(connection);
+    connection->send(SharedMessage::fromText("SESSION:" + QString::number(token)));
+}
+
+void Dialog::offerUdpChannel(Connection *connection)
+{
+    if (!connection || !connection->sessionToken() || !udpChannel->isBound()) {
+        return;
+    }
+    QString offer = "UDP_OFFER:" + QString::number(connection->sessionToken());
+    if (udpChannel->localPort() != gamePort) {
+        offer += ":" + QString::number(udpChannel->localPort()); // a worker's own port
+    }
+    connection->send(SharedMessage::fromText(offer));
+}
+
+void Dialog::suspendSession(Connection *connection)
+{
+    Room *room = roomOf.value(connection, nullptr);
+    if (!room || !room->game() || !connection->sessionToken() || sessions->graceMs() == 0) {
+        return; // not playing, nothing to hold
+    }
+
+    // The snake keeps going in a straight line while we wait for the player to come back
+    holdSession(connection->sessionToken(), room->playerName(connection), room);
+    ui->logOutput->append(room->playerName(connection) + " dropped, holding their place for "
+                          + QString::number(sessions->graceMs() / 1000.0) + " s.");
+}
+
+void Dialog::holdSession(quint64 token, const QString &playerName, Room *room)
+{
+    sessions->hold(token, playerName, room->id());
+    updateListening();
+}
+
+void Dialog::handOverRooms()
+{
+    // Every match still running, with the session token of each of its players, connected or not
+    BitWriter out;
+    out.writeVarint(HANDOVER_VERSION);
+    QList<Room*> running;
+    for (Room *room : rooms) {
+        if (room->game()) {
+            running.append(room);
+        }
+    }
+    out.writeVarint(quint32(running.size()));
+
+    for (Room *room : running) {
+        QHash<quint64, QString> tokens;
+        for (Connection *connection : room->members()) {
+            if (connection->sessionToken()) {
+                tokens.insert(connection->sessionToken(), room->playerName(connection));
+            }
+        }
+        for (auto it = sessions->held().cbegin(); it != sessions->held().cend(); ++it) {
+            if (it->roomId == room->id()) {
+                tokens.insert(it.key(), it->playerName);
+            }
+        }
+
+        out.writeVarint(quint32(tokens.size()));
+        for (auto it = tokens.cbegin(); it != tokens.cend(); ++it) {
+            QByteArray name = it.value().toUtf8();
+            out.writeBits(quint32(it.key()), 32);
+            out.writeBits(quint32(it.key() >> 32), 32);
+            out.writeVarint(quint32(name.size()));
+            out.writeBytes(name);
+        }
+        QByteArray state = room->game()->captureState().encode();
+        out.writeVarint(quint32(state.size()));
+        out.writeBytes(state);
+    }
+
+    // Written aside and renamed, so the next process never reads half a file
+    QSaveFile file(handoverPath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(out.finish()) < 0 || !file.commit()) {
+        ui->logOutput->append("Could not hand over the matches: " + file.errorString());
+        return;
+    }
+    ui->logOutput->append("Handed over " + QString::number(running.size()) + " matches to " + handoverPath);
+}
+
+void Dialog::adoptRooms()
+{
+    QFile file(handoverPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return; // nothing was handed over
+    }
+    BitReader in(file.readAll());
+    file.close();
+    file.remove(); // adopted once, a later restart starts empty
+
+    if (in.readVarint() != HANDOVER_VERSION) {
+        ui->logOutput->append("Ignoring matches handed over by an incompatible build.");
+        return;
+    }
+    quint32 roomCount = in.readVarint();
+    int adopted = 0;
+    for (quint32 i = 0; i < roomCount && in.ok(); ++i) {
+        QHash<quint64, QString> tokens;
+        quint32 tokenCount = in.readVarint();
+        for (quint32 t = 0; t < tokenCount && in.ok(); ++t) {
+            quint64 token = in.readBits(32);
+            token |= quint64(in.readBits(32)) << 32;
+            quint32 nameSize = in.readVarint();
+            tokens.insert(token, QString::fromUtf8(in.readBytes(int(qMin<quint32>(nameSize, MAX_HANDOVER_BYTES)))));
+        }
+        quint32 stateSize = in.readVarint();
+        QByteArray blob = in.readBytes(int(qMin<quint32>(stateSize, MAX_HANDOVER_BYTES)));
+
+        MatchState state;
+        if (!in.ok() || !MatchState::decode(blob, &state)) {
+            break;
+        }
+        Room *room = createRoom();
+        if (!room->restore(state)) {
+            rooms.removeOne(room);
+            room->deleteLater();
+            continue;
+        }
+
+        // The players find their match again by resuming with the token they already have
+        for (auto it = tokens.cbegin(); it != tokens.cend(); ++it) {
+            holdSession(it.key(), it.value(), room);
+        }
+        featureRoom(room);
+        ++adopted;
+    }
+    if (!in.ok()) {
+        ui->logOutput->append("The handover file is damaged, some matches were lost.");
+    }
+    ui->logOutput->append("Carrying on " + QString::number(adopted) + " handed over matches.");
+}
+
+bool Dialog::resumeSession(QTcpSocket *playerSocket, quint64 token)
+{
+    Connection *connection = connections.value(playerSocket, nullptr);
+    if (!connection || !token) {
+        return false;
+    }
+
+    // Their old stream may be half open, the server none the wiser; they are plainly on this one now
+    Connection *previous = sessions->connectionFor(token);
+    Room *previousRoom = roomOf.value(previous, nullptr);
+    if (previous && previous != connection && previousRoom && previousRoom->game()) {
+        QTcpSocket *staleSocket = previous->socket();
+        disconnect(staleSocket, nullptr, this, nullptr);
+        dropPlayer(staleSocket); // holds their place like any other drop
+        staleSocket->abort();
+    }
+
+    SessionTable::Session session;
+    if (!sessions->take(token, &session)) {
+        return false;
+    }
+    updateListening();
+    Room *room = roomById(session.roomId);
+    if (!room || !room->game()) {
+        return false; // the match ended while they were away
+    }
+
+    // Same name, same token, same snake
+    playerNames[playerSocket] = session.playerName;
+    sessions->bind(token, connection);
+    room->addMember(connection, session.playerName);
+    roomOf.insert(connection, room);
+    if (room == lobbyRoom) {
+        int index = assignPlayerSlot(playerSocket);
+        if (index != -1) {
+            setPlayerLabel(index, session.playerName);
+        }
+    }
+
+    // One burst answers the resume: confirmation, then the match as it is now
+    connection->send(SharedMessage::fromText("RESUMED:" + session.playerName));
+    room->resync(connection);
+    offerUdpChannel(connection);
+
+    ui->logOutput->append(session.playerName + " is back.");
+    return true;
+}
+
+bool Dialog::passConnection(QTcpSocket *playerSocket, int worker, const QByteArray &firstLine)
+{
+    // Anything the client sent after the line goes along, the other worker reads on from there
+    QByteArray pending = firstLine + playerSocket->readAll();
+    if (!handoff->send(worker, playerSocket, pending)) {
+        return false;
+    }
+
+    disconnect(playerSocket, nullptr, this, nullptr);
+    removeConnection(playerSocket);
+    playerSocket->abort(); // closes our descriptor only, the connection lives on in the other worker
+    playerSocket->deleteLater();
+    qDebug() << "Passed a resuming player to worker" << worker;
+    return true;
+}
+
+void Dialog::removeConnection(QTcpSocket *playerSocket)
+{
+    Connection *connection = connections.take(playerSocket);
+    if (connection) {
+        sessions->unbind(connection);
+        if (matchmaker) {
+            matchmaker->remove(connection);
+        }
+        Room *room = roomOf.take(connection);
+        if (room) {
+            room->removeMember(connection);
+        }
+    }
+}
+
+void Dialog::onDatagramReceived(const QByteArray &bytes, const QHostAddress &sender, quint16 senderPort)
+{
+    Datagram datagram = Datagram::parse(bytes);
+    Connection *connection = sessions->connectionFor(datagram.token);
+    if (datagram.type == Datagram::Invalid || !connection) {
+        return; // stray or stale packet
+    }
+
+    // The token was only ever sent over this player's TCP stream, so it must come from the same host
+    if (!sender.isEqual(connection->socket()->peerAddress(), QHostAddress::ConvertV4MappedToIPv4)) {
+        qWarning() << "UDP packet for" << playerNames.value(connection->socket()) << "from unexpected host" << sender;
+        return;
+    }
+
+    if (datagram.type == Datagram::Hello) {
+        if (!connection->hasUdpEndpoint()) {
+            ui->logOutput->append(playerNames.value(connection->socket()) + " switched movement to UDP.");
+        }
+        connection->setUdpEndpoint(sender, senderPort);
+
+        Datagram ack;
+        ack.type = Datagram::HelloAck;
+        ack.token = datagram.token;
+        udpChannel->sendTo(ack.encode(), sender, senderPort);
+        return;
+    }
+
+    if (datagram.type == Datagram::Input && connection->hasUdpEndpoint()) {
+        QString playerName = playerNames.value(connection->socket());
+        // Every packet repeats the last few turns; apply the new ones in the order they were made
+        for (const Datagram::InputEntry &entry : datagram.inputs) {
+            if (entry.sequence <= connection->lastInputSequence()) {
+                continue;
+            }
+            connection->setLastInputSequence(entry.sequence);
+            Metrics::add(Metrics::InputMessages);
+            if (!connection->takeInputToken()) {
+                Metrics::add(Metrics::InputsDropped);
+                continue;
+            }
+            Room *room = roomOf.value(connection, nullptr);
+            if (room) {
+                room->processInput(connection, QString(QChar(entry.key)), entry.tick);
+            }
+        }
+    }
+}
+
+Room *Dialog::createRoom()
+{
+    Room *room = new Room(nextRoomId++, udpChannel, gamePool, this);
+    room->setArenaSize(arenaSize);
+    room->setRules(rules);
+    rooms.append(room);
+
+    connect(room, &Room::finished, this, &Dialog::onRoomFinished);
+    connect(room, &Room::snapshotPublished, this, [this, room](const SharedMessage &message) {
+        if (room == featuredRoom) {
+            spectatorRelay->publishSnapshot(message);
+        }
+    });
+    connect(room, &Room::keyframePublished, this, [this, room](const QByteArray &payload) {
+        if (room == featuredRoom) {
+            spectatorRelay->publishKeyframe(payload); // keep the latest keyframe for spectators joining late
+        }
+    });
+    return room;
+}
+
+Room *Dialog::roomById(int id) const
+{
+    for (Room *room : rooms) {
+        if (room->id() == id) {
+            return room;
+        }
+    }
+    return nullptr;
+}
+
+void Dialog::featureRoom(Room *room)
+{
+    if (featuredRoom) {
+        return; // spectators stay with the match they are watching
+    }
+    featuredRoom = room;
+    spectatorRelay->startMatch(SharedMessage::fromBytes("GAME_START"));
+}
+
+void Dialog::setQueued(Connection *connection, const QString &playerName, bool queued)
+{
+    if (!connection || roomOf.contains(connection)) {
+        return; // already playing
+    }
+
+    if (queued) {
+        matchmaker->enqueue(connection, playerName, ratings.value(playerName, Matchmaker::DEFAULT_RATING));
+        connection->send(SharedMessage::chat("Searching for a match..."));
+        ui->logOutput->append(playerName + " is looking for a match, " + QString::number(matchmaker->queuedCount()) + " queued.");
+    } else if (matchmaker->remove(connection)) {
+        ui->logOutput->append(playerName + " left the queue.");
+    }
+}
+
+void Dialog::onRoomFormed(const QVector<Matchmaker::Ticket> &tickets)
+{
+    Room *room = createRoom();
+    for (const Matchmaker::Ticket &ticket : tickets) {
+        room->addMember(ticket.connection, ticket.playerName);
+        roomOf.insert(ticket.connection, room);
+    }
+    room->start(0, false); // matchmade rooms run without a window
+    featureRoom(room);
+
+    ui->logOutput->append(QString("Room %1 started: %2 (average wait %3 ms)")
+                              .arg(room->id())
+                              .arg(room->playerNames().join(", "))
+                              .arg(matchmaker->averageWaitMs()));
+}
+
+void Dialog::updateRatings(Room *room)
+{
+    if (!room->game()) {
+        return;
+    }
+
+    // Linear in the placing: the winner gains RATING_STEP, last place loses it
+    QStringList order = room->game()->finishingOrder();
+    QStringList humans = room->playerNames();
+    int last = order.size() - 1;
+    for (int place = 0; place <= last && last > 0; ++place) {
+        if (humans.contains(order[place])) {
+            int change = RATING_STEP * (last - 2 * place) / last;
+            ratings[order[place]] = ratings.value(order[place], Matchmaker::DEFAULT_RATING) + change;
+        }
+    }
+}
+
 void Dialog::setPlayerLabel(int index, const QString &playerName) // this function is simply to set the labels for each associated player
 {
     switch (index) {
@@ -429,6 +1135,10 @@ void Dialog::checkAllPlayersReady() // function to check whether all players are
 
 void Dialog::startMatch()
 {
+    if (lobbyRoom) {
+        return; // the lobby's match is still running
+    }
+
     // Check if there are at least 2 players
     int activePlayers = 0;
     for (QTcpSocket *socket : playerSockets) {
@@ -437,7 +1147,10 @@ void Dialog::startMatch()
         }
     }
 
-    if (activePlayers < 2) {
+    // Bots fill the room for load and balance testing, TRON_BOTS sets how many
+    int botCount = qMax(0, qEnvironmentVariableIntValue("TRON_BOTS"));
+
+    if (activePlayers + botCount < 2) {
         ui->logOutput->append("Not enough players to start the game. At least 2 players are required.");
         qDebug() << "Not enough players to start the game. At least 2 players are required.";
         return;
@@ -450,44 +1163,47 @@ void Dialog::startMatch()
         }
     }
 
-    QByteArray gameStartMessage = "GAME_START";
-    broadcastMessage(gameStartMessage);
-
-    // Dynamically create the game instance and assign it to `game`
-    game = new Game(this);
-    game->setModal(false); // Make it non-modal
-    game->show();
-
-    // Add all players to the game
-    for (const QString &playerName : playerNames.values()) {
-        game->addPlayer(playerName);
+    // The lobby's match is a room like any other, with its window shown
+    lobbyRoom = createRoom();
+    for (QTcpSocket *socket : playerSockets) {
+        Connection *connection = connections.value(socket, nullptr);
+        if (connection && playerNames.contains(socket)) {
+            lobbyRoom->addMember(connection, playerNames.value(socket));
+            roomOf.insert(connection, lobbyRoom);
+        }
+    }
+    lobbyRoom->start(botCount, true);
+    featureRoom(lobbyRoom);
+    if (botCount > 0) {
+        ui->logOutput->append(QString::number(botCount) + " bots joined the match.");
     }
-
-    connect(game, &Game::gameEnded, this, &Dialog::onGameEnded);
 
     ui->logOutput->append("Game started!");
     qDebug() << "Game started! Cleared pending packets and broadcasted start of game.";
 }
 
 
-void Dialog::onGameEnded()
+void Dialog::onRoomFinished(Room *room)
 {
-    QByteArray gameEndMessage = "GAME_END";
-    broadcastMessage(gameEndMessage);
-    qDebug() << gameEndMessage;
-
-    ui->logOutput->append("Game ended!");
-    //qDebug() << "Game ended! Kicking all players and broadcasting game end message.";
-    //kickPlayer(0);
-    //kickPlayer(1);
-    //kickPlayer(2);
-    //kickPlayer(3);
+    updateRatings(room);
 
+    if (room == featuredRoom) {
+        spectatorRelay->endMatch(SharedMessage::fromBytes("GAME_END"));
+        featuredRoom = nullptr;
+    }
 
-    game->accept(); // End the game window
-    //this->~Dialog();
+    for (Connection *connection : room->members()) {
+        roomOf.remove(connection);
+    }
+    rooms.removeOne(room);
 
-    qDebug() << "All players have been disconnected.";
+    if (room == lobbyRoom) {
+        lobbyRoom = nullptr;
+        ui->logOutput->append("Game ended!");
+    } else {
+        ui->logOutput->append("Room " + QString::number(room->id()) + " finished.");
+    }
+    room->deleteLater(); // the game is still inside its gameEnded signal
 }
 
 
@@ -525,13 +1241,14 @@ void Dialog::kickPlayer(int index) // This function kicks a player without promp
     QTcpSocket *playerSocket = playerSockets.at(index); // Get the player's socket
     QString playerName = playerNames.value(playerSocket, "Unknown"); // Get the player's name
 
-    playerSocket->write("You have been kicked");  // Inform the player they have been kicked
+    playerSocket->write(SharedMessage::chat("You have been kicked").bytes());  // Inform the player they have been kicked
     playerSocket->flush();
 
     QTimer::singleShot(100, this, [this, playerSocket, playerName, index]() { // Set a timer for safe disconnection
         playerSocket->disconnectFromHost(); // Disconnect the player from the server
         playerSockets[index] = nullptr; // Clear the player's socket in the list
         playerNames.remove(playerSocket); // Remove their name from the list
+        removeConnection(playerSocket);
         playerSocket->deleteLater(); // Queue the socket for deletion
 
         clearPlayerLabel(index); // Clear the player's label in the UI
@@ -560,3 +1277,80 @@ void Dialog::on_player4KickButton_clicked()
 {
     kickPlayer(3); // Kick the player at index 3
 }
+
+QByteArray Dialog::renderMetrics() const
+{
+    MetricsText out;
+
+    int players = playerNames.size();
+    int spectators = spectatorRelay->spectatorCount();
+    out.family("tron_connections", "gauge", "Open TCP connections by role.");
+    out.sample("tron_connections", players, "role=\"player\"");
+    out.sample("tron_connections", spectators, "role=\"spectator\"");
+    out.sample("tron_connections", connections.size() - players - spectators, "role=\"unnamed\"");
+
+    out.family("tron_queued_players", "gauge", "Players waiting in the matchmaking queue.");
+    out.sample("tron_queued_players", matchmaker ? matchmaker->queuedCount() : 0);
+    out.family("tron_suspended_sessions", "gauge", "Dropped players whose snake is held for them.");
+    out.sample("tron_suspended_sessions", sessions->held().size());
+    out.family("tron_rooms", "gauge", "Matches in progress.");
+    out.sample("tron_rooms", rooms.size());
+    out.family("tron_pooled_games", "gauge", "Idle games ready for the next match.");
+    out.sample("tron_pooled_games", gamePool->idleCount());
+
+    if (matchmaker) {
+        out.family("tron_matchmaking_wait_seconds", "summary", "Time from queueing to being placed in a room.");
+        out.sample("tron_matchmaking_wait_seconds_sum", matchmaker->summedWaitMs() / 1000.0);
+        out.sample("tron_matchmaking_wait_seconds_count", matchmaker->matchedPlayers());
+    }
+
+    out.family("tron_room_tick_seconds", "histogram", "Time spent simulating and encoding one tick.");
+    for (Room *room : rooms) {
+        if (room->game()) {
+            out.histogram("tron_room_tick_seconds", room->game()->tickDurations(), "room=\"" + QByteArray::number(room->id()) + "\"");
+        }
+    }
+
+    out.family("tron_input_messages_total", "counter", "Turns received from players over TCP or UDP.");
+    out.sample("tron_input_messages_total", Metrics::total(Metrics::InputMessages));
+    out.family("tron_inputs_dropped_total", "counter", "Turns discarded by the per connection rate limit.");
+    out.sample("tron_inputs_dropped_total", Metrics::total(Metrics::InputsDropped));
+    out.family("tron_turns_rewound_total", "counter", "Late turns applied at the tick the player made them.");
+    out.sample("tron_turns_rewound_total", Metrics::total(Metrics::TurnsRewound));
+    out.family("tron_snapshot_messages_total", "counter", "Snapshots sent, one per recipient.");
+    out.sample("tron_snapshot_messages_total", Metrics::total(Metrics::SnapshotMessages));
+    out.family("tron_snapshots_skipped_total", "counter", "Snapshots not queued for clients that fell behind.");
+    out.sample("tron_snapshots_skipped_total", Metrics::total(Metrics::SnapshotsSkipped));
+
+    out.family("tron_bytes_total", "counter", "Bytes moved by the server.");
+    out.sample("tron_bytes_total", Metrics::total(Metrics::TcpBytesIn), "transport=\"tcp\",direction=\"in\"");
+    out.sample("tron_bytes_total", Metrics::total(Metrics::TcpBytesOut), "transport=\"tcp\",direction=\"out\"");
+    out.sample("tron_bytes_total", Metrics::total(Metrics::UdpBytesIn), "transport=\"udp\",direction=\"in\"");
+    out.sample("tron_bytes_total", Metrics::total(Metrics::UdpBytesOut), "transport=\"udp\",direction=\"out\"");
+
+    // Queues that grow are clients that cannot keep up
+    qint64 queuedBytes = 0;
+    int queuedMessages = 0;
+    int deepestQueue = 0;
+    for (Connection *connection : connections) {
+        queuedBytes += connection->queuedBytes();
+        queuedMessages += connection->queuedMessages();
+        deepestQueue = qMax(deepestQueue, connection->queuedMessages());
+    }
+    out.family("tron_outbound_queue_messages", "gauge", "Messages waiting for slow sockets.");
+    out.sample("tron_outbound_queue_messages", queuedMessages, "stat=\"total\"");
+    out.sample("tron_outbound_queue_messages", deepestQueue, "stat=\"max\"");
+    out.family("tron_outbound_queue_bytes", "gauge", "Bytes waiting for slow sockets.");
+    out.sample("tron_outbound_queue_bytes", queuedBytes);
+
+    out.family("tron_db_write_seconds", "summary", "Time the game loop spent waiting on result writes.");
+    out.sample("tron_db_write_seconds_sum", Metrics::total(Metrics::DbWriteNanoseconds) / 1e9);
+    out.sample("tron_db_write_seconds_count", Metrics::total(Metrics::DbWrites));
+
+    out.family("tron_allocations_total", "counter", "Heap allocations by the server process.");
+    out.sample("tron_allocations_total", Metrics::total(Metrics::Allocations));
+    out.family("tron_deallocations_total", "counter", "Heap frees by the server process.");
+    out.sample("tron_deallocations_total", Metrics::total(Metrics::Deallocations));
+
+    return out.text();
+}
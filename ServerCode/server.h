@@ -9,7 +9,22 @@
 #include <QMap>
 #include <QNetworkInterface>
 #include <QTimer>
+#include <QHash>
+#include <QPointer>
+#include <QElapsedTimer>
 #include "game.h"
+#include "connection.h"
+#include "sharedMessage.h"
+#include "spectatorRelay.h"
+#include "room.h"
+#include "gamePool.h"
+#include "matchmaker.h"
+#include "metricsServer.h"
+#include "supervisor.h"
+#include "workerLink.h"
+#include "sessionTable.h"
+#include "socketHandoff.h"
+#include "../Common/udpChannel.h"
 
 namespace Ui {
 class Dialog;
@@ -23,6 +38,8 @@ public:
     explicit Dialog(QWidget *parent = nullptr);
     ~Dialog();
 
+    void startWorker(); // run headless as one of a supervisor's workers, configured by the environment
+
 
 private slots:
     void on_startServerButton_clicked(); // function fired when server's start button clicked
@@ -35,24 +52,73 @@ private slots:
     void on_player3KickButton_clicked();
     void on_player4KickButton_clicked();
     void kickPlayer(int index); // function allowing server to kick players
-    void onGameEnded();
+    void onRoomFinished(Room *room); // GAME_END has gone out, update ratings and free the room
+    void onRoomFormed(const QVector<Matchmaker::Ticket> &tickets); // start a match for players the matchmaker grouped
+    void onDatagramReceived(const QByteArray &datagram, const QHostAddress &sender, quint16 senderPort); // UDP hello and input packets
+    void onConnectionHandedOver(QTcpSocket *playerSocket, const QByteArray &pending); // another worker sent us one of our players
 
 private:
     Ui::Dialog *ui;
     QTcpServer *tcpServer; // tcp socket variable
     QList<QTcpSocket*> playerSockets; // list of player sockets
 
-    Game *game = nullptr;
     QMap<QTcpSocket*, QString> playerNames; // map of player names and their sockets
+    QHash<QTcpSocket*, Connection*> connections; // outbound queue and other per-socket state
+    SessionTable *sessions; // tokens of connected players, and the places of dropped ones
+    UdpChannel *udpChannel; // optional real-time channel, bound to the same port number as the TCP server
+    SpectatorRelay *spectatorRelay; // read-only connections, not limited to four
+    ChatHistory lobbyChat;          // replayed to everyone who joins the lobby
+
+    QList<Room*> rooms; // matches in progress
+    QHash<Connection*, Room*> roomOf; // room each playing connection is in
+    Room *lobbyRoom = nullptr; // the match started from the four lobby slots
+    Room *featuredRoom = nullptr; // the match spectators are watching
+    int nextRoomId = 1;
+    Matchmaker *matchmaker = nullptr; // only with TRON_ROOM_SIZE set, replaces the lobby slots
+    GamePool *gamePool;               // reset games waiting for a room
+    QHash<QString, int> ratings; // by player name, adjusted after every match
+
+    QSize arenaSize; // of every room's arena, TRON_ARENA_WIDTH and TRON_ARENA_HEIGHT
+    Simulation::Rules rules = Simulation::ContinuousRules; // of every room's match, TRON_GRID_RULES=1 for the grid
+    QString handoverPath; // TRON_HANDOVER_FILE, where running matches go between a stop and the next start
+
+    MetricsServer *metricsServer; // localhost text endpoint, TRON_METRICS_PORT or the game port + 1
+    quint16 gamePort = 0;          // the TCP port players connect to
+    Supervisor *supervisor = nullptr; // with TRON_WORKERS, the workers run the game and this window watches them
+    WorkerLink *workerLink = nullptr; // set in a worker, its line to the supervisor
+    SocketHandoff *handoff = nullptr; // set in a worker, passes resuming players to the worker holding their place
+    int workerIndex = -1;             // -1 unless this process is a worker
+    bool acceptingNew = true;         // as the supervisor last asked
 
+    bool startServer(quint16 port); // listen for players, open UDP and metrics; false if the port is taken
     void setPlayerLabel(int index, const QString &playerName); // function used for setting each label with their associated player name
     void clearPlayerLabel(int index); // function allowing server to clear a player's label when they leave the game
     void setPlayerReadyStatus(QTcpSocket *playerSocket, const QString &playerName, bool isReady); // function allowing server to set the ready status of the player
     void startMatch(); // function that allows the player to start the match
     void checkAllPlayersReady(); // function to check and see if all of the players are ready
-    void broadcastMessage(const QByteArray &message); // function to broadcast messages to the players including the game countdown
+    void broadcastMessage(const SharedMessage &message); // function to broadcast messages to the players including the game countdown
     bool getReadyStatus(int index) const; // function to check the ready status of each player
     void broadcastPlayerStates();  // New function for broadcasting initial player states
+    void processMessage(QTcpSocket *playerSocket, const QString &data); // handle one line received from a player
+    void issueSession(Connection *connection); // give a named player the token they can resume or open UDP with
+    void offerUdpChannel(Connection *connection); // invite the player to open the UDP channel with their session token
+    void suspendSession(Connection *connection); // hold a dropped player's place in their match
+    void holdSession(quint64 token, const QString &playerName, Room *room); // for the resume grace period
+    void handOverRooms(); // write every running match and its players' tokens to the handover file
+    void adoptRooms();    // carry on the matches in the handover file, if there is one
+    bool resumeSession(QTcpSocket *playerSocket, quint64 token); // false if there is nothing to resume
+    void dropPlayer(QTcpSocket *playerSocket); // the socket is gone, hold their place if they were playing
+    void removeConnection(QTcpSocket *playerSocket); // forget all per-socket state
+    void watchConnection(QTcpSocket *playerSocket); // start reading from a new connection
+    bool passConnection(QTcpSocket *playerSocket, int worker, const QByteArray &firstLine); // hand the socket to another worker, false if it cannot take it
+    void updateListening(); // a worker listens while taking new players or holding places for dropped ones
+    int assignPlayerSlot(QTcpSocket *playerSocket); // index of the slot taken, -1 if the lobby is full
+    Room *createRoom(); // a new, empty room wired to the server
+    Room *roomById(int id) const; // nullptr once the room is gone
+    void featureRoom(Room *room); // let spectators watch it, unless they are already watching another
+    void setQueued(Connection *connection, const QString &playerName, bool queued); // READY/NOT_READY with matchmaking
+    void updateRatings(Room *room); // from the room's finishing order
+    QByteArray renderMetrics() const; // everything the metrics endpoint reports, as of now
 };
 
 #endif // SERVER_H
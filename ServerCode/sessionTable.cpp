@@ -0,0 +1,81 @@
+// sessionTable.cpp
+#include "sessionTable.h"
+#include <QRandomGenerator>
+#include <QTimer>
+
+constexpr int WORKER_SHIFT = 56; // the top byte holds the worker index plus one, 0 for a lone server
+constexpr quint64 RANDOM_MASK = (quint64(1) << WORKER_SHIFT) - 1;
+
+SessionTable::SessionTable(QObject *parent)
+    : QObject(parent)
+{
+    if (qEnvironmentVariableIsSet("TRON_RESUME_GRACE")) {
+        setGraceMs(qEnvironmentVariableIntValue("TRON_RESUME_GRACE"));
+    }
+    uptime.start();
+}
+
+quint64 SessionTable::issue(Connection *connection)
+{
+    quint64 token = 0;
+    while (!token || live.contains(token) || suspended.contains(token)) { // 0 means no session
+        token = QRandomGenerator::global()->generate64() & RANDOM_MASK;
+        token |= quint64(worker + 1) << WORKER_SHIFT;
+    }
+    bind(token, connection);
+    return token;
+}
+
+int SessionTable::workerOf(quint64 token)
+{
+    return int(token >> WORKER_SHIFT) - 1;
+}
+
+void SessionTable::bind(quint64 token, Connection *connection)
+{
+    connection->setSessionToken(token);
+    live.insert(token, connection);
+}
+
+void SessionTable::unbind(Connection *connection)
+{
+    auto it = live.find(connection->sessionToken());
+    if (it != live.end() && it.value() == connection) {
+        live.erase(it);
+    }
+}
+
+void SessionTable::hold(quint64 token, const QString &playerName, int roomId)
+{
+    Session session;
+    session.playerName = playerName;
+    session.roomId = roomId;
+    session.deadlineMs = uptime.elapsed() + grace;
+    suspended.insert(token, session);
+
+    QTimer::singleShot(grace, this, [this, token]() {
+        auto it = suspended.find(token);
+        if (it != suspended.end() && it->deadlineMs <= uptime.elapsed()) {
+            QString playerName = it->playerName;
+            suspended.erase(it);
+            emit expired(playerName);
+        }
+    });
+}
+
+bool SessionTable::take(quint64 token, Session *session)
+{
+    auto it = suspended.find(token);
+    if (it == suspended.end()) {
+        return false;
+    }
+    *session = it.value();
+    suspended.erase(it);
+    return true;
+}
+
+void SessionTable::clear()
+{
+    live.clear();
+    suspended.clear();
+}
@@ -0,0 +1,60 @@
+// sessionTable.h
+
+#ifndef SESSIONTABLE_H
+#define SESSIONTABLE_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QElapsedTimer>
+#include "connection.h"
+
+// Session tokens and the players behind them. Every named player gets a token,
+// which opens their UDP channel and, if they drop mid-match, takes their place
+// back: the table holds a dropped player's name and room for the grace period
+// (TRON_RESUME_GRACE, in ms) and forgets it after that. Under a supervisor the
+// top byte of every token names the worker that issued it, so a resume reaching
+// another worker can be sent on to the one holding the place.
+class SessionTable : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_GRACE_MS = 10000; // how long a dropped player's snake waits for them
+
+    struct Session {
+        QString playerName;
+        int roomId = 0;
+        qint64 deadlineMs = 0; // table uptime after which the session is forgotten
+    };
+
+    explicit SessionTable(QObject *parent = nullptr);
+
+    int graceMs() const { return grace; }
+    void setWorker(int index) { worker = index; } // stamped into tokens issued from now on, -1 for none
+    static int workerOf(quint64 token); // worker that issued the token, -1 outside a supervisor
+    void setGraceMs(int ms) { grace = qMax(0, ms); } // for sessions held from now on
+
+    quint64 issue(Connection *connection); // a new token, bound to the connection
+    void bind(quint64 token, Connection *connection); // the token now belongs to this connection
+    void unbind(Connection *connection); // unless the token has moved on to another connection
+    Connection *connectionFor(quint64 token) const { return live.value(token, nullptr); }
+
+    void hold(quint64 token, const QString &playerName, int roomId); // a later hold of the same token restarts the clock
+    bool take(quint64 token, Session *session); // false if nothing is held for the token
+    bool isHeld(quint64 token) const { return suspended.contains(token); }
+    const QHash<quint64, Session> &held() const { return suspended; }
+    void clear();
+
+signals:
+    void expired(const QString &playerName); // did not come back in time
+
+private:
+    QHash<quint64, Connection*> live;     // connected players, also the lookup for incoming UDP packets
+    QHash<quint64, Session> suspended;    // dropped players still within the grace period
+    QElapsedTimer uptime;
+    int grace = DEFAULT_GRACE_MS;
+    int worker = -1;
+};
+
+#endif // SESSIONTABLE_H
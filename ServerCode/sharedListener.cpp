@@ -0,0 +1,48 @@
+// sharedListener.cpp
+#include "sharedListener.h"
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+bool listenShared(QTcpServer *server, quint16 port)
+{
+#ifdef Q_OS_LINUX
+    // IPv4 on every interface, which is what the clients connect over
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        qWarning() << "Cannot create a listening socket:" << strerror(errno);
+        return false;
+    }
+
+    int one = 1;
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0
+        || ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0
+        || ::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+        || ::listen(fd, SOMAXCONN) != 0) {
+        qWarning() << "Cannot listen on shared port" << port << ":" << strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    // QTcpServer takes over the listening socket and accepts from it as usual
+    if (!server->setSocketDescriptor(fd)) {
+        qWarning() << "QTcpServer rejected the shared socket:" << server->errorString();
+        ::close(fd);
+        return false;
+    }
+    return true;
+#else
+    return server->listen(QHostAddress::Any, port);
+#endif
+}
@@ -0,0 +1,14 @@
+// sharedListener.h
+
+#ifndef SHAREDLISTENER_H
+#define SHAREDLISTENER_H
+
+#include <QTcpServer>
+
+// Listen on a port that other processes may listen on too. On Linux the socket
+// is opened with SO_REUSEPORT and the kernel spreads new connections over every
+// process listening on the port; closing the server takes this process out of
+// the rotation without disturbing the others. Elsewhere it is a plain listen().
+bool listenShared(QTcpServer *server, quint16 port);
+
+#endif // SHAREDLISTENER_H
@@ -0,0 +1,25 @@
+// sharedMessage.cpp
+#include "sharedMessage.h"
+
+SharedMessage SharedMessage::fromText(const QString &text)
+{
+    return fromBytes(text.toUtf8());
+}
+
+SharedMessage SharedMessage::chat(const QString &text)
+{
+    return fromText("CHAT:" + text);
+}
+
+SharedMessage SharedMessage::fromBytes(const QByteArray &bytes)
+{
+    if (bytes.endsWith('\n')) {
+        return SharedMessage(bytes); // already framed, share it as is
+    }
+
+    QByteArray framed;
+    framed.reserve(bytes.size() + 1);
+    framed.append(bytes);
+    framed.append('\n'); // every message on the wire is one line
+    return SharedMessage(framed);
+}
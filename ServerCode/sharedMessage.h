@@ -0,0 +1,32 @@
+// sharedMessage.h
+
+#ifndef SHAREDMESSAGE_H
+#define SHAREDMESSAGE_H
+
+#include <QByteArray>
+#include <QString>
+
+// An immutable, newline framed message that is encoded exactly once.
+// Copies only bump the reference count of the underlying QByteArray, so the
+// same message can sit in any number of outbound queues without being copied.
+class SharedMessage
+{
+public:
+    SharedMessage() = default;
+
+    static SharedMessage fromText(const QString &text); // encode text as UTF-8 and frame it
+    static SharedMessage fromBytes(const QByteArray &bytes); // frame already encoded bytes
+    static SharedMessage chat(const QString &text); // a line for people to read, marked CHAT: so it never passes for a control message
+
+    const QByteArray &bytes() const { return payload; }
+    qint64 size() const { return payload.size(); }
+    bool isEmpty() const { return payload.isEmpty(); }
+    bool isSnapshot() const { return payload.startsWith("SNAPSHOT:"); } // superseded by the next one, safe to skip
+
+private:
+    explicit SharedMessage(const QByteArray &framed) : payload(framed) {}
+
+    QByteArray payload; // framed bytes, never modified after construction
+};
+
+#endif // SHAREDMESSAGE_H
@@ -0,0 +1,642 @@
+// simulation.cpp
+#include "simulation.h"
+#include "movements.h"
+#include "player.h"
+#include "../Common/metrics.h"
+#include <QDebug>
+#include <cmath>
+
+constexpr int PLAYER_WIDTH = 20;
+constexpr int PLAYER_HEIGHT = 20;
+constexpr qreal PLAYER_SPEED = 1.5;
+constexpr int MAX_PENDING_TURNS = 3; // a quick double turn still lands, anything past that only updates the last
+constexpr int BOT_CELL_SIZE = 10;             // bots see the arena in trail sized cells
+constexpr quint32 BOT_THINK_INTERVAL_TICKS = 4; // each bot decides every 40 ms, bots are spread over the ticks
+constexpr int PLAYERS_PER_ROW = 4;            // start positions, extra players start on further rows
+constexpr int TRAIL_SIZE = 10;
+constexpr quint32 TRAIL_DECAY_INTERVAL_TICKS = TrailGrid::DECAY_INTERVAL_MS / Simulation::TICK_MS;
+constexpr qreal PROBE_GAP = 6;     // the probe starts this far ahead of a player's center, clear of its own newest trail
+constexpr qreal PROBE_DEPTH = 5;
+constexpr qreal BORDER_REACH = 2;  // the border reaches this far into the arena
+constexpr int GRID_CELL_SIZE = Player::STEP_SIZE; // grid rules: a step, and the trail left in the cell stepped out of
+constexpr quint32 GRID_STEP_TICKS = 3;            // grid rules: ticks per step, close to the continuous speed
+
+enum Heading { Up, Down, Left, Right }; // same order as PlayerState::heading
+
+static QPointF velocityOf(Player::Direction direction, qreal speed)
+{
+    return QPointF(Player::step(QPoint(0, 0), direction, 1)) * speed;
+}
+
+// The way a velocity points, false when the player is not moving
+static bool directionOf(const QPointF &velocity, Player::Direction *direction)
+{
+    if (velocity.y() < 0) {
+        *direction = Player::Up;
+    } else if (velocity.y() > 0) {
+        *direction = Player::Down;
+    } else if (velocity.x() < 0) {
+        *direction = Player::Left;
+    } else if (velocity.x() > 0) {
+        *direction = Player::Right;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+Simulation::Simulation()
+    : trails(DEFAULT_ARENA_WIDTH, DEFAULT_ARENA_HEIGHT),
+      trailLog(TRAIL_SIZE, TRAIL_DECAY_INTERVAL_TICKS),
+      occupancy(DEFAULT_ARENA_WIDTH, DEFAULT_ARENA_HEIGHT, BOT_CELL_SIZE)
+{
+}
+
+void Simulation::setArenaSize(const QSize &size)
+{
+    // Even sides keep the arena's edges on whole units around (0, 0)
+    int width = qBound(int(DEFAULT_ARENA_WIDTH), size.width(), int(MAX_ARENA_SIDE)) & ~1;
+    int height = qBound(int(DEFAULT_ARENA_HEIGHT), size.height(), int(MAX_ARENA_SIDE)) & ~1;
+    if (width == sceneWidth && height == sceneHeight) {
+        return;
+    }
+
+    sceneWidth = width;
+    sceneHeight = height;
+    trails = TrailGrid(width, height); // only the chunk table, chunks come with the first trails
+    occupancy = OccupancyGrid(width, height, BOT_CELL_SIZE);
+}
+
+void Simulation::setRules(Rules rules)
+{
+    // On the grid a segment fills exactly the cell it is left in, one every step
+    currentRules = rules;
+    trailLog = rules == GridRules ? TrailLog(GRID_CELL_SIZE, TRAIL_DECAY_INTERVAL_TICKS, GRID_STEP_TICKS)
+                                  : TrailLog(TRAIL_SIZE, TRAIL_DECAY_INTERVAL_TICKS);
+}
+
+void Simulation::reset()
+{
+    positions.clear();
+    playerVelocities.clear();
+    cells.clear();
+    playerIds.clear();
+    frozenPlayers.clear();
+    pendingTurns.clear();
+    history.clear();
+    historyStart.clear();
+    lastTurnTick.clear();
+    crashes.clear();
+    bots.clear();
+
+    trails.clear();
+    trailLog.clear();
+    occupancy.clear();
+    changedAreas.clear();
+
+    tickCount = 0;
+    activeCount = 0;
+    lastActive.clear();
+    over = false;
+}
+
+void Simulation::addPlayer(const QString &playerName)
+{
+    if (positions.contains(playerName)) {
+        qWarning() << "Player" << playerName << "already exists.";
+        return;
+    }
+
+    // Position players in a line at the start, wrapping onto more lines when there are bots
+    int column = positions.size() % PLAYERS_PER_ROW;
+    int row = positions.size() / PLAYERS_PER_ROW;
+    QPointF initialPosition(column * 120 - DEFAULT_ARENA_HEIGHT / 4 - 20, -250 + row * 50);
+
+    if (currentRules == GridRules) {
+        QPoint cell = cellAt(initialPosition);
+        cells[playerName] = cell;
+        initialPosition = cellCenter(cell);
+    }
+
+    playerIds[playerName] = positions.size();
+    positions[playerName] = initialPosition;
+    playerVelocities[playerName] = QPointF(0, 0);
+
+    qDebug() << "Added player:" << playerName << "at position" << initialPosition;
+}
+
+void Simulation::addBot(const QString &botName)
+{
+    if (positions.contains(botName)) {
+        qWarning() << "Player" << botName << "already exists.";
+        return;
+    }
+
+    addPlayer(botName);
+    bots.insert(botName, Bot());
+}
+
+void Simulation::thinkBots()
+{
+    // Each tick only the bots whose turn it is think, so their cost is spread evenly
+    QStringList thinking;
+    int index = 0;
+    for (auto it = bots.cbegin(); it != bots.cend(); ++it, ++index) {
+        if ((tickCount + index) % BOT_THINK_INTERVAL_TICKS == 0 && !frozenPlayers.contains(it.key())) {
+            thinking.append(it.key());
+        }
+    }
+    if (thinking.isEmpty()) {
+        return;
+    }
+
+    // One shared bitmap per tick, sampled from the trail grid, plus the border; on arenas
+    // too big for one bitmap each bot gets the window around itself instead
+    bool shared = occupancy.coversArena();
+    if (shared) {
+        occupancy.clear();
+        occupancy.markTrails(trails);
+    }
+
+    for (const QString &botName : thinking) {
+        if (!shared) {
+            occupancy.centerOn(positions[botName]);
+            occupancy.clear();
+            occupancy.markTrails(trails);
+        }
+
+        QVector<QPoint> opponents;
+        for (auto it = positions.cbegin(); it != positions.cend(); ++it) {
+            if (it.key() != botName && !frozenPlayers.contains(it.key()) && occupancy.inView(it.value())) {
+                opponents.append(occupancy.cellAt(it.value()));
+            }
+        }
+
+        QPointF velocity = playerVelocities.value(botName);
+        QChar heading;
+        if (velocity.y() < 0) {
+            heading = 'W';
+        } else if (velocity.y() > 0) {
+            heading = 'S';
+        } else if (velocity.x() < 0) {
+            heading = 'A';
+        } else if (velocity.x() > 0) {
+            heading = 'D';
+        }
+
+        QChar key = bots[botName].chooseMove(occupancy, positions[botName], heading, opponents);
+        if (!key.isNull()) {
+            processInput(botName, QString(key)); // same path as a remote player's PLAYERMOVE
+        }
+    }
+}
+
+void Simulation::processInput(const QString &playerName, const QString &keyInput, qint64 clientTick)
+{
+    if (!positions.contains(playerName)) {
+        qWarning() << "Unknown player:" << playerName;
+        return;
+    }
+    if (frozenPlayers.contains(playerName)) {
+        return;
+    }
+
+    Player::Direction direction;
+    if (!Movements::directionForKey(keyInput, &direction)) {
+        qWarning() << "Unknown key input from player" << playerName << ":" << keyInput;
+        return;
+    }
+    // On the grid the velocity is a whole step, taken every GRID_STEP_TICKS
+    QPointF velocity = velocityOf(direction, currentRules == GridRules ? GRID_CELL_SIZE : PLAYER_SPEED);
+
+    // Turns wait for the next tick; repeats of the direction already taken are dropped,
+    // so held keys and spam cost a comparison instead of a turn
+    QVector<PendingTurn> &turns = pendingTurns[playerName];
+    QPointF heading = turns.isEmpty() ? playerVelocities.value(playerName) : turns.last().velocity;
+    if (velocity == heading) {
+        return;
+    }
+    if (turns.size() < MAX_PENDING_TURNS) {
+        turns.append({velocity, clientTick});
+    } else {
+        turns.last() = {velocity, clientTick};
+    }
+}
+
+void Simulation::applyPendingTurns()
+{
+    for (auto it = pendingTurns.begin(); it != pendingTurns.end();) {
+        if (it.value().isEmpty()) {
+            it = pendingTurns.erase(it);
+            continue;
+        }
+        PendingTurn turn = it.value().takeFirst();
+
+        // A turn made on an older tick goes back to it, but never past the history we keep
+        // or the player's previous turn, so turns still land in the order they were made
+        qint64 earliest = qMax<qint64>(qint64(tickCount) - MAX_REWIND_TICKS, 0);
+        auto previous = lastTurnTick.constFind(it.key());
+        if (previous != lastTurnTick.constEnd()) {
+            earliest = qMax<qint64>(earliest, qint64(*previous) + 1);
+        }
+        auto start = historyStart.constFind(it.key());
+        if (start != historyStart.constEnd()) {
+            earliest = qMax<qint64>(earliest, qint64(*start)); // slots before it were never written
+        }
+        qint64 turnTick = qMax(turn.clientTick, earliest);
+        if (turn.clientTick >= 0 && turnTick < qint64(tickCount) && history.contains(it.key())) {
+            rewindTurn(it.key(), turn.velocity, quint32(turnTick));
+        } else {
+            playerVelocities[it.key()] = turn.velocity;
+            lastTurnTick[it.key()] = tickCount;
+        }
+        ++it;
+    }
+}
+
+void Simulation::rewindTurn(const QString &playerName, const QPointF &velocity, quint32 turnTick)
+{
+    quint8 owner = quint8(playerIds.value(playerName));
+    QVector<PastState> &past = history[playerName];
+    lastTurnTick[playerName] = turnTick;
+    Metrics::add(Metrics::TurnsRewound);
+
+    // Take back the trail laid since the turn; the log rebuilds what was under it, other players' trails included
+    QRect changed = trails.toGrid(trailLog.rewind(owner, turnTick));
+    if (!changed.isEmpty()) {
+        trailLog.replay(&trails, tickCount, changed);
+    }
+
+    // Only this player is simulated again. It runs into the trails as they are now, which can
+    // be a few ticks newer than the ones it actually passed; other players never move back.
+    QPointF position = past[turnTick % MAX_REWIND_TICKS].position;
+    for (quint32 tick = turnTick; tick < tickCount; ++tick) {
+        past[tick % MAX_REWIND_TICKS] = {position, velocity};
+        trailLog.record(tick, position, owner);
+        changed |= trails.stamp(trailLog.segmentAt(position), owner, trailLog.decaysBetween(tick, tickCount));
+
+        position = clampToArena(position + velocity);
+        if (collisionAt(position, velocity) != NoCollision) {
+            qDebug() << "Player" << playerName << "crashed after a late turn at tick" << turnTick;
+            positions[playerName] = position;
+            markChanged(changed);
+            freezePlayer(playerName);
+            return;
+        }
+    }
+
+    positions[playerName] = position;
+    playerVelocities[playerName] = velocity;
+    markChanged(changed);
+}
+
+void Simulation::advance()
+{
+    activeCount = 0; // players not frozen when their turn to move comes
+    lastActive.clear();
+
+    if (!bots.isEmpty() && !over) {
+        thinkBots();
+    }
+    if (currentRules == GridRules) {
+        stepGrid();
+    } else {
+        applyPendingTurns();
+
+        for (auto it = positions.begin(); it != positions.end(); ++it) {
+            const QString &playerName = it.key();
+
+            // Skip processing for frozen players
+            if (frozenPlayers.contains(playerName)) {
+                continue;
+            }
+
+            lastActive = playerName;
+            ++activeCount;
+
+            QPointF velocity = playerVelocities[playerName];
+
+            // Remember where the player starts this tick, a late turn may have to come back here
+            QVector<PastState> &past = history[playerName];
+            if (past.isEmpty()) {
+                past.resize(MAX_REWIND_TICKS);
+                historyStart[playerName] = tickCount;
+            }
+            past[tickCount % MAX_REWIND_TICKS] = {it.value(), velocity};
+
+            // Leave a trail behind the player
+            if (!velocity.isNull()) {
+                leaveTrail(it.value(), quint8(playerIds.value(playerName))); // the owner picks the trail's color
+            }
+
+            // Update the player's position, clamped to stay within scene bounds
+            it.value() = clampToArena(it.value() + velocity);
+
+            // Look just ahead of the player in the trail grid
+            if (!velocity.isNull()) {
+                Collision collision = collisionAt(it.value(), velocity);
+                if (collision == BorderCollision) {
+                    qDebug() << "Player" << playerName << "collided with the border!";
+                    freezePlayer(playerName);
+                } else if (collision == TrailCollision) {
+                    qDebug() << "Player" << playerName << "collided with a trail!";
+                    freezePlayer(playerName);
+                }
+            }
+        }
+    }
+
+    ++tickCount;
+    if (tickCount % TRAIL_DECAY_INTERVAL_TICKS == 0) {
+        decayTrails();
+    }
+    over = over || activeCount <= 1;
+}
+
+void Simulation::stepGrid()
+{
+    // Between steps players hold their cell, but they are still in the match
+    bool stepping = tickCount % GRID_STEP_TICKS == 0;
+    if (!stepping) {
+        for (auto it = cells.cbegin(); it != cells.cend(); ++it) {
+            if (!frozenPlayers.contains(it.key())) {
+                lastActive = it.key();
+                ++activeCount;
+            }
+        }
+        return;
+    }
+
+    // One buffered turn per player per step; straight back is not a turn and is dropped.
+    // There is no rewind on the grid, a turn lands on the next step.
+    for (auto it = pendingTurns.begin(); it != pendingTurns.end();) {
+        if (it.value().isEmpty()) {
+            it = pendingTurns.erase(it);
+            continue;
+        }
+        PendingTurn turn = it.value().takeFirst();
+        Player::Direction from;
+        Player::Direction to;
+        directionOf(turn.velocity, &to);
+        if (!directionOf(playerVelocities.value(it.key()), &from) || Player::canTurn(from, to)) {
+            playerVelocities[it.key()] = turn.velocity;
+        }
+        ++it;
+    }
+
+    // Every cell being left turns into trail before anyone moves, so who moves first never matters
+    QStringList moving;
+    for (auto it = cells.cbegin(); it != cells.cend(); ++it) {
+        if (frozenPlayers.contains(it.key())) {
+            continue;
+        }
+        lastActive = it.key();
+        ++activeCount;
+        if (!playerVelocities.value(it.key()).isNull()) {
+            leaveTrail(positions[it.key()], quint8(playerIds.value(it.key())));
+            moving.append(it.key());
+        }
+    }
+
+    // The cell entered has to be inside the arena and free of trail, one bitmap lookup at its center
+    const int columns = sceneWidth / GRID_CELL_SIZE;
+    const int rows = sceneHeight / GRID_CELL_SIZE;
+    for (const QString &playerName : moving) {
+        Player::Direction direction;
+        directionOf(playerVelocities.value(playerName), &direction);
+        QPoint next = Player::step(cells[playerName], direction, 1);
+        if (next.x() < 0 || next.y() < 0 || next.x() >= columns || next.y() >= rows) {
+            qDebug() << "Player" << playerName << "collided with the border!";
+            freezePlayer(playerName); // stays in the last cell inside
+            continue;
+        }
+        cells[playerName] = next;
+        positions[playerName] = cellCenter(next);
+        if (trails.isOccupiedAt(next.x() * GRID_CELL_SIZE + GRID_CELL_SIZE / 2, next.y() * GRID_CELL_SIZE + GRID_CELL_SIZE / 2)) {
+            qDebug() << "Player" << playerName << "collided with a trail!";
+            freezePlayer(playerName);
+        }
+    }
+
+    QMap<int, QStringList> occupants; // players in each cell after the step, by row * columns + column, in a fixed order
+    for (auto it = cells.cbegin(); it != cells.cend(); ++it) {
+        if (!frozenPlayers.contains(it.key()) || moving.contains(it.key())) {
+            occupants[it.value().y() * columns + it.value().x()].append(it.key());
+        }
+    }
+
+    // Players ending the step in the same cell all crash, whoever moved first
+    for (auto it = occupants.cbegin(); it != occupants.cend(); ++it) {
+        if (it.value().size() < 2) {
+            continue;
+        }
+        for (const QString &playerName : it.value()) {
+            if (!frozenPlayers.contains(playerName)) {
+                qDebug() << "Player" << playerName << "collided with another player!";
+                freezePlayer(playerName);
+            }
+        }
+    }
+}
+
+QPoint Simulation::cellAt(const QPointF &position) const
+{
+    return QPoint(int(std::floor((position.x() + sceneWidth / 2) / GRID_CELL_SIZE)),
+                  int(std::floor((position.y() + sceneHeight / 2) / GRID_CELL_SIZE)));
+}
+
+QPointF Simulation::cellCenter(const QPoint &cell) const
+{
+    // On the half unit grid, like every other position, so snapshots and handover carry it exactly
+    return QPointF(-sceneWidth / 2 + cell.x() * GRID_CELL_SIZE + GRID_CELL_SIZE / 2.0,
+                   -sceneHeight / 2 + cell.y() * GRID_CELL_SIZE + GRID_CELL_SIZE / 2.0);
+}
+
+QVector<QRect> Simulation::takeChangedAreas()
+{
+    QVector<QRect> areas;
+    areas.swap(changedAreas);
+    return areas;
+}
+
+void Simulation::markChanged(const QRect &area)
+{
+    if (trackChanges && !area.isEmpty()) {
+        changedAreas.append(area);
+    }
+}
+
+Snapshot Simulation::buildSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.tick = tickCount;
+
+    for (auto it = positions.cbegin(); it != positions.cend(); ++it) {
+        const QString &playerName = it.key();
+        QPointF velocity = playerVelocities.value(playerName);
+
+        PlayerState state;
+        state.id = quint8(playerIds.value(playerName));
+        state.x = float(it.value().x());
+        state.y = float(it.value().y());
+        state.moving = !velocity.isNull();
+        state.alive = !frozenPlayers.contains(playerName);
+
+        if (velocity.y() < 0) {
+            state.heading = Up;
+        } else if (velocity.y() > 0) {
+            state.heading = Down;
+        } else if (velocity.x() < 0) {
+            state.heading = Left;
+        } else {
+            state.heading = Right;
+        }
+
+        snapshot.players.append(state);
+    }
+    return snapshot;
+}
+
+Keyframe Simulation::buildKeyframe() const
+{
+    Keyframe keyframe;
+    keyframe.snapshot = buildSnapshot();
+    keyframe.trailLog = trailLog;
+    keyframe.trails = trails; // shares the arrays until the next stamp or decay
+    keyframe.msUntilDecay = quint16((TRAIL_DECAY_INTERVAL_TICKS - tickCount % TRAIL_DECAY_INTERVAL_TICKS) * TICK_MS);
+    return keyframe;
+}
+
+MatchState Simulation::captureState() const
+{
+    MatchState state;
+    state.arenaWidth = sceneWidth;
+    state.arenaHeight = sceneHeight;
+    state.tick = tickCount;
+    state.lossCounter = crashes.size() + 1;
+    state.gridRules = currentRules == GridRules;
+    state.trailLog = trailLog;
+
+    state.players.resize(positions.size());
+    for (auto it = positions.cbegin(); it != positions.cend(); ++it) {
+        MatchState::Player &player = state.players[playerIds.value(it.key())];
+        player.name = it.key();
+        player.id = quint8(playerIds.value(it.key()));
+        player.bot = bots.contains(it.key());
+        player.frozen = frozenPlayers.contains(it.key());
+        player.position = it.value();
+        player.velocity = playerVelocities.value(it.key());
+        player.lossOrder = crashes.indexOf(it.key()) + 1;
+        for (const PendingTurn &turn : pendingTurns.value(it.key())) {
+            player.pendingTurns.append(turn.velocity); // on the grid a bot's choice can wait a few ticks for its step
+        }
+    }
+    return state;
+}
+
+bool Simulation::restoreState(const MatchState &state)
+{
+    if (!positions.isEmpty() || state.arenaWidth <= 0 || state.arenaHeight <= 0) {
+        return false;
+    }
+    setArenaSize(QSize(state.arenaWidth, state.arenaHeight));
+    if (arenaSize() != QSize(state.arenaWidth, state.arenaHeight)) {
+        return false; // the other build clamps differently, positions would be off
+    }
+    setRules(state.gridRules ? GridRules : ContinuousRules);
+
+    // Added in id order, so every player gets its id back
+    QMap<int, QString> crashed;
+    for (int id = 0; id < state.players.size(); ++id) {
+        const MatchState::Player &player = state.players[id];
+        if (player.id != id || positions.contains(player.name)) {
+            reset();
+            return false;
+        }
+        if (player.bot) {
+            addBot(player.name);
+        } else {
+            addPlayer(player.name);
+        }
+        if (currentRules == GridRules) {
+            cells[player.name] = cellAt(player.position);
+            positions[player.name] = cellCenter(cells[player.name]);
+        } else {
+            positions[player.name] = clampToArena(player.position);
+        }
+        playerVelocities[player.name] = player.frozen ? QPointF(0, 0) : player.velocity;
+        historyStart[player.name] = state.tick; // no history came along, nothing before now can be rewound to
+        if (player.frozen) {
+            frozenPlayers.insert(player.name);
+        }
+        for (const QPointF &turn : player.pendingTurns.mid(0, MAX_PENDING_TURNS)) {
+            pendingTurns[player.name].append({turn, -1}); // lands on the next tick or step, as it would have
+        }
+        if (player.lossOrder > 0) {
+            crashed.insert(player.lossOrder, player.name);
+        }
+    }
+    crashes = crashed.values(); // by loss order
+
+    // The grid is rebuilt from the runs, every segment aged by the decays since it was laid
+    tickCount = state.tick;
+    trailLog = state.trailLog;
+    trailLog.replay(&trails, tickCount);
+    markChanged(QRect(0, 0, trails.width(), trails.height()));
+    return true;
+}
+
+void Simulation::leaveTrail(const QPointF &position, quint8 owner)
+{
+    // The segment is centered on the player and shrinks by itself as the grid ages
+    trailLog.record(tickCount, position, owner);
+    markChanged(trails.stamp(trailLog.segmentAt(position), owner));
+}
+
+void Simulation::decayTrails()
+{
+    QVector<QRect> expired;
+    trails.decay(&expired);
+    trailLog.prune(tickCount);
+    for (const QRect &span : expired) {
+        markChanged(span);
+    }
+}
+
+QRectF Simulation::frontProbe(const QPointF &position, const QPointF &velocity) const
+{
+    // A strip as wide as the player, a little way ahead of it
+    if (velocity.y() < 0) { // Moving up
+        return QRectF(position.x() - PLAYER_WIDTH / 2, position.y() - PROBE_GAP - PROBE_DEPTH, PLAYER_WIDTH, PROBE_DEPTH);
+    } else if (velocity.y() > 0) { // Moving down
+        return QRectF(position.x() - PLAYER_WIDTH / 2, position.y() + PROBE_GAP, PLAYER_WIDTH, PROBE_DEPTH);
+    } else if (velocity.x() < 0) { // Moving left
+        return QRectF(position.x() - PROBE_GAP - PROBE_DEPTH, position.y() - PLAYER_HEIGHT / 2, PROBE_DEPTH, PLAYER_HEIGHT);
+    }
+    return QRectF(position.x() + PROBE_GAP, position.y() - PLAYER_HEIGHT / 2, PROBE_DEPTH, PLAYER_HEIGHT); // Moving right
+}
+
+QPointF Simulation::clampToArena(const QPointF &position) const
+{
+    return QPointF(qBound(-sceneWidth / 2 + static_cast<qreal>(PLAYER_WIDTH) / 2, position.x(), sceneWidth / 2 - static_cast<qreal>(PLAYER_WIDTH) / 2),
+                   qBound(-sceneHeight / 2 + static_cast<qreal>(PLAYER_HEIGHT) / 2, position.y(), sceneHeight / 2 - static_cast<qreal>(PLAYER_HEIGHT) / 2));
+}
+
+Simulation::Collision Simulation::collisionAt(const QPointF &position, const QPointF &velocity) const
+{
+    QRectF probe = frontProbe(position, velocity);
+    QRectF interior(-sceneWidth / 2 + BORDER_REACH, -sceneHeight / 2 + BORDER_REACH,
+                    sceneWidth - 2 * BORDER_REACH, sceneHeight - 2 * BORDER_REACH);
+    if (!interior.contains(probe)) {
+        return BorderCollision;
+    }
+    return trails.isOccupied(probe) ? TrailCollision : NoCollision;
+}
+
+void Simulation::freezePlayer(const QString &playerName)
+{
+    frozenPlayers.insert(playerName); // Freeze the player
+    playerVelocities[playerName] = QPointF(0, 0); // Stop the player's movement
+    pendingTurns.remove(playerName);
+    crashes.append(playerName);
+}
@@ -0,0 +1,129 @@
+// simulation.h
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <QHash>
+#include <QMap>
+#include <QPoint>
+#include <QPointF>
+#include <QRect>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "../Common/snapshot.h"
+#include "../Common/keyframe.h"
+#include "../Common/trailGrid.h"
+#include "../Common/trailLog.h"
+#include "bot.h"
+#include "occupancyGrid.h"
+#include "matchState.h"
+
+// The rules of one match and nothing else: players, turns, trails, bots and
+// collisions, moved on one tick at a time by advance(). No window, timer or
+// database, and no Qt object, so any thread can own one. Game runs a simulation
+// from its timer and shows it; the batch runner steps thousands of them at once.
+class Simulation
+{
+public:
+    static constexpr int DEFAULT_ARENA_WIDTH = 800;  // also the smallest arena, the start positions need it
+    static constexpr int DEFAULT_ARENA_HEIGHT = 600;
+    static constexpr int MAX_ARENA_SIDE = 20000;
+    static constexpr int MAX_REWIND_TICKS = 20; // how far back a late turn may still land, 200 ms
+    static constexpr int TICK_MS = 10;
+
+    enum Rules {
+        ContinuousRules, // players glide half units a tick, a probe ahead of them finds crashes
+        GridRules        // players step a whole cell every few ticks, a crash is one lookup of the cell entered
+    };
+
+    Simulation();
+
+    void setRules(Rules rules); // before any player is added, kept across reset()
+    Rules rules() const { return currentRules; }
+
+    void setArenaSize(const QSize &size); // before any player is added; clamped, and kept across reset()
+    QSize arenaSize() const { return QSize(sceneWidth, sceneHeight); }
+    void addPlayer(const QString &playerName);
+    void addBot(const QString &botName); // a player whose moves are chosen by the simulation
+    void reset(); // back to an empty arena at tick 0
+
+    // A turn, applied at the start of the next tick. With the tick the player was looking at
+    // when they turned, it is applied there instead, up to MAX_REWIND_TICKS back.
+    void processInput(const QString &playerName, const QString &keyInput, qint64 clientTick = -1);
+    void advance(); // one tick: bots think, turns land, everyone moves, crashes, trails age
+
+    quint32 currentTick() const { return tickCount; } // ticks run so far
+    int playerCount() const { return positions.size(); }
+    int playerId(const QString &playerName) const { return playerIds.value(playerName, -1); }
+    bool isBot(const QString &playerName) const { return bots.contains(playerName); }
+    int playersLeft() const { return activeCount; } // still moving at the start of the last tick
+    QString lastPlayerLeft() const { return lastActive; } // the winner once playersLeft() is 1
+    bool isOver() const { return over; } // one player or none was left on the last tick
+    const QStringList &crashOrder() const { return crashes; } // first to crash first
+
+    const TrailGrid &trailGrid() const { return trails; }
+    void setTrackChanges(bool track) { trackChanges = track; } // off unless something draws the trails
+    QVector<QRect> takeChangedAreas(); // grid cells whose trails changed since the last call
+
+    Snapshot buildSnapshot() const; // current positions of every player
+    Keyframe buildKeyframe() const; // players plus the trail grid, for clients joining late
+    MatchState captureState() const; // the match between two ticks, for carrying it on elsewhere
+    bool restoreState(const MatchState &state); // on a reset simulation; false if the state does not fit
+
+private:
+    struct PendingTurn {
+        QPointF velocity;
+        qint64 clientTick; // -1 when it applies now
+    };
+    struct PastState { // a player at the start of a tick, before it moved
+        QPointF position;
+        QPointF velocity;
+    };
+    enum Collision { NoCollision, BorderCollision, TrailCollision };
+
+    void thinkBots(); // let the bots whose turn it is pick a move
+    void leaveTrail(const QPointF &position, quint8 owner);
+    void decayTrails(); // age the whole trail grid by one step
+    QRectF frontProbe(const QPointF &position, const QPointF &velocity) const; // area just ahead of a moving player
+    QPointF clampToArena(const QPointF &position) const; // where a player's center may be
+    Collision collisionAt(const QPointF &position, const QPointF &velocity) const;
+    void freezePlayer(const QString &playerName);
+    void applyPendingTurns(); // one buffered turn per player per tick
+    // Put the player back where it was at turnTick, turn it there and move it forward to now on its own
+    void rewindTurn(const QString &playerName, const QPointF &velocity, quint32 turnTick);
+    void markChanged(const QRect &area);
+    void stepGrid(); // grid rules: on the ticks players step, turn them, move them a cell and find the crashes
+    QPoint cellAt(const QPointF &position) const; // grid rules: column and row from the arena's top left
+    QPointF cellCenter(const QPoint &cell) const;
+
+    Rules currentRules = ContinuousRules;
+    int sceneWidth = DEFAULT_ARENA_WIDTH;
+    int sceneHeight = DEFAULT_ARENA_HEIGHT;
+    QMap<QString, QPointF> positions; // by name, which is also the order players move in
+    QMap<QString, QPointF> playerVelocities;
+    QMap<QString, QPoint> cells; // grid rules: every player's cell, its position is the cell's center
+    QMap<QString, int> playerIds; // join order, sent in snapshots instead of the name
+    QSet<QString> frozenPlayers;
+    QMap<QString, QVector<PendingTurn>> pendingTurns; // turns received since the last tick, oldest first
+    QHash<QString, QVector<PastState>> history; // the last MAX_REWIND_TICKS ticks of every player, indexed by tick modulo that
+    QHash<QString, quint32> historyStart; // first tick each player's history holds, a turn never rewinds past it
+    QHash<QString, quint32> lastTurnTick; // a late turn never lands before the one applied before it
+    QStringList crashes;
+    TrailGrid trails; // every trail, read by collision, drawing and bots
+    TrailLog trailLog; // the same trails as straight runs, for keyframes and handover
+
+    QMap<QString, Bot> bots;
+    OccupancyGrid occupancy; // sampled from the trail grid on ticks where bots think
+
+    quint32 tickCount = 0;
+    int activeCount = 0;
+    QString lastActive;
+    bool over = false;
+    bool trackChanges = false;
+    QVector<QRect> changedAreas;
+};
+
+#endif // SIMULATION_H
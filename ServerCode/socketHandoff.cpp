@@ -0,0 +1,171 @@
+// socketHandoff.cpp
+#include "socketHandoff.h"
+#include <QSocketNotifier>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+// In the abstract namespace, so nothing is left on disk when a worker crashes
+static socklen_t endpointAddress(const QString &group, int index, sockaddr_un *address)
+{
+    QByteArray name = (group + "-worker-" + QString::number(index)).toUtf8();
+    int length = qMin(name.size(), int(sizeof(address->sun_path)) - 1);
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    memcpy(address->sun_path + 1, name.constData(), size_t(length)); // sun_path[0] stays 0
+    return socklen_t(offsetof(sockaddr_un, sun_path) + 1 + length);
+}
+#endif
+
+SocketHandoff::SocketHandoff(const QString &group, int index, QObject *parent)
+    : QObject(parent),
+      group(group),
+      index(index)
+{
+}
+
+SocketHandoff::~SocketHandoff()
+{
+#ifdef Q_OS_LINUX
+    delete notifier;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+#endif
+}
+
+bool SocketHandoff::listen()
+{
+#ifdef Q_OS_LINUX
+    // Datagrams keep one socket and the lines that came with it together
+    fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        qWarning() << "Cannot create the handoff socket:" << strerror(errno);
+        return false;
+    }
+    sockaddr_un address;
+    socklen_t length = endpointAddress(group, index, &address);
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&address), length) != 0) {
+        qWarning() << "Cannot open the handoff endpoint of worker" << index << ":" << strerror(errno);
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, SIGNAL(activated(int)), this, SLOT(onReadable())); // activated is overloaded from Qt 5.15 on, with a private tag
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SocketHandoff::send(int worker, QTcpSocket *socket, const QByteArray &pending)
+{
+#ifdef Q_OS_LINUX
+    int descriptor = int(socket->socketDescriptor());
+    if (fd < 0 || descriptor < 0 || pending.size() > MAX_PENDING_BYTES) {
+        return false;
+    }
+
+    sockaddr_un address;
+    socklen_t length = endpointAddress(group, worker, &address);
+    iovec data;
+    data.iov_base = const_cast<char *>(pending.constData());
+    data.iov_len = size_t(pending.size());
+    union {
+        cmsghdr header;
+        char space[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_name = &address;
+    message.msg_namelen = length;
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control.space;
+    message.msg_controllen = sizeof(control.space);
+    cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &descriptor, sizeof(int));
+
+    // The kernel holds the descriptor in flight, so our end may close as soon as this returns
+    if (::sendmsg(fd, &message, MSG_NOSIGNAL) < 0) {
+        qWarning() << "Worker" << index << "cannot hand a connection to worker" << worker << ":" << strerror(errno);
+        return false;
+    }
+    return true;
+#else
+    Q_UNUSED(worker)
+    Q_UNUSED(socket)
+    Q_UNUSED(pending)
+    return false;
+#endif
+}
+
+void SocketHandoff::onReadable()
+{
+#ifdef Q_OS_LINUX
+    for (;;) {
+        QByteArray pending(MAX_PENDING_BYTES, Qt::Uninitialized);
+        iovec data;
+        data.iov_base = pending.data();
+        data.iov_len = size_t(pending.size());
+        union {
+            cmsghdr header;
+            char space[CMSG_SPACE(sizeof(int))];
+        } control;
+
+        msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        message.msg_control = control.space;
+        message.msg_controllen = sizeof(control.space);
+        ssize_t size = ::recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                qWarning() << "Handoff endpoint of worker" << index << "failed:" << strerror(errno);
+            }
+            return;
+        }
+
+        int descriptor = -1;
+        for (cmsghdr *header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+            if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+                memcpy(&descriptor, CMSG_DATA(header), sizeof(int));
+            }
+        }
+        if (descriptor < 0) {
+            continue; // nothing came with it
+        }
+        if (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+            ::close(descriptor); // not from one of our workers
+            continue;
+        }
+
+        QTcpSocket *socket = new QTcpSocket(this);
+        if (!socket->setSocketDescriptor(descriptor)) {
+            qWarning() << "Worker" << index << "cannot take over a handed connection:" << socket->errorString();
+            ::close(descriptor);
+            delete socket;
+            continue;
+        }
+        pending.truncate(int(size));
+        emit received(socket, pending);
+    }
+#endif
+}
@@ -0,0 +1,45 @@
+// socketHandoff.h
+
+#ifndef SOCKETHANDOFF_H
+#define SOCKETHANDOFF_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QTcpSocket>
+
+class QSocketNotifier;
+
+// Passes connected TCP sockets between the workers of one supervisor. Each worker
+// opens an endpoint named after the supervisor and its own index; a worker holding
+// a connection that belongs to another sends the socket itself along with what it
+// already read from it, and the other worker carries on the stream as if it had
+// accepted it. Linux only, the descriptor travels over a Unix socket; elsewhere
+// listen() and send() fail and every worker keeps what it accepts.
+class SocketHandoff : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_PENDING_BYTES = 16384; // read ahead of a handoff, far more than a client sends before RESUMED
+
+    SocketHandoff(const QString &group, int index, QObject *parent = nullptr);
+    ~SocketHandoff();
+
+    bool listen(); // false if the endpoint cannot be opened
+    bool send(int worker, QTcpSocket *socket, const QByteArray &pending); // false if the worker cannot take it; closing our end is up to the caller
+
+signals:
+    void received(QTcpSocket *socket, const QByteArray &pending); // connected, a child of the handoff
+
+private slots:
+    void onReadable();
+
+private:
+    QString group; // the supervisor's control socket name
+    int index;
+    int fd = -1;
+    QSocketNotifier *notifier = nullptr;
+};
+
+#endif // SOCKETHANDOFF_H
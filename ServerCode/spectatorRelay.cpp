@@ -0,0 +1,81 @@
+// spectatorRelay.cpp
+#include "spectatorRelay.h"
+#include "../Common/metrics.h"
+
+SpectatorRelay::SpectatorRelay(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void SpectatorRelay::addSpectator(Connection *connection)
+{
+    if (!connection || spectators.contains(connection)) {
+        return;
+    }
+    spectators.insert(connection);
+
+    if (!matchRunning) {
+        return; // they will get GAME_START like everyone else
+    }
+
+    // Late joiner: start, the last keyframe, then everything since it, all shared
+    connection->send(gameStartMessage);
+    connection->send(keyframe);
+    for (const SharedMessage &message : sinceKeyframe) {
+        connection->send(message);
+    }
+}
+
+void SpectatorRelay::removeSpectator(Connection *connection)
+{
+    spectators.remove(connection);
+}
+
+void SpectatorRelay::clear()
+{
+    spectators.clear();
+    matchRunning = false;
+    keyframe = SharedMessage();
+    sinceKeyframe.clear();
+}
+
+void SpectatorRelay::broadcast(const SharedMessage &message)
+{
+    for (Connection *connection : spectators) {
+        connection->send(message);
+    }
+}
+
+void SpectatorRelay::startMatch(const SharedMessage &gameStart)
+{
+    matchRunning = true;
+    gameStartMessage = gameStart;
+    keyframe = SharedMessage();
+    sinceKeyframe.clear();
+    broadcast(gameStart);
+}
+
+void SpectatorRelay::publishKeyframe(const QByteArray &payload)
+{
+    // Spectators already watching can keep going from snapshots, only late joiners need it
+    keyframe = SharedMessage::fromBytes("KEYFRAME:" + payload.toBase64());
+    sinceKeyframe.clear();
+}
+
+void SpectatorRelay::publishSnapshot(const SharedMessage &message)
+{
+    if (!matchRunning) {
+        return;
+    }
+    sinceKeyframe.append(message);
+    broadcast(message);
+    Metrics::add(Metrics::SnapshotMessages, quint64(spectators.size()));
+}
+
+void SpectatorRelay::endMatch(const SharedMessage &gameEnd)
+{
+    matchRunning = false;
+    keyframe = SharedMessage();
+    sinceKeyframe.clear();
+    broadcast(gameEnd);
+}
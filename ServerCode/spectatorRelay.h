@@ -0,0 +1,44 @@
+// spectatorRelay.h
+
+#ifndef SPECTATORRELAY_H
+#define SPECTATORRELAY_H
+
+#include <QObject>
+#include <QSet>
+#include <QVector>
+#include "connection.h"
+#include "sharedMessage.h"
+
+// Read-only viewers of the room. Everything they receive is a SharedMessage
+// that was encoded once for the players, so each extra spectator only costs a
+// queue entry. The latest keyframe and the snapshots since it are kept, and a
+// spectator who joins mid-match is caught up from those without the room
+// encoding anything new.
+class SpectatorRelay : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SpectatorRelay(QObject *parent = nullptr);
+
+    void addSpectator(Connection *connection); // syncs them straight away if a match is running
+    void removeSpectator(Connection *connection);
+    bool isSpectator(Connection *connection) const { return spectators.contains(connection); }
+    int spectatorCount() const { return spectators.size(); }
+    void clear();
+
+    void broadcast(const SharedMessage &message); // lobby messages, not retained
+    void startMatch(const SharedMessage &gameStart);
+    void publishKeyframe(const QByteArray &payload); // becomes the sync point for late joiners
+    void publishSnapshot(const SharedMessage &message); // sent now and retained until the next keyframe
+    void endMatch(const SharedMessage &gameEnd);
+
+private:
+    QSet<Connection*> spectators; // looked up on every message and disconnect, order does not matter
+    bool matchRunning = false;
+    SharedMessage gameStartMessage;
+    SharedMessage keyframe;              // latest keyframe, already framed
+    QVector<SharedMessage> sinceKeyframe; // snapshots after it, shared with the live stream
+};
+
+#endif // SPECTATORRELAY_H
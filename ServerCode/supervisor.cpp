@@ -0,0 +1,223 @@
+// supervisor.cpp
+#include "supervisor.h"
+#include <QCoreApplication>
+#include <QProcessEnvironment>
+#include <QDebug>
+#include <climits>
+
+constexpr int PLACEMENT_SLACK = 4;           // players a worker may have over the least loaded one and still take more
+constexpr int INITIAL_RESTART_DELAY_MS = 500;
+constexpr int MAX_RESTART_DELAY_MS = 30000;
+constexpr int STABLE_RUN_MS = 10000;         // a worker that lived this long crashed for a new reason, restart quickly
+constexpr int STOP_TIMEOUT_MS = 3000;        // after STOP, then after terminate(), before kill()
+
+Supervisor::Supervisor(QObject *parent)
+    : QObject(parent),
+      control(new QLocalServer(this))
+{
+    connect(control, &QLocalServer::newConnection, this, &Supervisor::onWorkerConnected);
+}
+
+Supervisor::~Supervisor()
+{
+    stop();
+}
+
+bool Supervisor::start(quint16 serverPort, int workerCount)
+{
+    stop();
+
+    // One control socket per supervisor, a stale one from a crashed run is cleared first
+    QString name = "tron-supervisor-" + QString::number(QCoreApplication::applicationPid());
+    QLocalServer::removeServer(name);
+    if (!control->listen(name)) {
+        qWarning() << "Supervisor cannot open its control socket:" << control->errorString();
+        return false;
+    }
+
+    port = serverPort;
+    metricsBase = qEnvironmentVariableIsSet("TRON_METRICS_PORT") ? qEnvironmentVariableIntValue("TRON_METRICS_PORT") : port + 1;
+    workers.resize(workerCount);
+    for (int i = 0; i < workerCount; ++i) {
+        workers[i].restartTimer = new QTimer(this);
+        workers[i].restartTimer->setSingleShot(true);
+        connect(workers[i].restartTimer, &QTimer::timeout, this, [this, i]() { spawn(i); });
+        spawn(i);
+    }
+    return true;
+}
+
+void Supervisor::stop()
+{
+    stopping = true;
+
+    // Everyone is told first, so they hand over side by side rather than one after the other
+    for (Worker &worker : workers) {
+        if (worker.link) {
+            worker.link->write("STOP\n");
+            worker.link->flush();
+        }
+    }
+    for (Worker &worker : workers) {
+        delete worker.restartTimer;
+        if (worker.process) {
+            worker.process->disconnect(this);
+            if (!worker.process->waitForFinished(STOP_TIMEOUT_MS)) {
+                worker.process->terminate();
+                if (!worker.process->waitForFinished(STOP_TIMEOUT_MS)) {
+                    worker.process->kill();
+                    worker.process->waitForFinished(STOP_TIMEOUT_MS);
+                }
+            }
+            delete worker.process;
+        }
+        if (worker.link) {
+            worker.link->disconnect(this);
+            delete worker.link;
+        }
+    }
+    workers.clear();
+    control->close();
+    stopping = false;
+}
+
+void Supervisor::spawn(int index)
+{
+    Worker &worker = workers[index];
+
+    // Same executable, told by its environment to run headless as worker #index
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.remove("TRON_WORKERS");
+    if (environment.contains("TRON_HANDOVER_FILE")) {
+        // Each worker index has its own file; the tokens in it name that index, so resumes find their way back
+        environment.insert("TRON_HANDOVER_FILE", environment.value("TRON_HANDOVER_FILE") + "." + QString::number(index));
+    }
+    environment.insert("TRON_SUPERVISOR", control->serverName());
+    environment.insert("TRON_WORKER_INDEX", QString::number(index));
+    environment.insert("TRON_WORKER_PORT", QString::number(port));
+    environment.insert("TRON_METRICS_PORT", QString::number(metricsBase > 0 ? metricsBase + index : 0));
+    environment.insert("QT_QPA_PLATFORM", "offscreen"); // workers never show a window
+
+    worker.process = new QProcess(this);
+    worker.process->setProcessEnvironment(environment);
+    worker.process->setProcessChannelMode(QProcess::ForwardedChannels); // worker logs go to our terminal
+    connect(worker.process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this, index](int exitCode, QProcess::ExitStatus status) { onWorkerFinished(index, exitCode, status); });
+    connect(worker.process, &QProcess::errorOccurred, this, [this, index](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            onWorkerFinished(index, -1, QProcess::CrashExit); // finished() never comes
+        }
+    });
+
+    worker.reported = false;
+    worker.accepting = true;
+    worker.players = worker.rooms = worker.queued = 0;
+    worker.startedAt.start();
+    worker.process->start(QCoreApplication::applicationFilePath(), QStringList());
+    emit log("Worker " + QString::number(index) + " starting on port " + QString::number(port));
+}
+
+void Supervisor::onWorkerFinished(int index, int exitCode, QProcess::ExitStatus status)
+{
+    if (stopping || index >= workers.size()) {
+        return;
+    }
+
+    Worker &worker = workers[index];
+    worker.process->deleteLater(); // we are inside one of its signals
+    worker.process = nullptr;
+    worker.reported = false;
+    rebalance(); // whatever it had is gone, the others may need to take over
+
+    // Restart quickly after a long run, back off while it keeps dying at startup
+    if (worker.startedAt.elapsed() >= STABLE_RUN_MS || worker.restartDelayMs == 0) {
+        worker.restartDelayMs = INITIAL_RESTART_DELAY_MS;
+    } else {
+        worker.restartDelayMs = qMin(worker.restartDelayMs * 2, MAX_RESTART_DELAY_MS);
+    }
+    QString how = status == QProcess::CrashExit ? QString("crashed") : "exited with code " + QString::number(exitCode);
+    emit log("Worker " + QString::number(index) + " " + how + ", restarting in " + QString::number(worker.restartDelayMs) + " ms");
+    worker.restartTimer->start(worker.restartDelayMs);
+}
+
+void Supervisor::onWorkerConnected()
+{
+    while (QLocalSocket *link = control->nextPendingConnection()) {
+        connect(link, &QLocalSocket::readyRead, this, [this, link]() {
+            while (link->canReadLine()) {
+                onWorkerLine(link, link->readLine().trimmed());
+            }
+        });
+        connect(link, &QLocalSocket::disconnected, this, [this, link]() {
+            for (Worker &worker : workers) {
+                if (worker.link == link) {
+                    worker.link = nullptr;
+                    worker.reported = false;
+                }
+            }
+            link->deleteLater();
+        });
+    }
+}
+
+void Supervisor::onWorkerLine(QLocalSocket *link, const QByteArray &line)
+{
+    QList<QByteArray> fields = line.split(' ');
+    if (fields.value(0) == "HELLO") {
+        bool valid = false;
+        int index = fields.value(1).toInt(&valid);
+        if (!valid || index < 0 || index >= workers.size()) {
+            link->abort();
+            return;
+        }
+        if (workers[index].link && workers[index].link != link) {
+            workers[index].link->deleteLater(); // left over from the worker's previous life
+        }
+        workers[index].link = link;
+        return;
+    }
+
+    for (Worker &worker : workers) {
+        if (worker.link != link) {
+            continue;
+        }
+        if (fields.value(0) == "LOAD" && fields.size() >= 4) {
+            worker.players = fields[1].toInt();
+            worker.rooms = fields[2].toInt();
+            worker.queued = fields[3].toInt();
+            worker.reported = true;
+            rebalance();
+        }
+        return;
+    }
+}
+
+void Supervisor::rebalance()
+{
+    int least = INT_MAX;
+    for (const Worker &worker : workers) {
+        if (worker.reported) {
+            least = qMin(least, worker.players);
+        }
+    }
+    if (least == INT_MAX) {
+        return; // nothing known yet, everyone keeps listening
+    }
+
+    // The least loaded workers take new players; one still filling a matchmaking room keeps
+    // taking them too, so the room is not left waiting on players sent elsewhere
+    for (int i = 0; i < workers.size(); ++i) {
+        Worker &worker = workers[i];
+        if (!worker.reported || !worker.link) {
+            continue;
+        }
+        bool accept = worker.players <= least + PLACEMENT_SLACK || worker.queued > 0;
+        if (accept != worker.accepting) {
+            worker.accepting = accept;
+            worker.link->write(accept ? "ACCEPT 1\n" : "ACCEPT 0\n");
+            worker.link->flush();
+            emit log("Worker " + QString::number(i) + (accept ? " takes new players" : " is full, new players go elsewhere")
+                     + " (" + QString::number(worker.players) + " players, " + QString::number(worker.rooms) + " rooms)");
+        }
+    }
+}
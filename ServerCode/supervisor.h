@@ -0,0 +1,66 @@
+// supervisor.h
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+#include <QString>
+
+// Runs the game server as several worker processes of this same executable, all
+// listening on one port through SO_REUSEPORT so the kernel spreads connections
+// over them. Workers report their load over a local socket; only the least loaded
+// ones keep their listener open, so new rooms form where there is room for them.
+// A worker that dies is started again, after a pause that grows if it keeps dying.
+// With TRON_HANDOVER_FILE set each worker hands its matches over to a file of its
+// own when stopped, and its successor under the same index carries them on.
+class Supervisor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Supervisor(QObject *parent = nullptr);
+    ~Supervisor();
+
+    bool start(quint16 port, int workerCount); // false if the control socket cannot be opened
+    void stop(); // asks every worker to stop, terminates those that do not
+    bool isRunning() const { return control->isListening(); }
+
+signals:
+    void log(const QString &line); // worker starts, crashes and placement changes, for the server window
+
+private slots:
+    void onWorkerConnected();
+
+private:
+    struct Worker {
+        QProcess *process = nullptr;
+        QLocalSocket *link = nullptr;  // after its HELLO
+        QTimer *restartTimer = nullptr;
+        QElapsedTimer startedAt;
+        int restartDelayMs = 0;
+        bool reported = false;  // sent at least one LOAD
+        bool accepting = true;  // as last told; workers start out listening
+        int players = 0;
+        int rooms = 0;
+        int queued = 0;
+    };
+
+    void spawn(int index);
+    void onWorkerFinished(int index, int exitCode, QProcess::ExitStatus status);
+    void onWorkerLine(QLocalSocket *link, const QByteArray &line);
+    void rebalance(); // decide which workers take new connections
+
+    QLocalServer *control;
+    QVector<Worker> workers;
+    quint16 port = 0;
+    int metricsBase = 0; // worker i serves metrics on metricsBase + i, 0 for none
+    bool stopping = false;
+};
+
+#endif // SUPERVISOR_H
@@ -0,0 +1,67 @@
+// workerLink.cpp
+#include "workerLink.h"
+#include <QDebug>
+
+constexpr int LOAD_REPORT_INTERVAL_MS = 1000;
+
+WorkerLink::WorkerLink(int index, std::function<WorkerLoad()> measure, QObject *parent)
+    : QObject(parent),
+      index(index),
+      measure(measure),
+      socket(new QLocalSocket(this)),
+      reportTimer(new QTimer(this))
+{
+    reportTimer->setInterval(LOAD_REPORT_INTERVAL_MS);
+    connect(reportTimer, &QTimer::timeout, this, &WorkerLink::report);
+    connect(socket, &QLocalSocket::connected, this, &WorkerLink::onConnected);
+    connect(socket, &QLocalSocket::readyRead, this, &WorkerLink::onReadyRead);
+    connect(socket, &QLocalSocket::disconnected, this, &WorkerLink::supervisorLost);
+    connect(socket, QOverload<QLocalSocket::LocalSocketError>::of(&QLocalSocket::error), this, [this]() {
+        // Once connected, losing the link is reported by disconnected()
+        if (!reportTimer->isActive()) {
+            qWarning() << "Worker" << this->index << "cannot reach its supervisor:" << socket->errorString();
+            emit supervisorLost();
+        }
+    });
+}
+
+void WorkerLink::connectTo(const QString &serverName)
+{
+    socket->connectToServer(serverName);
+}
+
+void WorkerLink::onConnected()
+{
+    sendLine("HELLO " + QByteArray::number(index));
+    report();
+    reportTimer->start();
+}
+
+void WorkerLink::onReadyRead()
+{
+    while (socket->canReadLine()) {
+        QByteArray line = socket->readLine().trimmed();
+        if (line.startsWith("ACCEPT ")) {
+            emit acceptChanged(line.mid(7) == "1");
+        } else if (line == "STOP") {
+            emit stopRequested();
+        } else {
+            qDebug() << "Worker" << index << "got unknown supervisor message:" << line;
+        }
+    }
+}
+
+void WorkerLink::report()
+{
+    WorkerLoad load = measure();
+    sendLine("LOAD " + QByteArray::number(load.players) + ' ' + QByteArray::number(load.rooms) + ' '
+             + QByteArray::number(load.queued));
+}
+
+void WorkerLink::sendLine(const QByteArray &line)
+{
+    if (socket->state() == QLocalSocket::ConnectedState) {
+        socket->write(line + '\n');
+        socket->flush();
+    }
+}
@@ -0,0 +1,50 @@
+// workerLink.h
+
+#ifndef WORKERLINK_H
+#define WORKERLINK_H
+
+#include <QObject>
+#include <QLocalSocket>
+#include <QTimer>
+#include <functional>
+
+// What a worker tells the supervisor about itself
+struct WorkerLoad
+{
+    int players = 0; // connections, spectators included
+    int rooms = 0;   // matches in progress
+    int queued = 0;  // waiting in the matchmaker for a room to form
+};
+
+// A worker process's line to its supervisor over a local socket. Reports the
+// load the callback measures once a second and passes on whether this worker
+// should take new connections, and when to stop. Losing the supervisor ends the worker.
+class WorkerLink : public QObject
+{
+    Q_OBJECT
+
+public:
+    WorkerLink(int index, std::function<WorkerLoad()> measure, QObject *parent = nullptr);
+
+    void connectTo(const QString &serverName);
+
+signals:
+    void acceptChanged(bool accept); // supervisor wants new connections here, or on another worker
+    void stopRequested(); // hand over what can be and exit
+    void supervisorLost();
+
+private slots:
+    void onConnected();
+    void onReadyRead();
+    void report();
+
+private:
+    void sendLine(const QByteArray &line);
+
+    int index;
+    std::function<WorkerLoad()> measure;
+    QLocalSocket *socket;
+    QTimer *reportTimer;
+};
+
+#endif // WORKERLINK_H
@@ -0,0 +1,7 @@
+# bitStream.pro
+
+include(../test.pri)
+TARGET = tst_bitStream
+SOURCES += tst_bitStream.cpp \
+    $$COMMON/bitStream.cpp
+HEADERS += $$COMMON/bitStream.h
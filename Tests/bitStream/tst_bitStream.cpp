@@ -0,0 +1,139 @@
+// tst_bitStream.cpp
+#include <QtTest>
+#include "../../Common/bitStream.h"
+
+class TestBitStream : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void varintRoundTrip_data();
+    void varintRoundTrip();
+    void everyBitWidth();
+    void mixedFieldsStayAligned();
+    void readingPastTheEndFails();
+    void overlongVarintFails();
+    void bitsForBoundaries();
+};
+
+void TestBitStream::varintRoundTrip_data()
+{
+    QTest::addColumn<quint32>("value");
+    QTest::addColumn<int>("bytes"); // 8 bits per group of 7
+
+    QTest::newRow("zero") << quint32(0) << 1;
+    QTest::newRow("one group, largest") << quint32(127) << 1;
+    QTest::newRow("two groups, smallest") << quint32(128) << 2;
+    QTest::newRow("two groups, largest") << quint32(16383) << 2;
+    QTest::newRow("three groups, smallest") << quint32(16384) << 3;
+    QTest::newRow("four groups, largest") << quint32((1u << 28) - 1) << 4;
+    QTest::newRow("five groups, smallest") << quint32(1u << 28) << 5;
+    QTest::newRow("largest") << quint32(0xFFFFFFFFu) << 5;
+}
+
+void TestBitStream::varintRoundTrip()
+{
+    QFETCH(quint32, value);
+    QFETCH(int, bytes);
+
+    BitWriter out;
+    out.writeVarint(value);
+    QByteArray encoded = out.finish();
+    QCOMPARE(encoded.size(), bytes);
+
+    BitReader in(encoded);
+    QCOMPARE(in.readVarint(), value);
+    QVERIFY(in.ok());
+}
+
+void TestBitStream::everyBitWidth()
+{
+    // Each width twice, all ones and an alternating pattern, behind an odd bit so nothing is byte aligned
+    BitWriter out;
+    out.writeBool(true);
+    for (int count = 1; count <= 32; ++count) {
+        quint32 mask = count == 32 ? 0xFFFFFFFFu : (1u << count) - 1;
+        out.writeBits(0xFFFFFFFFu, count); // bits above count must not leak into the next field
+        out.writeBits(0xA5A5A5A5u & mask, count);
+    }
+    out.writeBool(true);
+
+    BitReader in(out.finish());
+    QVERIFY(in.readBool());
+    for (int count = 1; count <= 32; ++count) {
+        quint32 mask = count == 32 ? 0xFFFFFFFFu : (1u << count) - 1;
+        QCOMPARE(in.readBits(count), mask);
+        QCOMPARE(in.readBits(count), 0xA5A5A5A5u & mask);
+    }
+    QVERIFY(in.readBool());
+    QVERIFY(in.ok());
+}
+
+void TestBitStream::mixedFieldsStayAligned()
+{
+    BitWriter out;
+    out.writeBool(true);
+    out.writeBits(5, 3);
+    out.writeBytes("xyz");
+    out.writeVarint(300);
+    out.writeBool(false);
+    out.writeBits(0, 0); // nothing at all
+
+    BitReader in(out.finish());
+    QCOMPARE(in.readBool(), true);
+    QCOMPARE(in.readBits(3), 5u);
+    QCOMPARE(in.readBytes(3), QByteArray("xyz"));
+    QCOMPARE(in.readVarint(), 300u);
+    QCOMPARE(in.readBool(), false);
+    QCOMPARE(in.readBits(0), 0u);
+    QVERIFY(in.ok());
+}
+
+void TestBitStream::readingPastTheEndFails()
+{
+    BitWriter out;
+    out.writeBits(0x3F, 6);
+    QByteArray encoded = out.finish(); // one byte, two bits of padding
+    QCOMPARE(encoded.size(), 1);
+
+    BitReader bits(encoded);
+    QCOMPARE(bits.readBits(8), 0x3Fu); // the padding is readable, it is part of the byte
+    QVERIFY(bits.ok());
+    QCOMPARE(bits.readBits(1), 0u);
+    QVERIFY(!bits.ok());
+
+    BitReader bytes(encoded);
+    QVERIFY(bytes.readBytes(2).isEmpty());
+    QVERIFY(!bytes.ok());
+
+    BitReader negative(encoded);
+    QVERIFY(negative.readBytes(-1).isEmpty());
+    QVERIFY(!negative.ok());
+
+    BitReader empty{QByteArray()};
+    empty.readVarint();
+    QVERIFY(!empty.ok());
+}
+
+void TestBitStream::overlongVarintFails()
+{
+    // Five groups that all say another one follows is longer than any 32 bit value
+    BitReader in(QByteArray(5, char(0xFF)));
+    in.readVarint();
+    QVERIFY(!in.ok());
+}
+
+void TestBitStream::bitsForBoundaries()
+{
+    static_assert(bitsFor(0) == 0, "zero needs no bits");
+    QCOMPARE(bitsFor(1), 1);
+    QCOMPARE(bitsFor(2), 2);
+    QCOMPARE(bitsFor(255), 8);
+    QCOMPARE(bitsFor(256), 9);
+    QCOMPARE(bitsFor(40000), 16); // a 20000 unit arena in half units
+    QCOMPARE(bitsFor(0xFFFFFFFFu), 32);
+}
+
+QTEST_APPLESS_MAIN(TestBitStream)
+
+#include "tst_bitStream.moc"
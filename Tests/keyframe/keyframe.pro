@@ -0,0 +1,15 @@
+# keyframe.pro
+
+include(../test.pri)
+TARGET = tst_keyframe
+SOURCES += tst_keyframe.cpp \
+    $$COMMON/bitStream.cpp \
+    $$COMMON/snapshot.cpp \
+    $$COMMON/trailGrid.cpp \
+    $$COMMON/trailLog.cpp \
+    $$COMMON/keyframe.cpp
+HEADERS += $$COMMON/bitStream.h \
+    $$COMMON/snapshot.h \
+    $$COMMON/trailGrid.h \
+    $$COMMON/trailLog.h \
+    $$COMMON/keyframe.h
@@ -0,0 +1,118 @@
+// tst_keyframe.cpp
+#include <QtTest>
+#include "../../Common/bitStream.h"
+#include "../../Common/keyframe.h"
+
+constexpr int ARENA_WIDTH = 800;
+constexpr int ARENA_HEIGHT = 600;
+constexpr int SEGMENT_SIZE = 10;
+constexpr int DECAY_INTERVAL_TICKS = 25;
+
+// Every cell's life and, where it is alive, its owner, row by row
+static QByteArray gridContents(const TrailGrid &grid)
+{
+    QByteArray contents(grid.width() * grid.height() * 2, Qt::Uninitialized);
+    uchar *cells = reinterpret_cast<uchar *>(contents.data());
+    for (int y = 0; y < grid.height(); ++y) {
+        uchar *life = cells + y * grid.width() * 2;
+        uchar *owners = life + grid.width();
+        grid.readRow(0, y, grid.width(), life, owners);
+        for (int x = 0; x < grid.width(); ++x) {
+            owners[x] = life[x] ? owners[x] : 0; // dead cells keep a stale owner until their chunk is freed
+        }
+    }
+    return contents;
+}
+
+class TestKeyframe : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTripRebuildsTheGrid();
+    void oversizedArenaFails();
+    void truncatedPayloadFails();
+};
+
+void TestKeyframe::roundTripRebuildsTheGrid()
+{
+    // Two players laying trail the way the server does: record, stamp, and age the grid every interval
+    TrailLog log(SEGMENT_SIZE, DECAY_INTERVAL_TICKS);
+    TrailGrid grid(ARENA_WIDTH, ARENA_HEIGHT);
+    QPointF positions[2] = {QPointF(-200, -100.5), QPointF(150, 200)}; // paths that never cross
+    QPointF velocities[2] = {QPointF(1.5, 0), QPointF(0, -1.5)};
+    quint32 tick = 0;
+    for (; tick < 300; ++tick) {
+        if (tick == 120) {
+            velocities[0] = QPointF(0, 1.5); // a turn starts a new run
+        }
+        for (int owner = 0; owner < 2; ++owner) {
+            log.record(tick, positions[owner], quint8(owner));
+            grid.stamp(log.segmentAt(positions[owner]), quint8(owner));
+            positions[owner] += velocities[owner];
+        }
+        if ((tick + 1) % DECAY_INTERVAL_TICKS == 0) {
+            grid.decay();
+            log.prune(tick + 1);
+        }
+    }
+
+    Keyframe keyframe;
+    keyframe.snapshot.tick = tick;
+    for (int owner = 0; owner < 2; ++owner) {
+        PlayerState player;
+        player.id = quint8(owner);
+        player.x = float(positions[owner].x());
+        player.y = float(positions[owner].y());
+        player.moving = true;
+        keyframe.snapshot.players.append(player);
+    }
+    keyframe.trailLog = log;
+    keyframe.trails = grid;
+    keyframe.msUntilDecay = 130;
+
+    Keyframe decoded;
+    QVERIFY(Keyframe::decode(keyframe.encode(), &decoded));
+    QCOMPARE(decoded.msUntilDecay, keyframe.msUntilDecay);
+    QCOMPARE(decoded.snapshot.tick, keyframe.snapshot.tick);
+    QCOMPARE(decoded.snapshot.players.size(), 2);
+    QCOMPARE(decoded.snapshot.players[1].y, keyframe.snapshot.players[1].y);
+    QCOMPARE(decoded.trails.width(), ARENA_WIDTH);
+    QCOMPARE(decoded.trails.height(), ARENA_HEIGHT);
+    QCOMPARE(decoded.trailLog.spans().size(), log.spans().size());
+    QCOMPARE(decoded.trailLog.segmentSide(), SEGMENT_SIZE);
+
+    // The runs replayed on the receiver give back the grid the sender stamped cell for cell
+    QVERIFY(gridContents(decoded.trails) == gridContents(grid));
+}
+
+void TestKeyframe::oversizedArenaFails()
+{
+    BitWriter out;
+    out.writeVarint(30000);
+    out.writeVarint(ARENA_HEIGHT);
+    out.writeVarint(0);
+    Keyframe decoded;
+    QVERIFY(!Keyframe::decode(out.finish(), &decoded));
+}
+
+void TestKeyframe::truncatedPayloadFails()
+{
+    Keyframe keyframe;
+    keyframe.trailLog = TrailLog(SEGMENT_SIZE, DECAY_INTERVAL_TICKS);
+    keyframe.trails = TrailGrid(ARENA_WIDTH, ARENA_HEIGHT);
+    for (quint32 tick = 0; tick < 10; ++tick) {
+        keyframe.trailLog.record(tick, QPointF(tick * 1.5, 0), 0);
+    }
+    keyframe.snapshot.players.append(PlayerState());
+    QByteArray encoded = keyframe.encode();
+
+    Keyframe decoded;
+    QVERIFY(Keyframe::decode(encoded, &decoded));
+    QVERIFY(!Keyframe::decode(encoded.left(encoded.size() - 3), &decoded));
+    QVERIFY(!Keyframe::decode(QByteArray(), &decoded));
+}
+
+QTEST_APPLESS_MAIN(TestKeyframe)
+
+#include "tst_keyframe.moc"
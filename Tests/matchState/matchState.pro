@@ -0,0 +1,13 @@
+# matchState.pro
+
+include(../test.pri)
+TARGET = tst_matchState
+SOURCES += tst_matchState.cpp \
+    $$COMMON/bitStream.cpp \
+    $$COMMON/trailGrid.cpp \
+    $$COMMON/trailLog.cpp \
+    $$SERVER/matchState.cpp
+HEADERS += $$COMMON/bitStream.h \
+    $$COMMON/trailGrid.h \
+    $$COMMON/trailLog.h \
+    $$SERVER/matchState.h
@@ -0,0 +1,134 @@
+// tst_matchState.cpp
+#include <QtTest>
+#include "../../Common/bitStream.h"
+#include "../../ServerCode/matchState.h"
+
+constexpr int SEGMENT_SIZE = 10;
+constexpr int DECAY_INTERVAL_TICKS = 25;
+
+// A match a few hundred ticks in: a human, a bot with turns it has not taken yet, and a crash
+static MatchState sampleState()
+{
+    MatchState state;
+    state.arenaWidth = 1200;
+    state.arenaHeight = 900;
+    state.tick = 345;
+    state.lossCounter = 2;
+    state.gridRules = true;
+
+    MatchState::Player human;
+    human.name = "alice";
+    human.id = 0;
+    human.position = QPointF(-599.5, 449.5); // by the bottom left corner, at the edge of the range
+    human.velocity = QPointF(0, -1.5);
+    state.players.append(human);
+
+    MatchState::Player bot;
+    bot.name = "Bot 1";
+    bot.id = 1;
+    bot.bot = true;
+    bot.position = QPointF(12.5, -7.5);
+    bot.velocity = QPointF(5, 0);
+    bot.pendingTurns = {QPointF(0, 5), QPointF(-5, 0)};
+    state.players.append(bot);
+
+    MatchState::Player crashed;
+    crashed.name = "bøb"; // names are UTF-8
+    crashed.id = 2;
+    crashed.frozen = true;
+    crashed.lossOrder = 1;
+    crashed.position = QPointF(100, 100);
+    state.players.append(crashed);
+
+    state.trailLog = TrailLog(SEGMENT_SIZE, DECAY_INTERVAL_TICKS);
+    for (quint32 tick = 300; tick < 345; ++tick) {
+        state.trailLog.record(tick, QPointF(-599.5, 449.5 - (tick - 300) * 1.5), 0); // up from the corner
+    }
+    return state;
+}
+
+class TestMatchState : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void encodeDecodeRoundTrip();
+    void otherVersionsFail();
+    void damagedBlobFails();
+};
+
+void TestMatchState::encodeDecodeRoundTrip()
+{
+    MatchState state = sampleState();
+    MatchState decoded;
+    QVERIFY(MatchState::decode(state.encode(), &decoded));
+
+    QCOMPARE(decoded.arenaWidth, state.arenaWidth);
+    QCOMPARE(decoded.arenaHeight, state.arenaHeight);
+    QCOMPARE(decoded.tick, state.tick);
+    QCOMPARE(decoded.lossCounter, state.lossCounter);
+    QCOMPARE(decoded.gridRules, state.gridRules);
+    QCOMPARE(decoded.players.size(), state.players.size());
+    for (int i = 0; i < state.players.size(); ++i) {
+        const MatchState::Player &expected = state.players[i];
+        const MatchState::Player &player = decoded.players[i];
+        QCOMPARE(player.name, expected.name);
+        QCOMPARE(player.id, expected.id);
+        QCOMPARE(player.bot, expected.bot);
+        QCOMPARE(player.frozen, expected.frozen);
+        QCOMPARE(player.lossOrder, expected.lossOrder);
+        QCOMPARE(player.position, expected.position);
+        QCOMPARE(player.velocity, expected.velocity);
+        QCOMPARE(player.pendingTurns, expected.pendingTurns);
+    }
+    QCOMPARE(decoded.trailLog.spans().size(), state.trailLog.spans().size());
+    QCOMPARE(decoded.trailLog.spans().first().count, state.trailLog.spans().first().count);
+    QCOMPARE(decoded.trailLog.spans().first().first, state.trailLog.spans().first().first);
+}
+
+void TestMatchState::otherVersionsFail()
+{
+    // The version leads the blob; a newer one than this build writes is refused, as is the first
+    BitWriter newer;
+    newer.writeVarint(4);
+    MatchState state;
+    QVERIFY(!MatchState::decode(newer.finish(), &state));
+
+    BitWriter first;
+    first.writeVarint(1);
+    QVERIFY(!MatchState::decode(first.finish(), &state));
+}
+
+void TestMatchState::damagedBlobFails()
+{
+    QByteArray blob = sampleState().encode();
+    MatchState state;
+    QVERIFY(!MatchState::decode(blob.left(blob.size() / 2), &state));
+    QVERIFY(!MatchState::decode(QByteArray(), &state));
+
+    // Far more pending turns than any player queues
+    BitWriter out;
+    out.writeVarint(3);
+    out.writeVarint(800);
+    out.writeVarint(600);
+    out.writeVarint(0);
+    out.writeVarint(1);
+    out.writeBool(false);
+    out.writeVarint(1);
+    out.writeVarint(1);
+    out.writeBytes("a");
+    out.writeVarint(0);
+    out.writeBool(false);
+    out.writeBool(false);
+    out.writeVarint(0);
+    out.writeBits(0, bitsFor(800 * 2));
+    out.writeBits(0, bitsFor(600 * 2));
+    out.writeBits(3, 2);
+    out.writeVarint(3);
+    out.writeVarint(1000);
+    QVERIFY(!MatchState::decode(out.finish(), &state));
+}
+
+QTEST_APPLESS_MAIN(TestMatchState)
+
+#include "tst_matchState.moc"
@@ -0,0 +1,16 @@
+# matchmaker.pro
+
+include(../test.pri)
+QT += network
+TARGET = tst_matchmaker
+SOURCES += tst_matchmaker.cpp \
+    $$COMMON/metrics.cpp \
+    $$COMMON/netSim.cpp \
+    $$SERVER/sharedMessage.cpp \
+    $$SERVER/connection.cpp \
+    $$SERVER/matchmaker.cpp
+HEADERS += $$COMMON/metrics.h \
+    $$COMMON/netSim.h \
+    $$SERVER/sharedMessage.h \
+    $$SERVER/connection.h \
+    $$SERVER/matchmaker.h
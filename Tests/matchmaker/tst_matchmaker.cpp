@@ -0,0 +1,175 @@
+// tst_matchmaker.cpp
+#include <QtTest>
+#include <QTcpSocket>
+#include "../../ServerCode/connection.h"
+#include "../../ServerCode/matchmaker.h"
+
+// A queued player; the socket is never connected, the matchmaker only looks at the pointer
+struct Player
+{
+    QTcpSocket socket;
+    Connection connection{&socket};
+};
+
+class TestMatchmaker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void queueBookkeeping();
+    void closeRatingsMatchOnTheFirstPass();
+    void ratingGapWidensWhileWaiting();
+    void overduePlayersGetASmallerRoom();
+    void overdueOnlyPullsInTheNearestRatings();
+    void removedTicketsNeverMatch();
+
+private:
+    void watch(Matchmaker &matchmaker);
+
+    Player players[4];
+    QVector<QVector<Matchmaker::Ticket>> rooms;
+};
+
+void TestMatchmaker::init()
+{
+    rooms.clear();
+}
+
+void TestMatchmaker::cleanup()
+{
+    qunsetenv("TRON_MATCH_MAX_WAIT");
+}
+
+void TestMatchmaker::watch(Matchmaker &matchmaker)
+{
+    connect(&matchmaker, &Matchmaker::roomFormed, this, [this](const QVector<Matchmaker::Ticket> &tickets) {
+        rooms.append(tickets);
+    });
+}
+
+void TestMatchmaker::queueBookkeeping()
+{
+    Matchmaker matchmaker(2);
+    QCOMPARE(matchmaker.roomSize(), 2);
+    QCOMPARE(Matchmaker(1).roomSize(), 2); // a room of one is no match
+
+    matchmaker.enqueue(&players[0].connection, "alice");
+    matchmaker.enqueue(&players[0].connection, "alice"); // already waiting
+    matchmaker.enqueue(nullptr, "nobody");
+    QCOMPARE(matchmaker.queuedCount(), 1);
+    QVERIFY(matchmaker.isQueued(&players[0].connection));
+    QVERIFY(!matchmaker.isQueued(&players[1].connection));
+
+    QVERIFY(matchmaker.remove(&players[0].connection));
+    QVERIFY(!matchmaker.remove(&players[0].connection));
+    QCOMPARE(matchmaker.queuedCount(), 0);
+}
+
+void TestMatchmaker::closeRatingsMatchOnTheFirstPass()
+{
+    Matchmaker matchmaker(2);
+    watch(matchmaker);
+    matchmaker.enqueue(&players[0].connection, "alice", 1000);
+    matchmaker.enqueue(&players[1].connection, "bob", 1050);
+    QVERIFY(rooms.isEmpty()); // joining never runs a pass
+
+    QTRY_COMPARE(rooms.size(), 1);
+    QCOMPARE(rooms[0].size(), 2);
+    QCOMPARE(rooms[0][0].playerName, QString("alice")); // lowest rating first
+    QCOMPARE(rooms[0][1].playerName, QString("bob"));
+    QCOMPARE(matchmaker.queuedCount(), 0);
+    QCOMPARE(matchmaker.matchedPlayers(), qint64(2));
+}
+
+void TestMatchmaker::ratingGapWidensWhileWaiting()
+{
+    // 160 apart: too far for the first three seconds, within 100 + 3 * 25 after that
+    Matchmaker matchmaker(2);
+    watch(matchmaker);
+    matchmaker.enqueue(&players[0].connection, "alice", 1000);
+    matchmaker.enqueue(&players[1].connection, "bob", 1160);
+
+    QTest::qWait(1200);
+    QVERIFY(rooms.isEmpty());
+    QCOMPARE(matchmaker.queuedCount(), 2);
+
+    QTRY_COMPARE_WITH_TIMEOUT(rooms.size(), 1, 5000);
+    QVERIFY(matchmaker.longestWaitMs() >= 3000);
+    QCOMPARE(matchmaker.queuedCount(), 0);
+}
+
+void TestMatchmaker::overduePlayersGetASmallerRoom()
+{
+    qputenv("TRON_MATCH_MAX_WAIT", "0");
+    Matchmaker matchmaker(4);
+    watch(matchmaker);
+    matchmaker.enqueue(&players[0].connection, "alice", 1000);
+    matchmaker.enqueue(&players[1].connection, "bob", 3000);
+    matchmaker.enqueue(&players[2].connection, "carol", 2000);
+
+    // Three players can never fill a room of four and are far apart, but nobody waits forever
+    QTRY_COMPARE(rooms.size(), 1);
+    QCOMPARE(rooms[0].size(), 3);
+    QCOMPARE(rooms[0][1].playerName, QString("carol"));
+    QCOMPARE(matchmaker.queuedCount(), 0);
+
+    // One player alone is still not a match
+    matchmaker.enqueue(&players[3].connection, "dave");
+    QTest::qWait(1000);
+    QCOMPARE(rooms.size(), 1);
+    QCOMPARE(matchmaker.queuedCount(), 1);
+}
+
+void TestMatchmaker::overdueOnlyPullsInTheNearestRatings()
+{
+    qputenv("TRON_MATCH_MAX_WAIT", "1000");
+    Matchmaker matchmaker(2);
+    watch(matchmaker);
+    matchmaker.enqueue(&players[0].connection, "alice", 1000);
+    QTest::qWait(1100);
+
+    // Nobody is close enough for a full room; alice is overdue, the others have only just queued
+    matchmaker.enqueue(&players[1].connection, "bob", 1300);
+    matchmaker.enqueue(&players[2].connection, "carol", 5000);
+    matchmaker.enqueue(&players[3].connection, "dave", 9000);
+    QTRY_COMPARE(rooms.size(), 1);
+    QCOMPARE(rooms[0].size(), 2);
+    QCOMPARE(rooms[0][0].playerName, QString("alice"));
+    QCOMPARE(rooms[0][1].playerName, QString("bob"));
+
+    // Carol and dave keep waiting for a better match until they are overdue themselves
+    QCOMPARE(matchmaker.queuedCount(), 2);
+    QVERIFY(matchmaker.isQueued(&players[2].connection));
+    QVERIFY(matchmaker.isQueued(&players[3].connection));
+}
+
+void TestMatchmaker::removedTicketsNeverMatch()
+{
+    Matchmaker matchmaker(2);
+    watch(matchmaker);
+    matchmaker.enqueue(&players[0].connection, "alice", 1000);
+    matchmaker.enqueue(&players[1].connection, "bob", 1000);
+    QVERIFY(matchmaker.remove(&players[1].connection));
+    QCOMPARE(matchmaker.queuedCount(), 1);
+
+    // Leaving and queueing again leaves one live ticket behind, not two
+    matchmaker.remove(&players[0].connection);
+    matchmaker.enqueue(&players[0].connection, "alice", 1000);
+    QTest::qWait(700);
+    QVERIFY(rooms.isEmpty());
+    QCOMPARE(matchmaker.queuedCount(), 1);
+
+    matchmaker.enqueue(&players[2].connection, "carol", 1010);
+    QTRY_COMPARE(rooms.size(), 1);
+    QCOMPARE(rooms[0].size(), 2);
+    QCOMPARE(rooms[0][0].connection, &players[0].connection);
+    QCOMPARE(rooms[0][1].connection, &players[2].connection);
+    QCOMPARE(matchmaker.queuedCount(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestMatchmaker)
+
+#include "tst_matchmaker.moc"
@@ -0,0 +1,7 @@
+# netSim.pro
+
+include(../test.pri)
+TARGET = tst_netSim
+SOURCES += tst_netSim.cpp \
+    $$COMMON/netSim.cpp
+HEADERS += $$COMMON/netSim.h
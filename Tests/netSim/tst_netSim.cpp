@@ -0,0 +1,100 @@
+// tst_netSim.cpp
+#include <QtTest>
+#include "../../Common/netSim.h"
+#include <algorithm>
+
+constexpr int MESSAGES = 200;
+
+// Indexes of the messages that made it through, in the order they arrived
+static QVector<int> deliveries(NetSim::Mode mode, const NetSimConfig &config)
+{
+    NetSim sim(mode, config);
+    QVector<int> delivered;
+    for (int i = 0; i < MESSAGES; ++i) {
+        sim.transmit(100, [&delivered, i]() { delivered.append(i); });
+    }
+    QTest::qWaitFor([&sim]() { return sim.pending() == 0; }, 5000);
+    return delivered;
+}
+
+class TestNetSim : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void perfectLinkDeliversAtOnce();
+    void seededLossIsRepeatable();
+    void otherSeedLosesOtherDatagrams();
+    void reorderHoldsDatagramsBack();
+    void streamNeverLosesOrReorders();
+};
+
+void TestNetSim::perfectLinkDeliversAtOnce()
+{
+    NetSim sim(NetSim::Datagrams, NetSimConfig());
+    bool delivered = false;
+    sim.transmit(100, [&delivered]() { delivered = true; });
+    QVERIFY(delivered); // no event loop needed
+    QCOMPARE(sim.pending(), 0);
+}
+
+void TestNetSim::seededLossIsRepeatable()
+{
+    NetSimConfig config;
+    config.lossPercent = 30;
+    config.seed = 42;
+
+    QVector<int> first = deliveries(NetSim::Datagrams, config);
+    QVector<int> second = deliveries(NetSim::Datagrams, config);
+    QCOMPARE(first, second);
+    QVERIFY(first.size() > MESSAGES / 2);
+    QVERIFY(first.size() < MESSAGES);
+    QVERIFY(std::is_sorted(first.begin(), first.end())); // lost, never reordered
+}
+
+void TestNetSim::otherSeedLosesOtherDatagrams()
+{
+    NetSimConfig config;
+    config.lossPercent = 30;
+    config.seed = 42;
+    QVector<int> first = deliveries(NetSim::Datagrams, config);
+
+    config.seed = 43;
+    QVERIFY(deliveries(NetSim::Datagrams, config) != first);
+}
+
+void TestNetSim::reorderHoldsDatagramsBack()
+{
+    NetSimConfig config;
+    config.latencyMs = 5;
+    config.reorderPercent = 20;
+    config.seed = 7;
+
+    QVector<int> delivered = deliveries(NetSim::Datagrams, config);
+    QCOMPARE(delivered.size(), MESSAGES); // held back, not lost
+    QVERIFY(!std::is_sorted(delivered.begin(), delivered.end()));
+    std::sort(delivered.begin(), delivered.end());
+    for (int i = 0; i < MESSAGES; ++i) {
+        QCOMPARE(delivered[i], i);
+    }
+}
+
+void TestNetSim::streamNeverLosesOrReorders()
+{
+    NetSimConfig config;
+    config.latencyMs = 5;
+    config.jitterMs = 20;
+    config.lossPercent = 50;
+    config.reorderPercent = 50;
+    config.seed = 42;
+
+    QVector<int> delivered = deliveries(NetSim::Stream, config);
+    QCOMPARE(delivered.size(), MESSAGES);
+    for (int i = 0; i < MESSAGES; ++i) {
+        QCOMPARE(delivered[i], i);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestNetSim)
+
+#include "tst_netSim.moc"
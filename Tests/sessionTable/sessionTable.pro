@@ -0,0 +1,16 @@
+# sessionTable.pro
+
+include(../test.pri)
+QT += network
+TARGET = tst_sessionTable
+SOURCES += tst_sessionTable.cpp \
+    $$COMMON/metrics.cpp \
+    $$COMMON/netSim.cpp \
+    $$SERVER/sharedMessage.cpp \
+    $$SERVER/connection.cpp \
+    $$SERVER/sessionTable.cpp
+HEADERS += $$COMMON/metrics.h \
+    $$COMMON/netSim.h \
+    $$SERVER/sharedMessage.h \
+    $$SERVER/connection.h \
+    $$SERVER/sessionTable.h
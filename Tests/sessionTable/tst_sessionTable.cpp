@@ -0,0 +1,160 @@
+// tst_sessionTable.cpp
+#include <QtTest>
+#include <QTcpSocket>
+#include "../../ServerCode/connection.h"
+#include "../../ServerCode/sessionTable.h"
+
+constexpr int GRACE_MS = 200;
+
+// A player's stream; never connected, the table only looks at the pointer and its token
+struct Player
+{
+    QTcpSocket socket;
+    Connection connection{&socket};
+};
+
+class TestSessionTable : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void graceComesFromTheEnvironment();
+    void issuedTokensAreBound();
+    void tokensNameTheirWorker();
+    void resumeTakesTheHeldPlace();
+    void takeoverFindsTheHalfOpenStream();
+    void unbindLeavesAMovedToken();
+    void expiredSessionsAreForgotten();
+    void holdingAgainRestartsTheClock();
+};
+
+void TestSessionTable::cleanup()
+{
+    qunsetenv("TRON_RESUME_GRACE");
+}
+
+void TestSessionTable::graceComesFromTheEnvironment()
+{
+    QCOMPARE(SessionTable().graceMs(), int(SessionTable::DEFAULT_GRACE_MS));
+    qputenv("TRON_RESUME_GRACE", "2500");
+    QCOMPARE(SessionTable().graceMs(), 2500);
+    qputenv("TRON_RESUME_GRACE", "-1");
+    QCOMPARE(SessionTable().graceMs(), 0);
+}
+
+void TestSessionTable::issuedTokensAreBound()
+{
+    SessionTable table;
+    Player alice, bob;
+    quint64 aliceToken = table.issue(&alice.connection);
+    quint64 bobToken = table.issue(&bob.connection);
+    QVERIFY(aliceToken != 0);
+    QVERIFY(aliceToken != bobToken);
+    QCOMPARE(alice.connection.sessionToken(), aliceToken);
+    QCOMPARE(table.connectionFor(aliceToken), &alice.connection);
+    QCOMPARE(table.connectionFor(bobToken), &bob.connection);
+    QCOMPARE(table.connectionFor(aliceToken + 1), static_cast<Connection *>(nullptr));
+}
+
+void TestSessionTable::tokensNameTheirWorker()
+{
+    SessionTable table;
+    Player alone, worker;
+    QCOMPARE(SessionTable::workerOf(table.issue(&alone.connection)), -1);
+
+    table.setWorker(6);
+    for (int i = 0; i < 100; ++i) {
+        QCOMPARE(SessionTable::workerOf(table.issue(&worker.connection)), 6);
+    }
+    table.setWorker(0);
+    QCOMPARE(SessionTable::workerOf(table.issue(&worker.connection)), 0);
+}
+
+void TestSessionTable::resumeTakesTheHeldPlace()
+{
+    // Alice drops mid-match and comes back on a new stream
+    SessionTable table;
+    Player dropped, resumed;
+    quint64 token = table.issue(&dropped.connection);
+    table.unbind(&dropped.connection);
+    table.hold(token, "alice", 3);
+    QVERIFY(table.isHeld(token));
+    QCOMPARE(table.connectionFor(token), static_cast<Connection *>(nullptr));
+
+    SessionTable::Session session;
+    QVERIFY(!table.take(token + 1, &session)); // someone else's guess
+    QVERIFY(table.take(token, &session));
+    QCOMPARE(session.playerName, QString("alice"));
+    QCOMPARE(session.roomId, 3);
+    QVERIFY(!table.take(token, &session)); // only once
+
+    table.bind(token, &resumed.connection);
+    QCOMPARE(resumed.connection.sessionToken(), token);
+    QCOMPARE(table.connectionFor(token), &resumed.connection);
+}
+
+void TestSessionTable::takeoverFindsTheHalfOpenStream()
+{
+    // The server has not noticed the old stream go; the resume finds it by the token
+    SessionTable table;
+    Player stale, fresh;
+    quint64 token = table.issue(&stale.connection);
+    QCOMPARE(table.connectionFor(token), &stale.connection);
+
+    // What the server does on finding it: drop it, holding the place, then resume as usual
+    table.unbind(&stale.connection);
+    table.hold(token, "alice", 1);
+    SessionTable::Session session;
+    QVERIFY(table.take(token, &session));
+    table.bind(token, &fresh.connection);
+    QCOMPARE(table.connectionFor(token), &fresh.connection);
+}
+
+void TestSessionTable::unbindLeavesAMovedToken()
+{
+    // The stale stream's own disconnect comes in after the player resumed elsewhere
+    SessionTable table;
+    Player stale, fresh;
+    quint64 token = table.issue(&stale.connection);
+    table.bind(token, &fresh.connection);
+    table.unbind(&stale.connection);
+    QCOMPARE(table.connectionFor(token), &fresh.connection);
+
+    table.unbind(&fresh.connection);
+    QCOMPARE(table.connectionFor(token), static_cast<Connection *>(nullptr));
+}
+
+void TestSessionTable::expiredSessionsAreForgotten()
+{
+    SessionTable table;
+    table.setGraceMs(GRACE_MS);
+    QSignalSpy expired(&table, &SessionTable::expired);
+    table.hold(42, "alice", 1);
+
+    QTRY_COMPARE(expired.count(), 1);
+    QCOMPARE(expired.first().first().toString(), QString("alice"));
+    QVERIFY(!table.isHeld(42));
+    SessionTable::Session session;
+    QVERIFY(!table.take(42, &session));
+}
+
+void TestSessionTable::holdingAgainRestartsTheClock()
+{
+    SessionTable table;
+    table.setGraceMs(GRACE_MS);
+    QSignalSpy expired(&table, &SessionTable::expired);
+    table.hold(42, "alice", 1);
+    QTest::qWait(GRACE_MS / 2);
+    table.hold(42, "alice", 2); // resumed and dropped again
+
+    QTest::qWait(GRACE_MS / 2 + 10); // past the first deadline
+    QVERIFY(table.isHeld(42));
+    QTRY_COMPARE(expired.count(), 1);
+    QVERIFY(table.held().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestSessionTable)
+
+#include "tst_sessionTable.moc"
@@ -0,0 +1,30 @@
+# simulation.pro
+
+include(../test.pri)
+QT += widgets # Player's direction helpers live with its sprite
+TARGET = tst_simulation
+SOURCES += tst_simulation.cpp \
+    $$COMMON/bitStream.cpp \
+    $$COMMON/metrics.cpp \
+    $$COMMON/snapshot.cpp \
+    $$COMMON/trailGrid.cpp \
+    $$COMMON/trailLog.cpp \
+    $$COMMON/keyframe.cpp \
+    $$SERVER/bot.cpp \
+    $$SERVER/occupancyGrid.cpp \
+    $$SERVER/matchState.cpp \
+    $$SERVER/player.cpp \
+    $$SERVER/movements.cpp \
+    $$SERVER/simulation.cpp
+HEADERS += $$COMMON/bitStream.h \
+    $$COMMON/metrics.h \
+    $$COMMON/snapshot.h \
+    $$COMMON/trailGrid.h \
+    $$COMMON/trailLog.h \
+    $$COMMON/keyframe.h \
+    $$SERVER/bot.h \
+    $$SERVER/occupancyGrid.h \
+    $$SERVER/matchState.h \
+    $$SERVER/player.h \
+    $$SERVER/movements.h \
+    $$SERVER/simulation.h
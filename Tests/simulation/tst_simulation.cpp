@@ -0,0 +1,227 @@
+// tst_simulation.cpp
+#include <QtTest>
+#include "../../ServerCode/simulation.h"
+
+constexpr quint32 END_TICK = 40; // past the first trail decay, so ages are compared too
+
+// Life of every cell, the part both sides of a rewind agree on
+static QByteArray gridLife(const TrailGrid &grid)
+{
+    QByteArray life(grid.width() * grid.height(), Qt::Uninitialized);
+    QByteArray owners(grid.width(), Qt::Uninitialized);
+    for (int y = 0; y < grid.height(); ++y) {
+        grid.readRow(0, y, grid.width(), reinterpret_cast<uchar *>(life.data()) + y * grid.width(),
+                     reinterpret_cast<uchar *>(owners.data()));
+    }
+    return life;
+}
+
+// Alice heads right from the first tick; bob stands still and lays no trail
+static void startMatch(Simulation *simulation)
+{
+    simulation->addPlayer("alice");
+    simulation->addPlayer("bob");
+    simulation->processInput("alice", "D");
+}
+
+static void runUntil(Simulation *simulation, quint32 tick)
+{
+    while (simulation->currentTick() < tick) {
+        simulation->advance();
+    }
+}
+
+// Same players where they were, and the same trails
+static void compareMatches(const Simulation &a, const Simulation &b)
+{
+    Snapshot first = a.buildSnapshot();
+    Snapshot second = b.buildSnapshot();
+    QCOMPARE(first.tick, second.tick);
+    QCOMPARE(first.players.size(), second.players.size());
+    for (int i = 0; i < first.players.size(); ++i) {
+        QCOMPARE(first.players[i].x, second.players[i].x);
+        QCOMPARE(first.players[i].y, second.players[i].y);
+        QCOMPARE(first.players[i].heading, second.players[i].heading);
+        QCOMPARE(first.players[i].alive, second.players[i].alive);
+    }
+    QVERIFY(gridLife(a.trailGrid()) == gridLife(b.trailGrid()));
+}
+
+// Grid rules, two players on the same row 24 cells apart, heading for each other; the one on
+// the right sets off a step late when stagger is set. Which of them moves first each step
+// depends on the names alone.
+static void startGridDuel(Simulation *simulation, const QString &left, const QString &right, bool stagger)
+{
+    simulation->setRules(Simulation::GridRules);
+    simulation->addPlayer(left);
+    simulation->addPlayer(right);
+    simulation->processInput(left, "D");
+    if (stagger) {
+        runUntil(simulation, 3); // the first step, on tick 0
+    }
+    simulation->processInput(right, "A");
+}
+
+static PlayerState playerWithId(const Snapshot &snapshot, quint8 id)
+{
+    for (const PlayerState &player : snapshot.players) {
+        if (player.id == id) {
+            return player;
+        }
+    }
+    return PlayerState();
+}
+
+class TestSimulation : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void lateTurnLandsWhereItWasMade();
+    void lateTurnsKeepTheirOrder();
+    void tooLateTurnLandsAtTheOldestKeptTick();
+    void restoredBotsCarryOn();
+    void gridPlayersMeetingInACellBothCrash();
+    void gridPlayersSwappingCellsBothCrash();
+};
+
+void TestSimulation::lateTurnLandsWhereItWasMade()
+{
+    Simulation onTime;
+    startMatch(&onTime);
+    runUntil(&onTime, 10);
+    onTime.processInput("alice", "S");
+    runUntil(&onTime, END_TICK);
+
+    // The same turn, made with tick 10 on screen, reaches the server five ticks later
+    Simulation late;
+    startMatch(&late);
+    runUntil(&late, 15);
+    late.processInput("alice", "S", 10);
+    runUntil(&late, END_TICK);
+    compareMatches(onTime, late);
+
+    // The run taken back is gone from the log as well as the grid
+    TrailGrid rebuilt(late.arenaSize().width(), late.arenaSize().height());
+    late.buildKeyframe().trailLog.replay(&rebuilt, late.currentTick());
+    QVERIFY(gridLife(rebuilt) == gridLife(late.trailGrid()));
+}
+
+void TestSimulation::lateTurnsKeepTheirOrder()
+{
+    // Down at tick 10, right again at 11: a step down the stairs
+    Simulation onTime;
+    startMatch(&onTime);
+    runUntil(&onTime, 10);
+    onTime.processInput("alice", "S");
+    runUntil(&onTime, 11);
+    onTime.processInput("alice", "D");
+    runUntil(&onTime, END_TICK);
+
+    // The second turn claims an earlier tick than the first; it lands the tick after it
+    Simulation late;
+    startMatch(&late);
+    runUntil(&late, 15);
+    late.processInput("alice", "S", 10);
+    runUntil(&late, 16);
+    late.processInput("alice", "D", 5);
+    runUntil(&late, END_TICK);
+    compareMatches(onTime, late);
+}
+
+void TestSimulation::tooLateTurnLandsAtTheOldestKeptTick()
+{
+    const quint32 arrival = 30;
+    Simulation onTime;
+    startMatch(&onTime);
+    runUntil(&onTime, arrival - Simulation::MAX_REWIND_TICKS);
+    onTime.processInput("alice", "S");
+    runUntil(&onTime, END_TICK);
+
+    Simulation late;
+    startMatch(&late);
+    runUntil(&late, arrival);
+    late.processInput("alice", "S", 2); // older than the history kept
+    runUntil(&late, END_TICK);
+    compareMatches(onTime, late);
+}
+
+void TestSimulation::restoredBotsCarryOn()
+{
+    // On the grid a bot's choice waits for its next step, so a handover can catch one in between
+    Simulation original;
+    original.setRules(Simulation::GridRules);
+    original.addPlayer("alice");
+    for (int i = 1; i <= 3; ++i) {
+        original.addBot("Bot " + QString::number(i));
+    }
+    MatchState state;
+    bool waiting = false;
+    while (!waiting && original.currentTick() < 100) {
+        original.advance();
+        state = original.captureState();
+        for (const MatchState::Player &player : state.players) {
+            waiting = waiting || (player.bot && !player.pendingTurns.isEmpty());
+        }
+    }
+    QVERIFY(waiting);
+
+    MatchState decoded;
+    QVERIFY(MatchState::decode(state.encode(), &decoded));
+    Simulation restored;
+    QVERIFY(restored.restoreState(decoded));
+    QVERIFY(restored.isBot("Bot 2"));
+    QVERIFY(!restored.isBot("alice"));
+
+    // Same bots thinking on the same ticks, with the same turns in hand
+    quint32 end = original.currentTick() + 300;
+    runUntil(&original, end);
+    runUntil(&restored, end);
+    compareMatches(original, restored);
+    QCOMPARE(restored.crashOrder(), original.crashOrder());
+}
+
+void TestSimulation::gridPlayersMeetingInACellBothCrash()
+{
+    // Both reach the cell between them on the same step, twelve steps in
+    Simulation simulation;
+    startGridDuel(&simulation, "alice", "bob", false);
+    runUntil(&simulation, 33);
+    QVERIFY(simulation.crashOrder().isEmpty());
+    runUntil(&simulation, END_TICK);
+
+    QCOMPARE(simulation.crashOrder().size(), 2);
+    Snapshot snapshot = simulation.buildSnapshot();
+    for (quint8 id = 0; id < 2; ++id) {
+        PlayerState player = playerWithId(snapshot, id);
+        QVERIFY(!player.alive);
+        QCOMPARE(player.x, -107.5f); // cell 58 of the row, the one they both entered
+        QCOMPARE(player.y, -247.5f);
+    }
+}
+
+void TestSimulation::gridPlayersSwappingCellsBothCrash()
+{
+    // A step late, the right player leaves an odd gap: they end up side by side and each
+    // steps into the cell the other just left, which is trail by then whoever moves first
+    for (const QString &left : {QString("alice"), QString("zed")}) {
+        Simulation simulation;
+        startGridDuel(&simulation, left, "bob", true);
+        runUntil(&simulation, 36);
+        QVERIFY(simulation.crashOrder().isEmpty());
+        runUntil(&simulation, END_TICK);
+
+        QCOMPARE(simulation.crashOrder().size(), 2);
+        Snapshot snapshot = simulation.buildSnapshot();
+        PlayerState leftPlayer = playerWithId(snapshot, 0);
+        PlayerState rightPlayer = playerWithId(snapshot, 1);
+        QVERIFY(!leftPlayer.alive);
+        QVERIFY(!rightPlayer.alive);
+        QCOMPARE(leftPlayer.x, -102.5f); // cell 59, where the right player was
+        QCOMPARE(rightPlayer.x, -107.5f); // cell 58
+    }
+}
+
+QTEST_APPLESS_MAIN(TestSimulation)
+
+#include "tst_simulation.moc"
@@ -0,0 +1,9 @@
+# snapshot.pro
+
+include(../test.pri)
+TARGET = tst_snapshot
+SOURCES += tst_snapshot.cpp \
+    $$COMMON/bitStream.cpp \
+    $$COMMON/snapshot.cpp
+HEADERS += $$COMMON/bitStream.h \
+    $$COMMON/snapshot.h
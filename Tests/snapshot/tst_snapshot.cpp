@@ -0,0 +1,125 @@
+// tst_snapshot.cpp
+#include <QtTest>
+#include "../../Common/bitStream.h"
+#include "../../Common/snapshot.h"
+
+static bool samePlayer(const PlayerState &a, const PlayerState &b)
+{
+    return a.id == b.id && a.x == b.x && a.y == b.y && a.heading == b.heading && a.moving == b.moving && a.alive == b.alive;
+}
+
+class TestSnapshot : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip();
+    void coordinateWidths_data();
+    void coordinateWidths();
+    void emptySnapshot();
+    void truncatedPayloadFails();
+    void impossiblePlayerCountFails();
+};
+
+void TestSnapshot::roundTrip()
+{
+    Snapshot snapshot;
+    snapshot.tick = 123456;
+    for (int i = 0; i < 8; ++i) {
+        PlayerState player;
+        player.id = quint8(i * 37); // ids past 127 take a second varint group
+        player.x = -399.5f + i * 101.5f;
+        player.y = 299.5f - i * 75.0f;
+        player.heading = quint8(i % 4);
+        player.moving = i % 2 == 0;
+        player.alive = i % 3 != 0;
+        snapshot.players.append(player);
+    }
+
+    Snapshot decoded;
+    QVERIFY(Snapshot::decode(snapshot.encode(), &decoded));
+    QCOMPARE(decoded.tick, snapshot.tick);
+    QCOMPARE(decoded.players.size(), snapshot.players.size());
+    for (int i = 0; i < snapshot.players.size(); ++i) {
+        QVERIFY2(samePlayer(decoded.players[i], snapshot.players[i]), qPrintable(QString("player %1").arg(i)));
+    }
+}
+
+void TestSnapshot::coordinateWidths_data()
+{
+    QTest::addColumn<float>("farthest");
+
+    // The farthest player sets the width; each row sits on or next to a power of two in half units
+    QTest::newRow("center") << 0.0f;
+    QTest::newRow("half unit") << 0.5f;
+    QTest::newRow("one unit") << 1.0f;
+    QTest::newRow("just under 1024 steps") << 511.5f;
+    QTest::newRow("1024 steps") << 512.0f;
+    QTest::newRow("largest arena") << 10000.0f;
+}
+
+void TestSnapshot::coordinateWidths()
+{
+    QFETCH(float, farthest);
+
+    Snapshot snapshot;
+    snapshot.tick = 1;
+    PlayerState far;
+    far.x = farthest;
+    far.y = -farthest;
+    PlayerState near;
+    near.id = 1;
+    near.x = -0.5f;
+    near.y = 0.5f;
+    snapshot.players = {far, near};
+
+    Snapshot decoded;
+    QVERIFY(Snapshot::decode(snapshot.encode(), &decoded));
+    QCOMPARE(decoded.players.size(), 2);
+    QVERIFY(samePlayer(decoded.players[0], far));
+    QVERIFY(samePlayer(decoded.players[1], near));
+}
+
+void TestSnapshot::emptySnapshot()
+{
+    Snapshot snapshot;
+    snapshot.tick = 7;
+
+    Snapshot decoded;
+    decoded.players.resize(3); // left over from an earlier snapshot
+    QVERIFY(Snapshot::decode(snapshot.encode(), &decoded));
+    QCOMPARE(decoded.tick, 7u);
+    QVERIFY(decoded.players.isEmpty());
+}
+
+void TestSnapshot::truncatedPayloadFails()
+{
+    Snapshot snapshot;
+    snapshot.tick = 99;
+    for (int i = 0; i < 4; ++i) {
+        PlayerState player;
+        player.id = quint8(i);
+        player.x = 100.5f * i;
+        snapshot.players.append(player);
+    }
+    QByteArray encoded = snapshot.encode();
+
+    Snapshot decoded;
+    QVERIFY(!Snapshot::decode(QByteArray(), &decoded));
+    QVERIFY(!Snapshot::decode(encoded.left(encoded.size() / 2), &decoded));
+    QVERIFY(!Snapshot::decode(encoded.left(encoded.size() - 2), &decoded));
+}
+
+void TestSnapshot::impossiblePlayerCountFails()
+{
+    // More players than the payload has bytes can only be damage
+    BitWriter out;
+    out.writeVarint(1);
+    out.writeVarint(1000);
+    Snapshot decoded;
+    QVERIFY(!Snapshot::decode(out.finish(), &decoded));
+}
+
+QTEST_APPLESS_MAIN(TestSnapshot)
+
+#include "tst_snapshot.moc"
@@ -0,0 +1,10 @@
+# test.pri
+# Shared by every test project: a console Qt Test executable that "make check" runs.
+
+QT += testlib
+QT -= gui
+CONFIG += testcase console c++11
+CONFIG -= app_bundle
+
+COMMON = $$PWD/../Common
+SERVER = $$PWD/../ServerCode
@@ -0,0 +1,15 @@
+# tests.pro
+# Unit tests for the display-free codecs and data structures; "make check" runs them all.
+
+TEMPLATE = subdirs
+SUBDIRS = \
+    bitStream \
+    snapshot \
+    keyframe \
+    trailLog \
+    netSim \
+    trailGrid \
+    matchmaker \
+    sessionTable \
+    simulation \
+    matchState
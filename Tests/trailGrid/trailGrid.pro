@@ -0,0 +1,7 @@
+# trailGrid.pro
+
+include(../test.pri)
+TARGET = tst_trailGrid
+SOURCES += tst_trailGrid.cpp \
+    $$COMMON/trailGrid.cpp
+HEADERS += $$COMMON/trailGrid.h
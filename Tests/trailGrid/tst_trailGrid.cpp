@@ -0,0 +1,200 @@
+// tst_trailGrid.cpp
+#include <QtTest>
+#include "../../Common/trailGrid.h"
+
+constexpr int GRID_SIDE = 200;                             // centered on (0, 0), cells 64 to 127 are one chunk
+constexpr int EDGE_LIFE = TrailGrid::LIFE_PER_SHRINK_STEP; // a segment's outer ring
+
+static int lifeAt(const TrailGrid &grid, int x, int y, quint8 *owner = nullptr)
+{
+    uchar life = 0;
+    uchar cellOwner = 0;
+    grid.readRow(x, y, 1, &life, &cellOwner);
+    if (owner) {
+        *owner = cellOwner;
+    }
+    return life;
+}
+
+class TestTrailGrid : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void stampIsBrightestInTheMiddle();
+    void agedStampMatchesDecayedStamp();
+    void newerSegmentOwnsTheCell();
+    void decayReportsExpiredCells();
+    void cellsOutsideTheGridAreFree();
+    void decayShrinksAndFreesChunks();
+    void stampAcrossChunkBorders();
+    void copiesShareUntilWritten();
+    void clearAreaOnlyClearsThatArea();
+    void occupancyIsClippedToTheGrid();
+};
+
+void TestTrailGrid::stampIsBrightestInTheMiddle()
+{
+    TrailGrid grid(GRID_SIDE, GRID_SIDE);
+    QRect changed = grid.stamp(QRectF(-5, -5, 10, 10), 3);
+    QCOMPARE(changed, QRect(95, 95, 10, 10));
+
+    // One step of life more per ring inward, the middle has the most
+    QCOMPARE(lifeAt(grid, 95, 100), EDGE_LIFE);
+    QCOMPARE(lifeAt(grid, 96, 100), 2 * EDGE_LIFE);
+    quint8 owner = 0;
+    QCOMPARE(lifeAt(grid, 99, 99, &owner), TrailGrid::peakLife(10));
+    QCOMPARE(owner, quint8(3));
+    QCOMPARE(lifeAt(grid, 104, 104), EDGE_LIFE);
+    QCOMPARE(lifeAt(grid, 105, 100), 0);
+    QCOMPARE(lifeAt(grid, 94, 100), 0);
+}
+
+void TestTrailGrid::agedStampMatchesDecayedStamp()
+{
+    TrailGrid decayed(GRID_SIDE, GRID_SIDE);
+    decayed.stamp(QRectF(-5, -5, 10, 10), 1);
+    for (int i = 0; i < 15; ++i) {
+        decayed.decay();
+    }
+
+    TrailGrid aged(GRID_SIDE, GRID_SIDE);
+    aged.stamp(QRectF(-5, -5, 10, 10), 1, 15);
+    for (int y = 90; y < 110; ++y) {
+        for (int x = 90; x < 110; ++x) {
+            QCOMPARE(lifeAt(aged, x, y), lifeAt(decayed, x, y));
+        }
+    }
+}
+
+void TestTrailGrid::newerSegmentOwnsTheCell()
+{
+    TrailGrid grid(GRID_SIDE, GRID_SIDE);
+    grid.stamp(QRectF(-5, -5, 10, 10), 1);
+    grid.stamp(QRectF(-5, -5, 10, 10), 2); // equally alive, the newer one is on top
+    quint8 owner = 0;
+    lifeAt(grid, 100, 100, &owner);
+    QCOMPARE(owner, quint8(2));
+
+    grid.stamp(QRectF(-5, -5, 10, 10), 4, 5); // older, weaker everywhere, changes nothing
+    lifeAt(grid, 100, 100, &owner);
+    QCOMPARE(owner, quint8(2));
+}
+
+void TestTrailGrid::decayReportsExpiredCells()
+{
+    TrailGrid grid(GRID_SIDE, GRID_SIDE);
+    grid.stamp(QRectF(-5, -5, 10, 10), 0);
+
+    QVector<QRect> expired;
+    for (int i = 0; i < EDGE_LIFE - 1; ++i) {
+        grid.decay(&expired);
+    }
+    QVERIFY(expired.isEmpty());
+
+    grid.decay(&expired); // the outer ring, one span per row that lost cells
+    QCOMPARE(expired.size(), 10);
+    QRect covered;
+    for (const QRect &span : expired) {
+        QCOMPARE(span.height(), 1);
+        covered |= span;
+    }
+    QVERIFY(covered.contains(QRect(95, 95, 10, 10)));
+}
+
+void TestTrailGrid::cellsOutsideTheGridAreFree()
+{
+    // Trail in the first column of the second chunk row, where an unchecked index past the
+    // right edge of the first chunk row would land
+    TrailGrid grid(GRID_SIDE, GRID_SIDE);
+    grid.stamp(QRectF(-100, -36, 10, 10), 1);
+    QVERIFY(grid.isOccupiedAt(0, 64));
+
+    QVERIFY(!grid.isOccupiedAt(4 * TrailGrid::CHUNK_SIZE, 0));
+    QVERIFY(!grid.isOccupiedAt(GRID_SIDE, 64));
+    QVERIFY(!grid.isOccupiedAt(-1, 64));
+    QVERIFY(!grid.isOccupiedAt(0, -1));
+    QVERIFY(!grid.isOccupiedAt(0, GRID_SIDE));
+}
+
+void TestTrailGrid::decayShrinksAndFreesChunks()
+{
+    TrailGrid grid(GRID_SIDE, GRID_SIDE);
+    grid.stamp(QRectF(-5, -5, 10, 10), 0);
+    QCOMPARE(grid.chunksInUse(), 1);
+
+    // The outer ring goes after one shrink step, the rest is still there
+    for (int i = 0; i < EDGE_LIFE; ++i) {
+        grid.decay();
+    }
+    QVERIFY(!grid.isOccupied(QRectF(-5, -5, 1, 1)));
+    QVERIFY(grid.isOccupied(QRectF(-4, -4, 1, 1)));
+
+    // The middle lasts peakLife decays; the chunk is freed on the decay that empties it
+    for (int i = EDGE_LIFE; i < TrailGrid::peakLife(10) - 1; ++i) {
+        grid.decay();
+    }
+    QVERIFY(grid.isOccupied(QRectF(-1, -1, 2, 2)));
+    QCOMPARE(grid.chunksInUse(), 1);
+    grid.decay();
+    QVERIFY(!grid.isOccupied(QRectF(-10, -10, 20, 20)));
+    QCOMPARE(grid.chunksInUse(), 0);
+    QVERIFY(grid.usedAreas().isEmpty());
+}
+
+void TestTrailGrid::stampAcrossChunkBorders()
+{
+    // Cells 124 to 131 straddle the border between the second and third chunk on both axes
+    TrailGrid grid(GRID_SIDE, GRID_SIDE);
+    grid.stamp(QRectF(24, 24, 8, 8), 7);
+    QCOMPARE(grid.chunksInUse(), 4);
+    QCOMPARE(grid.usedAreas().size(), 4);
+    QVERIFY(grid.isOccupied(QRectF(24, 24, 1, 1)));
+    QVERIFY(grid.isOccupied(QRectF(31, 31, 1, 1)));
+    QCOMPARE(lifeAt(grid, 127, 127), lifeAt(grid, 128, 128));
+}
+
+void TestTrailGrid::copiesShareUntilWritten()
+{
+    TrailGrid original(GRID_SIDE, GRID_SIDE);
+    original.stamp(QRectF(-5, -5, 10, 10), 1);
+
+    TrailGrid copy = original;
+    copy.stamp(QRectF(-5, 20, 10, 10), 2);
+    copy.decay();
+    QVERIFY(!original.isOccupied(QRectF(-5, 20, 10, 10)));
+    QCOMPARE(lifeAt(original, 100, 100), TrailGrid::peakLife(10));
+    QCOMPARE(lifeAt(copy, 100, 100), TrailGrid::peakLife(10) - 1);
+}
+
+void TestTrailGrid::clearAreaOnlyClearsThatArea()
+{
+    TrailGrid grid(GRID_SIDE, GRID_SIDE);
+    grid.stamp(QRectF(-5, -5, 10, 10), 1);
+    grid.clearArea(QRect(95, 95, 5, 10));
+    QVERIFY(!grid.isOccupied(QRectF(-5, -5, 5, 10)));
+    QVERIFY(grid.isOccupied(QRectF(0, -5, 5, 10)));
+
+    grid.clearArea(QRect(-50, -50, 10, 10)); // wholly outside, nothing happens
+    grid.clear();
+    QCOMPARE(grid.chunksInUse(), 0);
+}
+
+void TestTrailGrid::occupancyIsClippedToTheGrid()
+{
+    TrailGrid grid(GRID_SIDE, GRID_SIDE);
+    QCOMPARE(grid.stamp(QRectF(-200, -200, 10, 10), 1), QRect()); // off the grid, nothing laid
+    QCOMPARE(grid.chunksInUse(), 0);
+
+    grid.stamp(QRectF(95, 95, 10, 10), 1); // half off the bottom right corner
+    QCOMPARE(grid.chunksInUse(), 1);
+    QCOMPARE(grid.usedAreas().first(), QRect(192, 192, 8, 8)); // the last chunk is cut to the grid
+    QVERIFY(grid.isOccupied(QRectF(95, 95, 100, 100)));
+    QVERIFY(grid.isOccupiedAt(GRID_SIDE - 1, GRID_SIDE - 1));
+    QCOMPARE(grid.toGrid(QRectF(90, 90, 50, 50)), QRect(190, 190, 10, 10));
+    QVERIFY(!grid.isOccupied(QRectF(300, 300, 10, 10)));
+}
+
+QTEST_APPLESS_MAIN(TestTrailGrid)
+
+#include "tst_trailGrid.moc"
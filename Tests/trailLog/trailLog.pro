@@ -0,0 +1,11 @@
+# trailLog.pro
+
+include(../test.pri)
+TARGET = tst_trailLog
+SOURCES += tst_trailLog.cpp \
+    $$COMMON/bitStream.cpp \
+    $$COMMON/trailGrid.cpp \
+    $$COMMON/trailLog.cpp
+HEADERS += $$COMMON/bitStream.h \
+    $$COMMON/trailGrid.h \
+    $$COMMON/trailLog.h
@@ -0,0 +1,316 @@
+// tst_trailLog.cpp
+#include <QtTest>
+#include "../../Common/bitStream.h"
+#include "../../Common/trailLog.h"
+
+constexpr int ARENA_WIDTH = 800;
+constexpr int ARENA_HEIGHT = 600;
+constexpr int SEGMENT_SIZE = 10;
+constexpr int DECAY_INTERVAL_TICKS = 25;
+
+static bool sameSpans(const QVector<TrailLog::Span> &a, const QVector<TrailLog::Span> &b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (int i = 0; i < a.size(); ++i) {
+        if (a[i].owner != b[i].owner || a[i].firstTick != b[i].firstTick || a[i].first != b[i].first
+            || a[i].step != b[i].step || a[i].count != b[i].count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static TrailLog roundTrip(const TrailLog &log, bool *ok)
+{
+    BitWriter out;
+    log.encode(&out, ARENA_WIDTH, ARENA_HEIGHT);
+    BitReader in(out.finish());
+    TrailLog decoded;
+    *ok = decoded.decode(&in, ARENA_WIDTH, ARENA_HEIGHT);
+    return decoded;
+}
+
+// Life of every cell, the part both sides of a replay agree on
+static QByteArray gridLife(const TrailGrid &grid)
+{
+    QByteArray life(grid.width() * grid.height(), Qt::Uninitialized);
+    QByteArray owners(grid.width(), Qt::Uninitialized);
+    for (int y = 0; y < grid.height(); ++y) {
+        grid.readRow(0, y, grid.width(), reinterpret_cast<uchar *>(life.data()) + y * grid.width(),
+                     reinterpret_cast<uchar *>(owners.data()));
+    }
+    return life;
+}
+
+class TestTrailLog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void straightMovesShareARun();
+    void turnsAndGapsStartNewRuns();
+    void rewindTrimsOnlyTheOwner();
+    void rewindThenRecordExtendsTheKeptRun();
+    void encodeDecodeRoundTrip();
+    void runStartedBeforeAnEarlierOneRoundTrips();
+    void strideRoundTrip();
+    void payloadWithoutStrideReadsAsStrideOne();
+    void damagedPayloadFails();
+    void pruneDropsDeadRunsOnly();
+    void replayMatchesLiveStamping();
+};
+
+void TestTrailLog::straightMovesShareARun()
+{
+    TrailLog log(SEGMENT_SIZE, DECAY_INTERVAL_TICKS);
+    for (quint32 tick = 0; tick < 10; ++tick) {
+        log.record(tick, QPointF(-100 + tick * 1.5, 50), 3);
+    }
+    QCOMPARE(log.spans().size(), 1);
+    const TrailLog::Span &span = log.spans().first();
+    QCOMPARE(span.owner, quint8(3));
+    QCOMPARE(span.count, 10);
+    QCOMPARE(span.step, QPointF(1.5, 0));
+    QCOMPARE(span.last(), QPointF(-86.5, 50));
+}
+
+void TestTrailLog::turnsAndGapsStartNewRuns()
+{
+    TrailLog log(SEGMENT_SIZE, DECAY_INTERVAL_TICKS);
+    log.record(0, QPointF(0, 0), 0);
+    log.record(1, QPointF(1.5, 0), 0);
+    log.record(2, QPointF(1.5, 1.5), 0); // turned
+    QCOMPARE(log.spans().size(), 2);
+    log.record(4, QPointF(1.5, 4.5), 0); // skipped a tick
+    QCOMPARE(log.spans().size(), 3);
+    log.record(5, QPointF(1.5, 6.0), 1); // another owner never extends this one
+    QCOMPARE(log.spans().size(), 4);
+    log.record(5, QPointF(10, 10), 0); // the next tick, but off axis from the run's one segment
+    QCOMPARE(log.spans().size(), 5);
+}
+
+void TestTrailLog::rewindTrimsOnlyTheOwner()
+{
+    // Owners 0 and 1 interleave their runs, as they do in a match. A player lays its segment
+    // where it is before moving, so the turn tick still belongs to the run it turns off.
+    TrailLog log(SEGMENT_SIZE, DECAY_INTERVAL_TICKS);
+    for (quint32 tick = 0; tick < 40; ++tick) {
+        QPointF zero = tick <= 20 ? QPointF(-100 + tick * 1.5, 0) : QPointF(-70, (tick - 20) * 1.5);
+        QPointF one = tick <= 10 ? QPointF(100, -100 + tick * 1.5) : QPointF(100 - (tick - 10) * 1.5, -85);
+        log.record(tick, zero, 0);
+        log.record(tick, one, 1);
+    }
+    QCOMPARE(log.spans().size(), 4); // owner 0 from tick 0, owner 1 from 0, owner 1 from 11, owner 0 from 21
+    QVector<TrailLog::Span> before = log.spans();
+
+    // Back to tick 15: owner 0's second run goes, its first keeps ticks 0 to 14
+    QRectF removed = log.rewind(0, 15);
+    QCOMPARE(log.spans().size(), 3);
+    QCOMPARE(log.spans()[0].owner, quint8(0));
+    QCOMPARE(log.spans()[0].count, 15);
+    QVERIFY(sameSpans({log.spans()[1], log.spans()[2]}, {before[1], before[2]}));
+
+    // The area covers every dropped segment, from tick 15 on the first run to the end of the second
+    QVERIFY(removed.contains(log.segmentAt(QPointF(-100 + 15 * 1.5, 0))));
+    QVERIFY(removed.contains(log.segmentAt(QPointF(-70, 19 * 1.5))));
+    QVERIFY(!removed.intersects(log.segmentAt(QPointF(-100, 0))));
+}
+
+void TestTrailLog::rewindThenRecordExtendsTheKeptRun()
+{
+    TrailLog log(SEGMENT_SIZE, DECAY_INTERVAL_TICKS);
+    for (quint32 tick = 0; tick < 10; ++tick) {
+        log.record(tick, QPointF(tick * 1.5, 0), 0);
+        log.record(tick, QPointF(0, 100 + tick * 1.5), 1);
+    }
+    log.rewind(0, 6);
+
+    // The late turn is applied at tick 6: that segment is where the player was, the next one is around the corner
+    log.record(6, QPointF(9, 0), 0);
+    log.record(7, QPointF(9, 1.5), 0);
+    QCOMPARE(log.spans().size(), 3);
+    QCOMPARE(log.spans()[0].count, 7);
+    QCOMPARE(log.spans()[2].owner, quint8(0));
+    QCOMPARE(log.spans()[2].count, 1);
+
+    // Owner 1's open run survived the reindexing
+    log.record(10, QPointF(0, 115), 1);
+    QCOMPARE(log.spans().size(), 3);
+    QCOMPARE(log.spans()[1].count, 11);
+}
+
+void TestTrailLog::encodeDecodeRoundTrip()
+{
+    TrailLog log(SEGMENT_SIZE, DECAY_INTERVAL_TICKS);
+    QPointF position(-395.5, -299.5); // by the arena's top left corner, near the low end of the range
+    QPointF step(1.5, 0);
+    for (quint32 tick = 0; tick < 160; ++tick) {
+        if (tick % 40 == 39) {
+            step = QPointF(-step.y(), step.x()); // around a square, each run turning off the last
+        }
+        log.record(tick, position, 0);
+        log.record(tick, QPointF(200, -200 + tick * 0.5), 200); // slow, high owner id
+        position += step;
+    }
+    log.record(300, QPointF(0, 0), 0); // after a pause, carries its own tick and position
+
+    bool ok = false;
+    TrailLog decoded = roundTrip(log, &ok);
+    QVERIFY(ok);
+    QCOMPARE(decoded.segmentSide(), SEGMENT_SIZE);
+    QVERIFY(sameSpans(decoded.spans(), log.spans()));
+    QCOMPARE(decoded.decaysBetween(24, 25), 1);
+}
+
+void TestTrailLog::runStartedBeforeAnEarlierOneRoundTrips()
+{
+    // After a rewind an owner can start a run at a tick before another owner's latest run,
+    // so the tick delta to the previous span goes negative
+    TrailLog log(SEGMENT_SIZE, DECAY_INTERVAL_TICKS);
+    for (quint32 tick = 0; tick < 20; ++tick) {
+        log.record(tick, QPointF(tick * 1.5, 0), 0);
+    }
+    for (quint32 tick = 10; tick < 20; ++tick) {
+        log.record(tick, QPointF(100, tick * 1.5), 1);
+    }
+    log.rewind(0, 4);
+    log.record(4, QPointF(-200, -200), 0);
+    log.record(5, QPointF(-200, -198.5), 0);
+    QCOMPARE(log.spans().size(), 3);
+    QVERIFY(log.spans()[2].firstTick < log.spans()[1].firstTick);
+
+    bool ok = false;
+    TrailLog decoded = roundTrip(log, &ok);
+    QVERIFY(ok);
+    QVERIFY(sameSpans(decoded.spans(), log.spans()));
+}
+
+void TestTrailLog::strideRoundTrip()
+{
+    // Grid rules: a 5 unit segment every third tick
+    TrailLog log(5, DECAY_INTERVAL_TICKS, 3);
+    for (quint32 tick = 0; tick <= 30; tick += 3) {
+        log.record(tick, QPointF(-2.5 + tick / 3 * 5, 2.5), 0);
+    }
+    log.record(31, QPointF(60, 2.5), 0); // off the stride
+    QCOMPARE(log.spans().size(), 2);
+    QCOMPARE(log.spans()[0].count, 11);
+
+    bool ok = false;
+    TrailLog decoded = roundTrip(log, &ok);
+    QVERIFY(ok);
+    QCOMPARE(decoded.segmentSide(), 5);
+    QVERIFY(sameSpans(decoded.spans(), log.spans()));
+
+    // The stride came along: the next step extends the open run
+    decoded.record(34, QPointF(65, 2.5), 0);
+    QCOMPARE(decoded.spans().size(), 2);
+    QCOMPARE(decoded.spans()[1].count, 2);
+}
+
+void TestTrailLog::payloadWithoutStrideReadsAsStrideOne()
+{
+    // What builds before the stride wrote: the segment size alone
+    BitWriter out;
+    out.writeVarint(SEGMENT_SIZE);
+    out.writeVarint(DECAY_INTERVAL_TICKS);
+    out.writeVarint(0);
+    BitReader in(out.finish());
+
+    TrailLog log;
+    QVERIFY(log.decode(&in, ARENA_WIDTH, ARENA_HEIGHT));
+    QCOMPARE(log.segmentSide(), SEGMENT_SIZE);
+    log.record(0, QPointF(0, 0), 0);
+    log.record(1, QPointF(1.5, 0), 0);
+    QCOMPARE(log.spans().size(), 1);
+}
+
+void TestTrailLog::damagedPayloadFails()
+{
+    // A run continuing from an owner that has none yet
+    BitWriter out;
+    out.writeVarint(SEGMENT_SIZE);
+    out.writeVarint(DECAY_INTERVAL_TICKS);
+    out.writeVarint(1);
+    out.writeVarint(0);    // owner
+    out.writeBits(3, 2);   // heading
+    out.writeVarint(3);    // length
+    out.writeVarint(5);    // count
+    out.writeBool(true);   // turns off the previous run
+    BitReader in(out.finish());
+    TrailLog log;
+    QVERIFY(!log.decode(&in, ARENA_WIDTH, ARENA_HEIGHT));
+
+    // More spans than any arena holds
+    BitWriter tooMany;
+    tooMany.writeVarint(SEGMENT_SIZE);
+    tooMany.writeVarint(DECAY_INTERVAL_TICKS);
+    tooMany.writeVarint(1u << 20);
+    BitReader many(tooMany.finish());
+    QVERIFY(!log.decode(&many, ARENA_WIDTH, ARENA_HEIGHT));
+}
+
+void TestTrailLog::pruneDropsDeadRunsOnly()
+{
+    TrailLog log(SEGMENT_SIZE, DECAY_INTERVAL_TICKS);
+    log.record(0, QPointF(0, 0), 0);
+    log.record(1, QPointF(1.5, 0), 0);
+    log.record(100, QPointF(50, 50), 1);
+
+    // A segment's center lasts peakLife decays; the run is dead once its newest segment is
+    const quint32 lifetime = quint32(TrailGrid::peakLife(SEGMENT_SIZE) * DECAY_INTERVAL_TICKS);
+    log.prune(lifetime - 1);
+    QCOMPARE(log.spans().size(), 2);
+    log.prune(lifetime);
+    QCOMPARE(log.spans().size(), 1);
+    QCOMPARE(log.spans().first().owner, quint8(1));
+
+    // Owner 1's run is still open after the removal
+    log.record(101, QPointF(50, 51.5), 1);
+    QCOMPARE(log.spans().size(), 1);
+    QCOMPARE(log.spans().first().count, 2);
+}
+
+void TestTrailLog::replayMatchesLiveStamping()
+{
+    // The server stamps as it goes and ages the grid; a replay of the runs at the end must agree
+    TrailLog log(SEGMENT_SIZE, DECAY_INTERVAL_TICKS);
+    TrailGrid live(ARENA_WIDTH, ARENA_HEIGHT);
+    QPointF position(-300, -200);
+    QPointF step(1.5, 0);
+    quint32 tick = 0;
+    for (; tick < 1500; ++tick) {
+        if (tick % 200 == 199) {
+            step = QPointF(-step.y(), step.x());
+        }
+        log.record(tick, position, 0);
+        live.stamp(log.segmentAt(position), 0);
+        position += step;
+        if ((tick + 1) % DECAY_INTERVAL_TICKS == 0) {
+            live.decay();
+            log.prune(tick + 1);
+        }
+    }
+
+    TrailGrid replayed(ARENA_WIDTH, ARENA_HEIGHT);
+    log.replay(&replayed, tick);
+    QVERIFY(gridLife(replayed) == gridLife(live));
+    QVERIFY(replayed.chunksInUse() > 0);
+
+    // Rebuilding only an area leaves the rest alone and gives the same cells
+    QRect area(100, 50, 200, 150);
+    replayed.clearArea(area);
+    log.replay(&replayed, tick, area);
+    QVERIFY(gridLife(replayed) == gridLife(live));
+
+    // An area no run reaches stays empty, and nothing outside it is laid
+    TrailGrid untouched(ARENA_WIDTH, ARENA_HEIGHT);
+    log.replay(&untouched, tick, QRect(0, 0, 20, 20));
+    QCOMPARE(untouched.chunksInUse(), 0);
+}
+
+QTEST_APPLESS_MAIN(TestTrailLog)
+
+#include "tst_trailLog.moc"